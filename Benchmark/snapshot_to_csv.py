@@ -0,0 +1,52 @@
+#!/usr/bin/env python
+#-*- coding:utf-8 -*-
+
+# OpenMpsのスナップショット（result/particles_*.bin）を、既存のスクリプトで読めるCSVに変換する
+# 使い方: python snapshot_to_csv.py result/particles_00000.bin [...]
+# 　　　　（各ファイルと同じ場所に拡張子を.csvにして出力する）
+
+import sys
+import os
+import mmap
+import struct
+
+MAGIC = b"OPENMPS\0"
+VERSION = 1
+
+# ヘッダーと物理量の記述子（Snapshot.hppと同じ並び）
+HEADER = struct.Struct("<8sIIQdII")
+FIELD = struct.Struct("<8sIIQ")
+TYPES = {
+	0: struct.Struct("<d"), # Float64
+	1: struct.Struct("<i"), # Int32
+}
+
+def read(data):
+	magic, version, dimension, count, t, fieldCount, _ = HEADER.unpack_from(data, 0)
+	if magic != MAGIC or version != VERSION:
+		raise RuntimeError("Not a snapshot file")
+
+	columns = []
+	for i in range(fieldCount):
+		name, type, _, offset = FIELD.unpack_from(data, HEADER.size + FIELD.size*i)
+		columns.append((name.rstrip(b"\0").decode("ascii"), type, [v[0] for v in TYPES[type].iter_unpack(data[offset:offset + TYPES[type].size*count])]))
+	return t, columns
+
+def convert(filename):
+	with open(filename, "rb") as f:
+		data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+		t, columns = read(data)
+
+	# OpenMpsのCSV出力と同じ書式
+	with open(os.path.splitext(filename)[0] + ".csv", "w") as f:
+		f.write(", ".join([name for name, _, _ in columns]) + "\n")
+		formats = [("%d" if type == 1 else "%g") for _, type, _ in columns]
+		for values in zip(*[value for _, _, value in columns]):
+			f.write(", ".join([format % v for format, v in zip(formats, values)]) + "\n")
+
+def main(filenames):
+	for filename in filenames:
+		convert(filename)
+
+if __name__ == "__main__":
+	main(sys.argv[1:])
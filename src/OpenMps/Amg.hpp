@@ -0,0 +1,719 @@
+﻿#ifndef AMG_INCLUDED
+#define AMG_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <stdexcept>
+#pragma warning(pop)
+
+#include "Preconditioner.hpp"
+#include "Checkpoint.hpp"
+
+namespace { namespace OpenMps
+{
+	namespace Detail { namespace Preconditioning
+	{
+		// 疎行列とベクトルの積：y = A x
+		// @param A 行列
+		// @param x ベクトル
+		// @param y 結果
+		inline void Multiply(const Csr& A, const LongVector& x, LongVector& y)
+		{
+			const auto n = A.Size();
+			y.resize(n, false);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				auto y_i = 0.0;
+				for(auto k = A.start[i]; k < A.start[i + 1]; k++)
+				{
+					y_i += A.value[k] * x(A.column[k]);
+				}
+				y(i) = y_i;
+			}
+		}
+
+		// 転置行列を作成する
+		// @param A 行列
+		// @param m Aの列数
+		inline Csr Transpose(const Csr& A, const std::size_t m)
+		{
+			const auto n = A.Size();
+
+			Csr At;
+			At.start.assign(m + 1, 0);
+			for(const auto j : A.column)
+			{
+				At.start[j + 1]++;
+			}
+			PrefixSum(At.start);
+
+			// 元の行の順に入れていくので、各行の列番号は昇順になる
+			At.column.resize(A.column.size());
+			At.value.resize(A.value.size());
+			auto next = At.start;
+			for(auto i = decltype(n){0}; i < n; i++)
+			{
+				for(auto k = A.start[i]; k < A.start[i + 1]; k++)
+				{
+					const auto pos = next[A.column[k]]++;
+					At.column[pos] = i;
+					At.value[pos] = A.value[k];
+				}
+			}
+			At.FindDiagonal();
+			return At;
+		}
+
+		// 疎行列同士の積を作成する
+		// @param A 左の行列
+		// @param B 右の行列
+		// @param m Bの列数
+		inline Csr Multiply(const Csr& A, const Csr& B, const std::size_t m)
+		{
+			const auto n = A.Size();
+
+			Csr C;
+			C.start.assign(n + 1, 0);
+
+			// 各行で、結果の列の位置（無ければ負）
+			std::vector<std::ptrdiff_t> position(m, -1);
+			std::vector<std::size_t> rowColumn;
+			for(auto i = decltype(n){0}; i < n; i++)
+			{
+				const auto rowStart = C.column.size();
+				rowColumn.clear();
+
+				// Σ_k a_ik b_kj
+				for(auto ka = A.start[i]; ka < A.start[i + 1]; ka++)
+				{
+					const auto k = A.column[ka];
+					const auto a_ik = A.value[ka];
+					for(auto kb = B.start[k]; kb < B.start[k + 1]; kb++)
+					{
+						const auto j = B.column[kb];
+						if(position[j] < 0)
+						{
+							position[j] = static_cast<std::ptrdiff_t>(C.value.size());
+							C.column.push_back(j);
+							C.value.push_back(0.0);
+							rowColumn.push_back(j);
+						}
+						C.value[static_cast<std::size_t>(position[j])] += a_ik * B.value[kb];
+					}
+				}
+
+				// 列番号順に並べ直す
+				std::sort(rowColumn.begin(), rowColumn.end());
+				std::vector<double> rowValue;
+				rowValue.reserve(rowColumn.size());
+				for(const auto j : rowColumn)
+				{
+					rowValue.push_back(C.value[static_cast<std::size_t>(position[j])]);
+					position[j] = -1;
+				}
+				std::copy(rowColumn.begin(), rowColumn.end(), C.column.begin() + static_cast<std::ptrdiff_t>(rowStart));
+				std::copy(rowValue.begin(), rowValue.end(), C.value.begin() + static_cast<std::ptrdiff_t>(rowStart));
+
+				C.start[i + 1] = C.column.size();
+			}
+			C.FindDiagonal();
+			return C;
+		}
+
+		// 平滑化集約型の代数的マルチグリッド法（V-サイクル1回を前処理として使う）
+		class Amg final
+		{
+		public:
+			// 強い接続とみなす閾値：|a_ij| > θ√|a_ii a_jj|
+			static constexpr double STRENGTH_THRESHOLD = 0.08;
+
+			// 直接法で解く最も粗いレベルの最大の未知数
+			static constexpr std::size_t MAX_COARSE_SIZE = 256;
+
+			// 最大レベル数
+			static constexpr std::size_t MAX_LEVEL = 20;
+
+			// 前後の平滑化の回数
+			static constexpr std::size_t SMOOTHING_COUNT = 2;
+
+		private:
+			// 1レベル分
+			struct Level
+			{
+				// 係数行列（最も細かいレベルは使わず、前処理を適用する時に渡されたものを使う）
+				Csr A;
+
+				// 対角成分の逆数に平滑化の緩和係数を掛けたもの
+				std::vector<double> omegaInvDiagonal;
+
+				// 粗いレベルからの補間（プロロンゲーション）
+				Csr P;
+
+				// 粗いレベルへの制限（Pの転置）
+				Csr R;
+
+				// 作業用：右辺、解、残差
+				mutable LongVector b, x, r;
+			};
+
+			// 各レベル（先頭が最も細かい）
+			std::vector<Level> levels;
+
+			// 最も粗いレベルのLU分解（部分ピボット選択付き、行優先の密行列）
+			std::vector<double> coarseLu;
+			std::vector<std::size_t> coarsePivot;
+
+			// 最も粗いレベルを直接法で解くかどうか（大きすぎる時は平滑化だけにする）
+			bool isCoarseDirect;
+
+			// 行列のレベルの係数行列
+			static const Csr& Matrix(const Csr& A0, const std::vector<Level>& levels, const std::size_t l)
+			{
+				return (l == 0) ? A0 : levels[l].A;
+			}
+
+			// D^-1 Aの最大固有値の絶対値を冪乗法で見積もる
+			// @param A 係数行列
+			static double EstimateSpectralRadius(const Csr& A)
+			{
+				const auto n = A.Size();
+				if(n == 0)
+				{
+					return 1.0;
+				}
+
+				LongVector v(n), Av(n);
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					v(i) = 1.0 + static_cast<double>(i % 7) / 7;
+				}
+
+				auto rho = 1.0;
+				for(auto iteration = 0; iteration < 15; iteration++)
+				{
+					Multiply(A, v, Av);
+					auto norm = 0.0;
+					for(auto i = decltype(n){0}; i < n; i++)
+					{
+						Av(i) /= SafeDiagonal(A.Diagonal(i));
+						norm += Av(i) * Av(i);
+					}
+					norm = std::sqrt(norm);
+					if(norm == 0)
+					{
+						break;
+					}
+					rho = norm / boost::numeric::ublas::norm_2(v);
+					v = Av / norm;
+				}
+				return rho;
+			}
+
+			// 強い接続を元に節点を集約する
+			// @param A 係数行列
+			// @param aggregate 各節点の集約先の番号（どこにも接続が無い節点は負）
+			// @return 集約の数
+			static std::size_t Aggregate(const Csr& A, std::vector<std::ptrdiff_t>& aggregate)
+			{
+				const auto n = A.Size();
+
+				// 強い接続の隣接リスト
+				std::vector<std::size_t> strongStart(n + 1, 0);
+				std::vector<std::size_t> strong;
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					const auto a_ii = std::abs(A.Diagonal(i));
+					for(auto k = A.start[i]; k < A.start[i + 1]; k++)
+					{
+						const auto j = A.column[k];
+						if((j != i) && (std::abs(A.value[k]) > STRENGTH_THRESHOLD * std::sqrt(a_ii * std::abs(A.Diagonal(j)))))
+						{
+							strong.push_back(j);
+						}
+					}
+					strongStart[i + 1] = strong.size();
+				}
+
+				constexpr auto UNDECIDED = std::ptrdiff_t{-2};
+				constexpr auto ISOLATED = std::ptrdiff_t{-1};
+				aggregate.assign(n, UNDECIDED);
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					if(strongStart[i] == strongStart[i + 1])
+					{
+						aggregate[i] = ISOLATED;
+					}
+				}
+
+				auto count = std::ptrdiff_t{0};
+
+				// 1. 自分と強い接続先が全て未集約なら、まとめて新しい集約にする
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					if(aggregate[i] != UNDECIDED)
+					{
+						continue;
+					}
+
+					const auto isFree = std::all_of(strong.begin() + static_cast<std::ptrdiff_t>(strongStart[i]), strong.begin() + static_cast<std::ptrdiff_t>(strongStart[i + 1]),
+						[&aggregate](const auto j)
+						{
+							return aggregate[j] == UNDECIDED;
+						});
+					if(isFree)
+					{
+						aggregate[i] = count;
+						for(auto k = strongStart[i]; k < strongStart[i + 1]; k++)
+						{
+							aggregate[strong[k]] = count;
+						}
+						count++;
+					}
+				}
+
+				// 2. 残りは強い接続先の集約に入れる
+				auto secondPass = aggregate;
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					if(aggregate[i] != UNDECIDED)
+					{
+						continue;
+					}
+					for(auto k = strongStart[i]; k < strongStart[i + 1]; k++)
+					{
+						const auto agg = aggregate[strong[k]];
+						if(agg >= 0)
+						{
+							secondPass[i] = agg;
+							break;
+						}
+					}
+				}
+				aggregate.swap(secondPass);
+
+				// 3. それでも残ったものは、未集約の強い接続先と新しい集約にする
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					if(aggregate[i] != UNDECIDED)
+					{
+						continue;
+					}
+					aggregate[i] = count;
+					for(auto k = strongStart[i]; k < strongStart[i + 1]; k++)
+					{
+						if(aggregate[strong[k]] == UNDECIDED)
+						{
+							aggregate[strong[k]] = count;
+						}
+					}
+					count++;
+				}
+
+				return static_cast<std::size_t>(count);
+			}
+
+			// 平滑化した補間行列を作成する：P = (I - ω D^-1 A) P_tent
+			// @param A 係数行列
+			// @param aggregate 各節点の集約先
+			// @param coarseN 集約の数
+			// @param omega 緩和係数
+			static Csr SmoothedProlongation(const Csr& A, const std::vector<std::ptrdiff_t>& aggregate, const std::size_t coarseN, const double omega)
+			{
+				const auto n = A.Size();
+
+				// 仮の補間行列：各集約内で一定値（列毎に正規化）
+				std::vector<std::size_t> aggregateSize(coarseN, 0);
+				for(const auto agg : aggregate)
+				{
+					if(agg >= 0)
+					{
+						aggregateSize[static_cast<std::size_t>(agg)]++;
+					}
+				}
+				Csr tentative;
+				tentative.start.assign(n + 1, 0);
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					const auto agg = aggregate[i];
+					if(agg >= 0)
+					{
+						tentative.column.push_back(static_cast<std::size_t>(agg));
+						tentative.value.push_back(1.0 / std::sqrt(static_cast<double>(aggregateSize[static_cast<std::size_t>(agg)])));
+					}
+					tentative.start[i + 1] = tentative.column.size();
+				}
+				tentative.FindDiagonal();
+
+				// 平滑化の演算子：I - ω D^-1 A
+				Csr smoother = A;
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					const auto scale = omega / SafeDiagonal(A.Diagonal(i));
+					for(auto k = smoother.start[i]; k < smoother.start[i + 1]; k++)
+					{
+						smoother.value[k] = ((smoother.column[k] == i) ? 1.0 : 0.0) - scale * smoother.value[k];
+					}
+				}
+
+				return Multiply(smoother, tentative, coarseN);
+			}
+
+			// 各レベルの係数行列から平滑化と粗いレベルの係数行列を作り直す
+			// @param A 最も細かいレベルの係数行列
+			void ComputeOperators(const Csr& A)
+			{
+				const auto levelCount = levels.size();
+				for(auto l = decltype(levelCount){0}; l < levelCount; l++)
+				{
+					auto& level = levels[l];
+					const auto& A_l = Matrix(A, levels, l);
+					const auto n = A_l.Size();
+
+					// 重み付きJacobi法の緩和係数：4/(3ρ(D^-1 A))
+					const auto omega = 4.0 / (3.0 * EstimateSpectralRadius(A_l));
+					level.omegaInvDiagonal.resize(n);
+					for(auto i = decltype(n){0}; i < n; i++)
+					{
+						level.omegaInvDiagonal[i] = omega / SafeDiagonal(A_l.Diagonal(i));
+					}
+
+					level.b.resize(n, false);
+					level.x.resize(n, false);
+					level.r.resize(n, false);
+
+					// ガラーキン近似：A_c = R A P
+					if(l + 1 < levelCount)
+					{
+						const auto coarseN = levels[l + 1].b.size();
+						levels[l + 1].A = Multiply(level.R, Multiply(A_l, level.P, coarseN), coarseN);
+					}
+				}
+
+				// 最も粗いレベルをLU分解する
+				const auto& coarseA = Matrix(A, levels, levelCount - 1);
+				const auto coarseN = coarseA.Size();
+				isCoarseDirect = (coarseN <= MAX_COARSE_SIZE);
+				if(isCoarseDirect)
+				{
+					coarseLu.assign(coarseN * coarseN, 0.0);
+					for(auto i = decltype(coarseN){0}; i < coarseN; i++)
+					{
+						for(auto k = coarseA.start[i]; k < coarseA.start[i + 1]; k++)
+						{
+							coarseLu[i * coarseN + coarseA.column[k]] = coarseA.value[k];
+						}
+					}
+
+					coarsePivot.resize(coarseN);
+					for(auto k = decltype(coarseN){0}; k < coarseN; k++)
+					{
+						// 部分ピボット選択
+						auto pivot = k;
+						for(auto i = k + 1; i < coarseN; i++)
+						{
+							if(std::abs(coarseLu[i * coarseN + k]) > std::abs(coarseLu[pivot * coarseN + k]))
+							{
+								pivot = i;
+							}
+						}
+						coarsePivot[k] = pivot;
+						if(pivot != k)
+						{
+							std::swap_ranges(coarseLu.begin() + static_cast<std::ptrdiff_t>(k * coarseN), coarseLu.begin() + static_cast<std::ptrdiff_t>((k + 1) * coarseN), coarseLu.begin() + static_cast<std::ptrdiff_t>(pivot * coarseN));
+						}
+
+						// 特異なら、その未知数は解かない
+						if(coarseLu[k * coarseN + k] == 0)
+						{
+							coarseLu[k * coarseN + k] = 1.0;
+						}
+
+						const auto a_kk = coarseLu[k * coarseN + k];
+						for(auto i = k + 1; i < coarseN; i++)
+						{
+							const auto l_ik = coarseLu[i * coarseN + k] / a_kk;
+							coarseLu[i * coarseN + k] = l_ik;
+							if(l_ik != 0)
+							{
+								for(auto j = k + 1; j < coarseN; j++)
+								{
+									coarseLu[i * coarseN + j] -= l_ik * coarseLu[k * coarseN + j];
+								}
+							}
+						}
+					}
+				}
+			}
+
+			// 行列をチェックポイントに書き出す
+			// @param writer 書き出し先
+			// @param name 名前
+			// @param A 行列
+			static void SaveMatrix(CheckpointWriter& writer, const std::string& name, const Csr& A)
+			{
+				writer.WriteArray(name + ".start", A.start);
+				writer.WriteArray(name + ".column", A.column);
+				writer.WriteArray(name + ".value", A.value);
+				writer.WriteArray(name + ".diagonal", A.diagonal);
+			}
+
+			// 行列をチェックポイントから読み込む
+			// @param reader 読み込み元
+			// @param name 名前
+			// @param A 読み込み先
+			static void LoadMatrix(CheckpointReader& reader, const std::string& name, Csr& A)
+			{
+				reader.ReadArray(name + ".start", A.start);
+				reader.ReadArray(name + ".column", A.column);
+				reader.ReadArray(name + ".value", A.value);
+				reader.ReadArray(name + ".diagonal", A.diagonal);
+			}
+
+			// 重み付きJacobi法で平滑化する：x += ωD^-1 (b - A x)
+			static void Smooth(const Csr& A, const Level& level)
+			{
+				Multiply(A, level.x, level.r);
+				const auto n = A.Size();
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					level.x(i) += level.omegaInvDiagonal[i] * (level.b(i) - level.r(i));
+				}
+			}
+
+			// 最も粗いレベルを解く
+			void SolveCoarse(const Csr& A, const Level& level) const
+			{
+				if(!isCoarseDirect)
+				{
+					level.x.clear();
+					for(auto s = decltype(SMOOTHING_COUNT){0}; s < SMOOTHING_COUNT * 2; s++)
+					{
+						Smooth(A, level);
+					}
+					return;
+				}
+
+				const auto n = A.Size();
+				auto& x = level.x;
+				x = level.b;
+				for(auto k = decltype(n){0}; k < n; k++)
+				{
+					std::swap(x(k), x(coarsePivot[k]));
+				}
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					auto x_i = x(i);
+					for(auto j = decltype(i){0}; j < i; j++)
+					{
+						x_i -= coarseLu[i * n + j] * x(j);
+					}
+					x(i) = x_i;
+				}
+				for(auto i = n; i > 0; i--)
+				{
+					const auto row = i - 1;
+					auto x_i = x(row);
+					for(auto j = row + 1; j < n; j++)
+					{
+						x_i -= coarseLu[row * n + j] * x(j);
+					}
+					x(row) = x_i / coarseLu[row * n + row];
+				}
+			}
+
+			// V-サイクル
+			// @param A 最も細かいレベルの係数行列
+			// @param l レベル
+			void Cycle(const Csr& A, const std::size_t l) const
+			{
+				const auto& level = levels[l];
+				const auto& A_l = Matrix(A, levels, l);
+				if(l + 1 == levels.size())
+				{
+					SolveCoarse(A_l, level);
+					return;
+				}
+
+				// 前平滑化
+				level.x.clear();
+				for(auto s = decltype(SMOOTHING_COUNT){0}; s < SMOOTHING_COUNT; s++)
+				{
+					Smooth(A_l, level);
+				}
+
+				// 残差を粗いレベルで解いて修正
+				Multiply(A_l, level.x, level.r);
+				level.r = level.b - level.r;
+				const auto& coarse = levels[l + 1];
+				Multiply(level.R, level.r, coarse.b);
+				Cycle(A, l + 1);
+				Multiply(level.P, coarse.x, level.r);
+				level.x += level.r;
+
+				// 後平滑化
+				for(auto s = decltype(SMOOTHING_COUNT){0}; s < SMOOTHING_COUNT; s++)
+				{
+					Smooth(A_l, level);
+				}
+			}
+
+		public:
+			Amg()
+				: isCoarseDirect(false)
+			{}
+
+			// 作成済みの階層の未知数
+			std::size_t Size() const
+			{
+				return levels.empty() ? 0 : levels.front().b.size();
+			}
+
+			// レベル数
+			std::size_t LevelCount() const
+			{
+				return levels.size();
+			}
+
+			// 階層を作成する（集約と補間行列から全て作り直す）
+			// @param A 係数行列（対称）
+			void Compute(const Csr& A)
+			{
+				// ※レベルを足しても上のレベルへの参照が無効にならないよう、先に確保しておく
+				levels.clear();
+				levels.reserve(MAX_LEVEL);
+				levels.emplace_back();
+
+				// 粗くならなくなるまで集約を繰り返す
+				auto n = A.Size();
+				while((n > MAX_COARSE_SIZE) && (levels.size() < MAX_LEVEL))
+				{
+					auto& level = levels.back();
+					const auto& A_l = Matrix(A, levels, levels.size() - 1);
+
+					std::vector<std::ptrdiff_t> aggregate;
+					const auto coarseN = Aggregate(A_l, aggregate);
+					if((coarseN == 0) || (coarseN * 10 > n * 9))
+					{
+						break;
+					}
+
+					const auto omega = 4.0 / (3.0 * EstimateSpectralRadius(A_l));
+					level.P = SmoothedProlongation(A_l, aggregate, coarseN, omega);
+					level.R = Transpose(level.P, coarseN);
+
+					levels.emplace_back();
+					auto& coarse = levels.back();
+					coarse.A = Multiply(level.R, Multiply(A_l, level.P, coarseN), coarseN);
+					coarse.b.resize(coarseN, false);
+					n = coarseN;
+				}
+				levels.front().b.resize(A.Size(), false);
+
+				ComputeOperators(A);
+			}
+
+			// 集約と補間行列はそのままで、係数行列に関する部分だけ作り直す
+			// ※係数行列の非零成分の位置はゆっくりとしか変わらないので、集約を使い回しても前処理としての効果はあまり落ちない
+			// @param A 係数行列（前回と同じ大きさ）
+			void Update(const Csr& A)
+			{
+				ComputeOperators(A);
+			}
+
+			// 作成済みの階層をチェックポイントに書き出す
+			// ※集約を使い回している途中でも、そのまま続けた計算と同じ前処理になるよう全て書き出す
+			// @param writer 書き出し先
+			// @param name 名前の接頭辞
+			void Save(CheckpointWriter& writer, const std::string& name) const
+			{
+				const auto levelCount = levels.size();
+				std::vector<std::size_t> size(levelCount);
+				for(auto l = decltype(levelCount){0}; l < levelCount; l++)
+				{
+					size[l] = levels[l].b.size();
+				}
+				writer.WriteArray(name + ".size", size);
+
+				for(auto l = decltype(levelCount){0}; l < levelCount; l++)
+				{
+					const auto& level = levels[l];
+					const auto levelName = name + std::to_string(l);
+					SaveMatrix(writer, levelName + ".A", level.A);
+					writer.WriteArray(levelName + ".omega", level.omegaInvDiagonal);
+					SaveMatrix(writer, levelName + ".P", level.P);
+					SaveMatrix(writer, levelName + ".R", level.R);
+				}
+
+				writer.WriteArray(name + ".coarseLu", coarseLu);
+				writer.WriteArray(name + ".coarsePivot", coarsePivot);
+				writer.WriteValue(name + ".isCoarseDirect", isCoarseDirect);
+			}
+
+			// 書き出した階層をチェックポイントから読み込む
+			// @param reader 読み込み元
+			// @param name 名前の接頭辞
+			void Load(CheckpointReader& reader, const std::string& name)
+			{
+				std::vector<std::size_t> size;
+				reader.ReadArray(name + ".size", size);
+
+				const auto levelCount = size.size();
+				if(levelCount > MAX_LEVEL)
+				{
+					throw std::runtime_error("Checkpoint AMG hierarchy is inconsistent");
+				}
+				levels.clear();
+				levels.reserve(MAX_LEVEL);
+				for(auto l = decltype(levelCount){0}; l < levelCount; l++)
+				{
+					levels.emplace_back();
+					auto& level = levels.back();
+					const auto levelName = name + std::to_string(l);
+					LoadMatrix(reader, levelName + ".A", level.A);
+					reader.ReadArray(levelName + ".omega", level.omegaInvDiagonal);
+					LoadMatrix(reader, levelName + ".P", level.P);
+					LoadMatrix(reader, levelName + ".R", level.R);
+
+					level.b.resize(size[l], false);
+					level.x.resize(size[l], false);
+					level.r.resize(size[l], false);
+				}
+
+				reader.ReadArray(name + ".coarseLu", coarseLu);
+				reader.ReadArray(name + ".coarsePivot", coarsePivot);
+				isCoarseDirect = reader.ReadValue<bool>(name + ".isCoarseDirect");
+			}
+
+			// 前処理を適用する
+			// @param A 係数行列（作成した時と同じもの）
+			// @param r 残差
+			// @param z 前処理後の残差
+			void Apply(const Csr& A, const LongVector& r, LongVector& z) const
+			{
+				levels.front().b = r;
+				Cycle(A, 0);
+				z = levels.front().x;
+			}
+		};
+	}}
+}}
+#endif
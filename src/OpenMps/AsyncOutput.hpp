@@ -0,0 +1,239 @@
+﻿#ifndef ASYNC_OUTPUT_INCLUDED
+#define ASYNC_OUTPUT_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <array>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <type_traits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#pragma warning(pop)
+
+#include "Particle.hpp"
+
+namespace { namespace OpenMps
+{
+	// 計算結果の非同期出力
+	// ※粒子の状態を作業領域に複製するところまでを計算側で行い、ファイルへの書き出しは専用のスレッドで行う
+	// ※作業領域は2つで、書き出しが追いつかず両方埋まっている時は空くまで計算側を待たせる
+	// @tparam DIM 次元
+	template<std::size_t DIM = OpenMps::DIM>
+	class AsyncOutput final
+	{
+	public:
+		using Particle = OpenMps::Particle<DIM>;
+
+		// 書き出す関数
+		// @param particles 粒子
+		// @param outputCount 出力番号
+		// @param t 時刻
+		using WriteFunction = std::function<void(const std::vector<Particle>& particles, std::size_t outputCount, double t)>;
+
+		// 作業領域の数
+		static constexpr std::size_t BUFFER_COUNT = 2;
+
+	private:
+		// 1回分の出力の作業領域
+		struct Buffer final
+		{
+			// 粒子
+			std::vector<Particle> particles;
+
+			// 出力番号
+			std::size_t outputCount;
+
+			// 時刻
+			double t;
+
+			// 書き出し待ちかどうか
+			bool isPending;
+		};
+
+		// 書き出す関数
+		const WriteFunction write;
+
+		// 作業領域
+		std::array<Buffer, BUFFER_COUNT> buffer;
+
+		// 次に複製する作業領域
+		std::size_t pushIndex;
+
+		// 次に書き出す作業領域
+		std::size_t writeIndex;
+
+		// 書き出し用スレッドを止めるかどうか
+		bool isStopping;
+
+		// 書き出しで発生した例外（最初の1つ）
+		std::exception_ptr error;
+
+		// 作業領域の状態の排他制御
+		std::mutex mutex;
+
+		// 作業領域の状態の変化の通知
+		std::condition_variable changed;
+
+		// 書き出し用スレッド
+		std::thread writer;
+
+		// 書き出し用スレッドの処理
+		void WriteLoop()
+		{
+#ifdef _OPENMP
+			// 計算側のスレッドを奪わないように、書き出しは並列化しない
+			omp_set_num_threads(1);
+#endif
+			std::unique_lock<std::mutex> lock(mutex);
+			for(;;)
+			{
+				changed.wait(lock, [this]{ return buffer[writeIndex].isPending || isStopping; });
+				if(!buffer[writeIndex].isPending)
+				{
+					// 書き出し待ちが無くなってから止める
+					return;
+				}
+
+				// 書き出している間は、計算側がもう1つの作業領域を使えるようにする
+				auto& current = buffer[writeIndex];
+				lock.unlock();
+				try
+				{
+					write(current.particles, current.outputCount, current.t);
+				}
+				catch(...)
+				{
+					lock.lock();
+					if(!error)
+					{
+						error = std::current_exception();
+					}
+					lock.unlock();
+				}
+				lock.lock();
+
+				current.isPending = false;
+				writeIndex = (writeIndex + 1) % BUFFER_COUNT;
+				changed.notify_all();
+			}
+		}
+
+		// 書き出しで発生した例外を投げ直す
+		// ※mutexを確保した状態で呼ぶ
+		void RethrowError()
+		{
+			if(error)
+			{
+				auto e = error;
+				error = nullptr;
+				std::rethrow_exception(e);
+			}
+		}
+
+	public:
+		// @param writeFunction 書き出す関数
+		explicit AsyncOutput(WriteFunction writeFunction)
+			: write(std::move(writeFunction)),
+			buffer(), pushIndex(0), writeIndex(0),
+			isStopping(false), error(),
+			mutex(), changed(), writer()
+		{
+			for(auto& b : buffer)
+			{
+				b.outputCount = 0;
+				b.t = 0;
+				b.isPending = false;
+			}
+			writer = std::thread([this]{ WriteLoop(); });
+		}
+
+		~AsyncOutput()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				isStopping = true;
+			}
+			changed.notify_all();
+			writer.join();
+		}
+
+		AsyncOutput(const AsyncOutput&) = delete;
+		AsyncOutput& operator=(const AsyncOutput&) = delete;
+
+		// 粒子の状態を複製して書き出しを予約する
+		// ※作業領域が空いていなければ、書き出しが終わるまで待つ
+		// @param n 粒子数
+		// @param getParticle 粒子番号から粒子を取得する関数
+		// @param outputCount 出力番号
+		// @param t 時刻
+		// @return 無効粒子以外の粒子数
+		template<typename GET_PARTICLE>
+		std::size_t Push(const std::size_t n, GET_PARTICLE getParticle, const std::size_t outputCount, const double t)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]{ return !buffer[pushIndex].isPending; });
+			RethrowError();
+			auto& current = buffer[pushIndex];
+			lock.unlock();
+
+			// 作業領域に複製する（領域は次回以降も使い回す）
+			auto& particles = current.particles;
+			particles.resize(n, Particle(Particle::Type::Disabled));
+			std::size_t nonDisabledCount = 0;
+#ifdef _OPENMP
+			#pragma omp parallel for reduction(+:nonDisabledCount)
+#endif
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				particles[i] = getParticle(i);
+				if(particles[i].TYPE() != Particle::Type::Disabled)
+				{
+					nonDisabledCount++;
+				}
+			}
+			current.outputCount = outputCount;
+			current.t = t;
+
+			lock.lock();
+			current.isPending = true;
+			pushIndex = (pushIndex + 1) % BUFFER_COUNT;
+			changed.notify_all();
+
+			return nonDisabledCount;
+		}
+
+		// 予約した書き出しが全て終わるまで待つ
+		void Flush()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]
+			{
+				for(const auto& b : buffer)
+				{
+					if(b.isPending)
+					{
+						return false;
+					}
+				}
+				return true;
+			});
+			RethrowError();
+		}
+	};
+
+	template<std::size_t DIM>
+	constexpr std::size_t AsyncOutput<DIM>::BUFFER_COUNT;
+}}
+#endif
@@ -0,0 +1,301 @@
+﻿#ifndef CHECKPOINT_INCLUDED
+#define CHECKPOINT_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#pragma warning(pop)
+
+namespace { namespace OpenMps
+{
+	// チェックポイント（計算を途中から再開するための全状態）の形式
+	// ※ヘッダーの後に、名前付きの記録（記録の見出しと配列）を書き出した順に並べる
+	// ※値はメモリ上の表現のまま書き出すので、同じ環境・同じビルドでのみ読み込める
+	namespace Detail { namespace Checkpoint
+	{
+		// ファイル先頭の識別子
+		static constexpr char MAGIC[8] = {'O', 'M', 'P', 'S', 'C', 'K', 'P', 'T'};
+
+		// 形式の版
+		static constexpr std::uint32_t VERSION = 2;
+
+		// ヘッダー
+		struct Header final
+		{
+			// 識別子
+			char magic[8];
+
+			// 形式の版
+			std::uint32_t version;
+
+			// 次元
+			std::uint32_t dimension;
+		};
+		static_assert(sizeof(Header) == 16, "Checkpoint header must be packed");
+
+		// 記録の見出し
+		struct Record final
+		{
+			// 名前（終端文字で埋める）
+			char name[32];
+
+			// 1要素の大きさ
+			std::uint64_t elementSize;
+
+			// 要素数
+			std::uint64_t count;
+		};
+		static_assert(sizeof(Record) == 48, "Checkpoint record must be packed");
+	}}
+
+	// チェックポイントの書き出し
+	// ※一時ファイルに書き出してから置き換えるので、書き出し中に止まっても前回のチェックポイントは壊れない
+	class CheckpointWriter final
+	{
+	private:
+		// 出力先
+		const std::string filename;
+
+		// 書き出し中の一時ファイル名
+		const std::string temporaryFilename;
+
+		std::ofstream output;
+
+		// 記録を書き出す
+		// @param name 名前
+		// @param data 先頭
+		// @param elementSize 1要素の大きさ
+		// @param count 要素数
+		void WriteRecord(const std::string& name, const void* const data, const std::size_t elementSize, const std::size_t count)
+		{
+			Detail::Checkpoint::Record record;
+			std::memset(&record, 0, sizeof(record));
+			if(name.size() >= sizeof(record.name))
+			{
+				throw std::runtime_error("Checkpoint record name is too long: " + name);
+			}
+			name.copy(record.name, sizeof(record.name) - 1); // 終端文字は0埋めで残す
+			record.elementSize = elementSize;
+			record.count = count;
+
+			output.write(reinterpret_cast<const char*>(&record), sizeof(record));
+			output.write(static_cast<const char*>(data), static_cast<std::streamsize>(elementSize * count));
+		}
+
+	public:
+		// @param filename_ 出力先
+		// @param dimension 次元
+		CheckpointWriter(const std::string& filename_, const std::size_t dimension)
+			: filename(filename_), temporaryFilename(filename_ + ".tmp"),
+			output(temporaryFilename, std::ios::binary)
+		{
+			if(!output)
+			{
+				throw std::runtime_error("Cannot open checkpoint file: " + temporaryFilename);
+			}
+
+			Detail::Checkpoint::Header header;
+			std::memset(&header, 0, sizeof(header));
+			std::memcpy(header.magic, Detail::Checkpoint::MAGIC, sizeof(header.magic));
+			header.version = Detail::Checkpoint::VERSION;
+			header.dimension = static_cast<std::uint32_t>(dimension);
+			output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		}
+
+		CheckpointWriter(const CheckpointWriter&) = delete;
+		CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+		// 値を1つ書き出す
+		// @param name 名前
+		// @param value 値
+		template<typename T>
+		void WriteValue(const std::string& name, const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Checkpoint value must be trivially copyable");
+			WriteRecord(name, &value, sizeof(T), 1);
+		}
+
+		// 配列を書き出す
+		// @param name 名前
+		// @param data 配列
+		template<typename ARRAY>
+		void WriteArray(const std::string& name, const ARRAY& data)
+		{
+			using T = typename ARRAY::value_type;
+			static_assert(std::is_trivially_copyable<T>::value, "Checkpoint array element must be trivially copyable");
+			WriteRecord(name, data.data(), sizeof(T), data.size());
+		}
+
+		// ベクトルの配列を書き出す
+		// ※各成分を並べた倍精度の配列として書き出す
+		// @param name 名前
+		// @param data 配列
+		template<std::size_t DIM, typename ARRAY>
+		void WriteVectors(const std::string& name, const ARRAY& data)
+		{
+			std::vector<double> value(DIM * data.size());
+			for(auto i = decltype(data.size()){0}; i < data.size(); i++)
+			{
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					value[DIM * i + d] = data[i][d];
+				}
+			}
+			WriteRecord(name, value.data(), sizeof(double) * DIM, data.size());
+		}
+
+		// 書き出しを終えて、出力先を置き換える
+		void Commit()
+		{
+			output.close();
+			if(!output)
+			{
+				throw std::runtime_error("Cannot write checkpoint file: " + temporaryFilename);
+			}
+
+			// 置き換え先が既にあると失敗する環境があるので、先に消しておく
+			std::remove(filename.c_str());
+			if(std::rename(temporaryFilename.c_str(), filename.c_str()) != 0)
+			{
+				throw std::runtime_error("Cannot replace checkpoint file: " + filename);
+			}
+		}
+	};
+
+	// チェックポイントの読み込み
+	// ※書き出した時と同じ順番で、同じ名前と型で読み込む
+	class CheckpointReader final
+	{
+	private:
+		// 読み込み元
+		const std::string filename;
+
+		std::ifstream input;
+
+		// 次元
+		std::size_t dimension;
+
+		// 記録の見出しを読み込んで、名前と1要素の大きさを確かめる
+		// @param name 名前
+		// @param elementSize 1要素の大きさ
+		// @return 要素数
+		std::size_t ReadRecord(const std::string& name, const std::size_t elementSize)
+		{
+			Detail::Checkpoint::Record record;
+			input.read(reinterpret_cast<char*>(&record), sizeof(record));
+			if(!input)
+			{
+				throw std::runtime_error("Checkpoint file is truncated: " + filename);
+			}
+			record.name[sizeof(record.name) - 1] = '\0';
+			if(name != record.name)
+			{
+				throw std::runtime_error("Checkpoint record mismatch: expected " + name + " but found " + record.name);
+			}
+			if(record.elementSize != elementSize)
+			{
+				throw std::runtime_error("Checkpoint record has unexpected element size: " + name);
+			}
+			return static_cast<std::size_t>(record.count);
+		}
+
+		// 配列の中身を読み込む
+		// @param data 先頭
+		// @param bytes 大きさ
+		void ReadData(void* const data, const std::size_t bytes)
+		{
+			input.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes));
+			if(!input)
+			{
+				throw std::runtime_error("Checkpoint file is truncated: " + filename);
+			}
+		}
+
+	public:
+		// @param filename_ 読み込み元
+		explicit CheckpointReader(const std::string& filename_)
+			: filename(filename_), input(filename_, std::ios::binary), dimension(0)
+		{
+			if(!input)
+			{
+				throw std::runtime_error("Cannot open checkpoint file: " + filename);
+			}
+
+			Detail::Checkpoint::Header header;
+			input.read(reinterpret_cast<char*>(&header), sizeof(header));
+			if(!input || (std::memcmp(header.magic, Detail::Checkpoint::MAGIC, sizeof(header.magic)) != 0))
+			{
+				throw std::runtime_error("Not a checkpoint file: " + filename);
+			}
+			if(header.version != Detail::Checkpoint::VERSION)
+			{
+				throw std::runtime_error("Unsupported checkpoint version: " + filename);
+			}
+			dimension = header.dimension;
+		}
+
+		CheckpointReader(const CheckpointReader&) = delete;
+		CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+		// 次元
+		std::size_t Dimension() const
+		{
+			return dimension;
+		}
+
+		// 値を1つ読み込む
+		// @param name 名前
+		template<typename T>
+		T ReadValue(const std::string& name)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Checkpoint value must be trivially copyable");
+			if(ReadRecord(name, sizeof(T)) != 1)
+			{
+				throw std::runtime_error("Checkpoint record is not a single value: " + name);
+			}
+			T value;
+			ReadData(&value, sizeof(T));
+			return value;
+		}
+
+		// 配列を読み込む
+		// @param name 名前
+		// @param data 読み込み先（要素数は記録に合わせる）
+		template<typename ARRAY>
+		void ReadArray(const std::string& name, ARRAY& data)
+		{
+			using T = typename ARRAY::value_type;
+			static_assert(std::is_trivially_copyable<T>::value, "Checkpoint array element must be trivially copyable");
+			data.resize(ReadRecord(name, sizeof(T)));
+			ReadData(data.data(), sizeof(T) * data.size());
+		}
+
+		// ベクトルの配列を読み込む
+		// @param name 名前
+		// @param data 読み込み先（要素数は記録に合わせる）
+		template<std::size_t DIM, typename ARRAY>
+		void ReadVectors(const std::string& name, ARRAY& data)
+		{
+			std::vector<double> value(DIM * ReadRecord(name, sizeof(double) * DIM));
+			ReadData(value.data(), sizeof(double) * value.size());
+
+			data.resize(value.size() / DIM);
+			for(auto i = decltype(data.size()){0}; i < data.size(); i++)
+			{
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					data[i][d] = value[DIM * i + d];
+				}
+			}
+		}
+	};
+}}
+#endif
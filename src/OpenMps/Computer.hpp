@@ -4,7 +4,17 @@
 
 #pragma warning(push, 0)
 #include <vector>
+#include <array>
 #include <limits>
+#include <numeric>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -18,6 +28,7 @@
 #include <viennacl/vector.hpp>
 #include <viennacl/compressed_matrix.hpp>
 #include <viennacl/linalg/inner_prod.hpp>
+#include <viennacl/linalg/jacobi_precond.hpp>
 #endif
 #ifdef __clang__
 #pragma clang diagnostic pop
@@ -25,8 +36,18 @@
 #pragma warning(pop)
 
 #include "Particle.hpp"
+#include "ParticleArray.hpp"
 #include "Environment.hpp"
 #include "Grid.hpp"
+#include "PrefixSum.hpp"
+#include "Simd.hpp"
+#include "Preconditioner.hpp"
+#include "Amg.hpp"
+#include "ConjugateGradient.hpp"
+#include "MixedPrecision.hpp"
+#include "Timer.hpp"
+#include "Scheme.hpp"
+#include "Checkpoint.hpp"
 
 // iccはC++14の対応が遅れているので
 #ifdef __INTEL_COMPILER
@@ -37,20 +58,6 @@ namespace { namespace std
 }}
 #endif
 
-// OpenMP関連
-#ifdef _OPENMP
-	#ifdef _MSC_VER
-		#define OMP_PARALLEL_FOR __pragma(omp parallel for)
-	#else
-		#define OMP_PARALLEL_FOR _Pragma("omp parallel for")
-	#endif
-	#if _OPENMP < 200805 // v3.0未満の場合、反復変数は符号付きにしなければならない
-		#define SIGNED_LOOP_COUNTER
-	#endif
-#else
-	#define OMP_PARALLEL_FOR
-#endif
-
 namespace { namespace OpenMps
 {
 	// 近傍粒子との相互作用
@@ -86,7 +93,7 @@ namespace { namespace OpenMps
 			struct GetGetter<Name::X> final
 			{
 				template<typename PARTICLES>
-				static auto Get(const PARTICLES& particles, const std::ptrdiff_t j)
+				static decltype(auto) Get(const PARTICLES& particles, const std::ptrdiff_t j)
 				{
 					return particles[j].X();
 				}
@@ -95,7 +102,7 @@ namespace { namespace OpenMps
 			struct GetGetter<Name::U> final
 			{
 				template<typename PARTICLES>
-				static auto Get(const PARTICLES& particles, const std::ptrdiff_t j)
+				static decltype(auto) Get(const PARTICLES& particles, const std::ptrdiff_t j)
 				{
 					return particles[j].U();
 				}
@@ -104,7 +111,7 @@ namespace { namespace OpenMps
 			struct GetGetter<Name::P> final
 			{
 				template<typename PARTICLES>
-				static auto Get(const PARTICLES& particles, const std::ptrdiff_t j)
+				static decltype(auto) Get(const PARTICLES& particles, const std::ptrdiff_t j)
 				{
 					return particles[j].P();
 				}
@@ -113,7 +120,7 @@ namespace { namespace OpenMps
 			struct GetGetter<Name::N> final
 			{
 				template<typename PARTICLES>
-				static auto Get(const PARTICLES& particles, const std::ptrdiff_t j)
+				static decltype(auto) Get(const PARTICLES& particles, const std::ptrdiff_t j)
 				{
 					return particles[j].N();
 				}
@@ -122,7 +129,7 @@ namespace { namespace OpenMps
 			struct GetGetter<Name::Type> final
 			{
 				template<typename PARTICLES>
-				static auto Get(const PARTICLES& particles, const std::ptrdiff_t j)
+				static decltype(auto) Get(const PARTICLES& particles, const std::ptrdiff_t j)
 				{
 					return particles[j].TYPE();
 				}
@@ -166,8 +173,10 @@ namespace { namespace OpenMps
 				template<typename PARTICLES>
 				static auto Get(const PARTICLES& particles, const std::ptrdiff_t j, TUPLE getters)
 				{
+					// 参照で取得できる物理量は複製せずに参照のまま渡す
+					using Value = decltype(std::get<I>(getters)(particles, j));
 					return std::tuple_cat(
-						std::make_tuple(std::get<I>(getters)(particles, j)),
+						std::tuple<Value>(std::get<I>(getters)(particles, j)),
 						GetArg<TUPLE, I+1>::Get(particles, j, getters));
 				}
 			};
@@ -186,7 +195,7 @@ namespace { namespace OpenMps
 		struct Invoker<FUNC, TUPLE, I, true> final
 		{
 			template<typename... ARGS>
-			static auto Invoke(TUPLE, FUNC func, ARGS... args)
+			static auto Invoke(TUPLE, FUNC func, ARGS&&... args)
 			{
 				return func(std::forward<ARGS>(args)...);
 			}
@@ -195,7 +204,7 @@ namespace { namespace OpenMps
 		struct Invoker<FUNC, TUPLE, I, false> final
 		{
 			template<typename... ARGS>
-			static auto Invoke(TUPLE tuple, FUNC func, ARGS... args)
+			static auto Invoke(TUPLE tuple, FUNC func, ARGS&&... args)
 			{
 				return Invoker<FUNC, TUPLE, I + 1>::Invoke(tuple, func, std::forward<ARGS>(args)..., std::get<I>(tuple));
 			}
@@ -213,16 +222,17 @@ namespace { namespace OpenMps
 		}
 	}
 
-#ifdef MPS_GC
 	// GC向け
 	namespace Detail
 	{
 		// 修正行列
-		using CorrectiveMatrix = boost::numeric::ublas::c_matrix<double, DIM, DIM>;
+		// @tparam D 次元
+		template<std::size_t D = DIM>
+		using CorrectiveMatrix = boost::numeric::ublas::c_matrix<double, D, D>;
 
 		namespace Detail
 		{
-			template<decltype(DIM) D>
+			template<std::size_t D>
 			struct CreateMatrix;
 
 			template<>
@@ -232,7 +242,7 @@ namespace { namespace OpenMps
 					double, double,
 					double, double> val)
 				{
-					CorrectiveMatrix mat;
+					CorrectiveMatrix<2> mat;
 					mat(0, 0) = std::get<0>(val);
 					mat(0, 1) = std::get<1>(val);
 					mat(1, 0) = std::get<2>(val);
@@ -261,7 +271,7 @@ namespace { namespace OpenMps
 					double, double, double,
 					double, double, double> val)
 				{
-					CorrectiveMatrix mat;
+					CorrectiveMatrix<3> mat;
 					mat(0, 0) = std::get<0>(val);
 					mat(0, 1) = std::get<1>(val);
 					mat(0, 2) = std::get<2>(val);
@@ -291,28 +301,37 @@ namespace { namespace OpenMps
 
 
 		// 行列を作成する
+		// ※次元は成分の数から決まる
 		template<typename T, typename... ARGS>
 		inline auto CreateMatrix(const T val, const ARGS... args)
 		{
-			return Detail::CreateMatrix<DIM>::Get(std::make_tuple(val, args...));
+			return Detail::CreateMatrix<(sizeof...(ARGS) + 1 == 2 * 2) ? 2 : 3>::Get(std::make_tuple(val, args...));
 		}
-		template<typename T>
+
+		// 全成分が同じ値の行列を作成する
+		// @tparam D 次元
+		template<std::size_t D = DIM, typename T>
 		inline auto CreateMatrix(const T val)
 		{
-			return Detail::CreateMatrix<DIM>::Get(val);
+			return Detail::CreateMatrix<D>::Get(val);
 		}
-		template<typename T>
+
+		// 単位行列の定数倍を作成する
+		// @tparam D 次元
+		template<std::size_t D = DIM, typename T>
 		inline auto IdentityMatrix(const T val)
 		{
-			return Detail::CreateMatrix<DIM>::Identity(val);
+			return Detail::CreateMatrix<D>::Identity(val);
 		}
 
 		// ゼロ行列
-		static const auto MatrixZero = CreateMatrix(0);
+		// @tparam D 次元
+		template<std::size_t D = DIM>
+		static const CorrectiveMatrix<D> MatrixZero = CreateMatrix<D>(0);
 
 		namespace Detail
 		{
-			template<decltype(DIM) D>
+			template<std::size_t D>
 			struct InvertMatrix;
 
 			template<>
@@ -326,7 +345,7 @@ namespace { namespace OpenMps
 					return a * d - b * c;
 				}
 
-				static auto Get(CorrectiveMatrix&& mat, const double val)
+				static auto Get(CorrectiveMatrix<2>&& mat, const double val)
 				{
 					const auto a = mat(0, 0); const auto b = mat(0, 1);
 					const auto c = mat(1, 0); const auto d = mat(1, 1);
@@ -337,7 +356,7 @@ namespace { namespace OpenMps
 
 					if (det == 0)
 					{
-						return IdentityMatrix(val);
+						return IdentityMatrix<2>(val);
 					}
 					else
 					{
@@ -367,7 +386,7 @@ namespace { namespace OpenMps
 						- a02 * a11 * a20;
 				}
 
-				static auto Get(CorrectiveMatrix&& mat, const double val)
+				static auto Get(CorrectiveMatrix<3>&& mat, const double val)
 				{
 					const auto a00 = mat(0, 0); const auto a01 = mat(0, 1); const auto a02 = mat(0, 2);
 					const auto a10 = mat(1, 0); const auto a11 = mat(1, 1); const auto a12 = mat(1, 2);
@@ -380,7 +399,7 @@ namespace { namespace OpenMps
 
 					if (det == 0)
 					{
-						return IdentityMatrix(val);
+						return IdentityMatrix<3>(val);
 					}
 					else
 					{
@@ -424,15 +443,18 @@ namespace { namespace OpenMps
 		}
 
 		// 逆行列を求める
-		inline auto InvertMatrix(CorrectiveMatrix&& mat, const double val)
+		// @tparam D 次元
+		template<std::size_t D>
+		inline auto InvertMatrix(CorrectiveMatrix<D>&& mat, const double val)
 		{
-			return Detail::InvertMatrix<DIM>::Get(std::move(mat), val);
+			return Detail::InvertMatrix<D>::Get(std::move(mat), val);
 		}
 	}
-#endif
 
 	// MPS法による計算空間
-	template<typename POSITION_WALL, typename POSITION_WALL_PRE>
+	// @tparam SCHEME 計算手法の組み合わせ（SchemeかDynamicScheme）
+	// @tparam DIM 次元
+	template<typename POSITION_WALL, typename POSITION_WALL_PRE, typename SCHEME = DefaultScheme, std::size_t DIM = OpenMps::DIM>
 	class Computer final
 	{
 #ifdef TEST_CONSTRUCTOR
@@ -459,22 +481,77 @@ namespace { namespace OpenMps
 #ifdef TEST_NEIGHBORDENSITYVARIATION
 	friend class NeighborDensityVariationTest;
 #endif
+#ifdef TEST_REORDER
+	friend class ReorderTest;
+#endif
+
+	public:
+		using Vector = OpenMps::Vector<DIM>;
+		using Particle = OpenMps::Particle<DIM>;
+		using Environment = OpenMps::Environment<DIM>;
+		using Grid = OpenMps::Grid<DIM>;
+		using ParticleArray = OpenMps::ParticleArray<DIM>;
+
+		// 1時間刻みの計算の統計
+		struct Telemetry
+		{
+			// 1時間刻みの計算時間[s]
+			double stepTime;
+
+#ifndef PRESSURE_EXPLICIT
+			// 圧力方程式の反復回数
+			std::size_t iterationCount;
+
+			// 圧力方程式の初期残差（残差ベクトルの2ノルム）
+			double initialResidual;
+
+			// 圧力方程式の最終残差（残差ベクトルの2ノルム）
+			double finalResidual;
+
+			// 圧力方程式を作成した時間[s]
+			double assemblyTime;
+
+			// 圧力方程式を解いた時間[s]
+			double solveTime;
+#endif
+		};
 
 	private:
 		// 粒子リスト
-		std::vector<Particle> particles;
+		ParticleArray particles;
+
+		// 各粒子の元の粒子番号（追加した順番）
+		std::vector<std::size_t> originalId;
+
+		// 元の粒子番号から今の粒子番号への対応
+		std::vector<std::size_t> currentId;
 
 		// 計算空間のパラメーター
 		Environment environment;
 
+		// 計算手法の組み合わせ
+		const SCHEME scheme;
+
 		// 近傍粒子探索用のグリッド
 		Grid grid;
 
-		// 近傍粒子リスト
-		boost::multi_array<std::size_t, 2> neighbor;
+		// 近傍粒子番号（メモリ削減のため32ビット）
+		using NeighborIndex = std::uint32_t;
 
-		// 近傍粒子番号
-		using NeighborIndex = typename decltype(neighbor)::index;
+		// 各粒子の近傍粒子リストの先頭位置（末尾には全近傍粒子数が入る）
+		std::vector<std::size_t> neighborStart;
+
+		// 全粒子の近傍粒子を粒子番号順に詰めたリスト
+		std::vector<NeighborIndex> neighbor;
+
+		// 近傍粒子リストを使い回すかどうか
+		bool reuseNeighbor;
+
+		// 近傍粒子探索をした時の各粒子の位置（使い回す時のみ保持する）
+		std::vector<Vector> searchedX;
+
+		// 近傍粒子探索をした回数
+		std::size_t searchCount;
 
 #ifndef PRESSURE_EXPLICIT
 		// 圧力方程式
@@ -487,9 +564,6 @@ namespace { namespace OpenMps
 
 			// 線形方程式用の多次元ベクトル
 			using LongVector = viennacl::vector<double>;
-
-			// CPU用疎行列（係数行列の設定に使用）
-			using TempMatrix = boost::numeric::ublas::compressed_matrix<double>;
 #else
 			// 線形方程式用の疎行列
 			using Matrix = boost::numeric::ublas::compressed_matrix<double>;
@@ -521,18 +595,138 @@ namespace { namespace OpenMps
 
 				// 係数行列と探索方向ベクトルの積
 				LongVector Ap;
+
+				// 前処理後の残差ベクトル
+				LongVector z;
+
+				// 係数行列と前処理後の残差ベクトルの積（Chronopoulos-Gear法で使用）
+				LongVector Az;
 			} cg;
 
+			// 共役勾配法の種類
+			ConjugateGradientMethod method;
+
+			// 前処理の種類
+			Preconditioner preconditioner;
+
+			// 前処理用
+			struct Preconditioning
+			{
+				// CPU側の係数行列（不完全コレスキー分解と対称SOR法と代数的マルチグリッド法で使用）
+				// ※ViennaCLの時は、係数行列を作成する時にここへ作ってからデバイス側に複製する
+				Detail::Preconditioning::Csr A;
+
+				// 対角スケーリング
+				Detail::Preconditioning::Jacobi jacobi;
+
+				// 不完全コレスキー分解
+				Detail::Preconditioning::IncompleteCholesky ic;
+
+				// 対称SOR法
+				Detail::Preconditioning::Ssor ssor;
+
+				// 代数的マルチグリッド法
+				Detail::Preconditioning::Amg amg;
+
+				// 代数的マルチグリッド法の階層を作り直す間隔（時間刻みの回数、0なら毎回）
+				// ※間の時間刻みでは、集約と補間行列を使い回して係数行列に関する部分だけ作り直す
+				std::size_t amgSetupInterval;
+
+				// 代数的マルチグリッド法の階層を作り直してから使い回した回数
+				std::size_t amgReuseCount;
+
+				// CPU側で前処理する時の残差ベクトル（ViennaCLの時と、単精度で解く時に使用）
+				Detail::Preconditioning::LongVector r;
+
+				// CPU側で前処理する時の前処理後の残差ベクトル（ViennaCLの時と、単精度で解く時に使用）
+				Detail::Preconditioning::LongVector z;
+
 #ifdef USE_VIENNACL
-			// CPU用疎行列（係数行列の設定に使用）
-			TempMatrix tempA;
+				// 対角スケーリング（ViennaCL付属のもの）
+				std::unique_ptr<viennacl::linalg::jacobi_precond<Matrix>> deviceJacobi;
 #endif
+			} preconditioning;
 
-#ifdef _OPENMP
-			// 係数行列生成時の使用する行列・ベクトル
-			using A_ij = std::pair<std::size_t, double>;
-			using Row = std::vector<A_ij>;
-			std::vector<Row> a_ij;
+			// 内側の共役勾配法を単精度で解き、外側で倍精度の反復改良をするかどうか
+			bool mixedPrecision;
+
+			// 単精度で解く時用
+			struct SinglePrecision
+			{
+				// 係数行列
+				Detail::MixedPrecision::Csr A;
+
+				// 対角成分の逆数（対角スケーリング用）
+				Detail::MixedPrecision::Vector invDiagonal;
+
+				// 右辺（倍精度で計算した残差）
+				Detail::MixedPrecision::Vector b;
+
+				// 解（倍精度の解の修正量）
+				Detail::MixedPrecision::Vector x;
+
+				// 残差ベクトル
+				Detail::MixedPrecision::Vector r;
+
+				// 探索方向ベクトル
+				Detail::MixedPrecision::Vector p;
+
+				// 係数行列と探索方向ベクトルの積
+				Detail::MixedPrecision::Vector Ap;
+
+				// 前処理後の残差ベクトル
+				Detail::MixedPrecision::Vector z;
+			} single;
+
+			// これまでに共役勾配法で反復した回数
+			std::size_t iterationCount;
+
+			// 共役勾配法の最大反復回数（0なら未知数の数）
+			std::size_t maxIteration;
+
+			// 係数行列生成時の各行の先頭位置（末尾には全非零成分数が入る）
+			std::vector<std::size_t> rowStart;
+
+			// 各粒子の未知数の番号（未知数を持つ粒子だけを詰めた番号で、末尾には未知数の数が入る）
+			std::vector<std::size_t> unknownIndex;
+
+			// 各未知数の粒子番号
+			std::vector<std::size_t> unknownParticle;
+
+			// 係数行列の非零成分の位置を作った時の近傍粒子探索の回数（使い回せない時はInvalidPattern()）
+			std::size_t patternSearchCount;
+
+			// 係数行列を作らずに、係数行列とベクトルの積を近傍粒子から直接計算するかどうか
+			bool matrixFree;
+
+			// 対角項（係数行列を作らない時と、対角スケーリングの前処理で使う）
+			std::vector<double> diagonal;
+
+			// 未知数の初期値の決め方
+			InitialGuess initialGuess;
+
+			// 収束判定で残差と比べる基準
+			ResidualReference residualReference;
+
+			// 過去に解いた解（粒子番号順で新しい順、負圧も0にせずそのまま持つ）
+			std::array<std::vector<double>, 3> history;
+
+			// 過去に解いた時刻（新しい順）
+			std::array<double, 3> historyT;
+
+			// 持っている過去の解の数
+			std::size_t historyCount;
+
+#ifdef USE_VIENNACL
+			// 係数行列を作らない時に、CPU側で積を計算するためのベクトル
+			Detail::Preconditioning::LongVector hostV;
+			Detail::Preconditioning::LongVector hostAv;
+#endif
+
+#ifdef USE_VIENNACL
+			// デバイス側に渡す各行の先頭位置と列番号（ViennaCLの添字は32ビット）
+			std::vector<unsigned int> deviceRowStart;
+			std::vector<unsigned int> deviceColumn;
 #endif
 
 		} ppe;
@@ -541,20 +735,19 @@ namespace { namespace OpenMps
 		// 速度修正量
 		std::vector<Vector> du;
 
-#ifdef MPS_ECS
-		// 誤差修正量
+		// 誤差修正量（ECS法の時のみ）
 		std::vector<double> ecs;
+
+#ifndef PRESSURE_EXPLICIT
+		// 粒子数密度の瞬間増加速度(Dn/Dt)
+		std::vector<double> dndt;
 #endif
 
-#ifdef MPS_DS
-		// 移動前の位置
+		// 移動前の位置（DS法の時のみ）
 		std::vector<Vector> originalX;
-#endif
 
-#ifdef MPS_SPP
-		// SPP補正を入れない粒子数密度
+		// SPP補正を入れない粒子数密度（SPP法の時のみ）
 		std::vector<double> nWithoutSpp;
-#endif
 
 		// 壁の移動
 		const POSITION_WALL positionWall;
@@ -562,6 +755,30 @@ namespace { namespace OpenMps
 		// 壁の移動移動の前処理
 		const POSITION_WALL_PRE positionWallPre;
 
+		// 粒子を並べ替える間隔（時間刻みの回数、0なら並べ替えない）
+		std::size_t reorderInterval;
+
+		// 時間を進めた回数
+		std::size_t forwardCount;
+
+		// 直近の時間刻みの計算の統計
+		Telemetry telemetry;
+
+
+		// チェックポイントに書き出す計算手法の組み合わせ（手法毎のビット）
+		std::uint32_t CheckpointScheme() const
+		{
+			return (scheme.Hs ? 1u : 0u)
+				| (scheme.Hl ? 2u : 0u)
+				| (scheme.Ecs ? 4u : 0u)
+				| (scheme.Gc ? 8u : 0u)
+				| (scheme.Ds ? 16u : 0u)
+				| (scheme.Spp ? 32u : 0u)
+#ifdef PRESSURE_EXPLICIT
+				| 64u
+#endif
+				;
+		}
 
 		// 2点間の距離を計算する
 		// @param x1 点1
@@ -579,7 +796,6 @@ namespace { namespace OpenMps
 			return R(p1.X(), p2.X());
 		}
 
-#ifndef MPS_SPP
 		// 自由表面かどうかの判定
 		// @param n 粒子数密度
 		// @param n0 基準粒子数密度
@@ -588,28 +804,20 @@ namespace { namespace OpenMps
 		{
 			return n / n0 < surfaceRatio;
 		}
-#endif
 
 		// 近傍粒子数
 		// @param i 対象の粒子番号
-		auto& NeighborCount(const std::size_t i)
+		std::size_t NeighborCount(const std::size_t i) const
 		{
-			return neighbor[static_cast<NeighborIndex>(i)][0]; // 各行の先頭が近傍粒子数
-		}
-		auto NeighborCount(const std::size_t i) const
-		{
-			return neighbor[static_cast<NeighborIndex>(i)][0]; // 各行の先頭が近傍粒子数
+			return neighborStart[i + 1] - neighborStart[i];
 		}
 
 		// 近傍粒子番号
 		// @param i 対象の粒子番号
-		auto& Neighbor(const std::size_t i, const std::size_t idx)
-		{
-			return neighbor[static_cast<NeighborIndex>(i)][1 + static_cast<NeighborIndex>(idx)]; // 各行の先頭は近傍粒子数なので
-		}
-		auto Neighbor(const std::size_t i, const std::size_t idx) const
+		// @param idx 近傍粒子の中での番号
+		std::size_t Neighbor(const std::size_t i, const std::size_t idx) const
 		{
-			return neighbor[static_cast<NeighborIndex>(i)][1 + static_cast<NeighborIndex>(idx)]; // 各行の先頭は近傍粒子数なので
+			return neighbor[neighborStart[i] + idx];
 		}
 
 		// 近傍粒子との相互作用を計算する
@@ -634,9 +842,7 @@ namespace { namespace OpenMps
 			const auto r_e = environment.R_e;
 			const auto r_e2 = r_e * r_e;
 
-#ifdef MPS_SPP
-			auto dx_g = VectorZero; // 近傍粒子の重心位置ベクトル
-#endif
+			auto dx_g = VectorZero<DIM>; // 近傍粒子の重心位置ベクトル（SPP法の時のみ）
 
 			// 他の粒子に対して
 			const auto n = NeighborCount(i);
@@ -655,68 +861,152 @@ namespace { namespace OpenMps
 					{
 						// 近傍粒子を生成する時に無効粒子と自分自身は除外されているので特になにもしない
 						sum += Detail::Invoke(Detail::Field::Get(particles, j, getter), func);
-#ifdef MPS_SPP
-						dx_g += Particle::W(std::sqrt(r2), r_e) * dx;
-#endif
+						if(scheme.Spp)
+						{
+							dx_g += Particle::W(std::sqrt(r2), r_e) * dx;
+						}
 					}
 				}
 			}
 
-#ifdef MPS_SPP
 			// SPP粒子に対して
+			Vector x_spp;
+			if(scheme.Spp && SppPosition(i, dx_g, x_spp))
 			{
-				const auto thisN = nWithoutSpp[i];
-				const auto n0 = environment.N0();
-				dx_g /= n0;
+				auto p_spp = Particle(Particle::Type::IncompressibleNewton);
+				p_spp.X() = x_spp;
+				p_spp.U() = particles[i].U();
+
+				auto&& particles_spp = std::array<Particle, 2>{std::move(p_spp), Particle(Particle::Type::Dummy)};
+				constexpr auto getter_spp = Detail::Field::GetGetters<Particle*, FIELDS...>();
+				constexpr auto SPP_INDEX = std::ptrdiff_t{ -1 }; // SPP粒子の番号を負にしておくことで、SPP粒子を計算から除外するなどの判定が可能にする
+				sum += Detail::Invoke(Detail::Field::Get(particles_spp.data() + 1, SPP_INDEX, getter_spp), func);
+			}
+			return sum;
+		}
+
+		// 粒子数密度が基準粒子数密度より小さいかどうか
+		// ※SIMD計算では足し合わせる順番が変わるので、丸め誤差の範囲で等しいものは小さいとみなさない
+		// @param thisN SPPを含まない粒子数密度
+		bool IsLessThanN0(const double thisN) const
+		{
+			const auto n0 = environment.N0();
+			return thisN < n0 * (1 - 1e-12);
+		}
+
+		// SPP粒子の位置を計算する
+		// @param i 対象の粒子番号
+		// @param dx_g 近傍粒子の重心位置ベクトル（Σw dx）
+		// @param x_spp SPP粒子の位置
+		// @return SPP粒子が存在するかどうか
+		bool SppPosition(const std::size_t i, Vector dx_g, Vector& x_spp) const
+		{
+			const auto thisN = nWithoutSpp[i];
+			const auto n0 = environment.N0();
+			dx_g /= n0;
 
-				// 基準粒子数密度以上ならSPPの重みはゼロなのでなにもしない
-				if (thisN < n0)
+			// 基準粒子数密度以上ならSPPの重みはゼロなのでなにもしない
+			if (IsLessThanN0(thisN))
+			{
+				const auto r_g = std::sqrt(boost::numeric::ublas::inner_prod(dx_g, dx_g));
+				if (r_g > std::numeric_limits<double>::epsilon()) // 周囲に粒子が全く存在しない場合（0除算回避）
 				{
-					const auto r_g = std::sqrt(boost::numeric::ublas::inner_prod(dx_g, dx_g));
-					if (r_g > std::numeric_limits<double>::epsilon()) // 周囲に粒子が全く存在しない場合（0除算回避）
-					{
-						const auto w_spp = n0 - thisN;
-						const auto r_spp = r_e / (w_spp + 1);
+					const auto w_spp = n0 - thisN;
+					const auto r_spp = environment.R_e / (w_spp + 1);
+
+					x_spp = particles[i].X() - (r_spp / r_g) * dx_g;
+					return true;
+				}
+			}
+			return false;
+		}
 
-						const Vector x_spp = thisX - (r_spp / r_g) * dx_g;
+		// 影響半径内の近傍粒子をSIMD計算用に並べる
+		// @param i 対象の粒子番号
+		// @param batch 格納先
+		// @param func 近傍粒子の番号を受け取り、追加の値を格納する関数
+		template<typename FUNC>
+		void GatherNeighbor(const std::size_t i, Detail::Simd::Batch<DIM>& batch, const FUNC func) const
+		{
+			batch.Clear();
 
-						auto p_spp = Particle(Particle::Type::IncompressibleNewton);
-						p_spp.X() = x_spp;
-						p_spp.U() = particles[i].U();
+			const auto r_e = environment.R_e;
+			const auto r_e2 = r_e * r_e;
 
-						auto&& particles_spp = std::array<Particle, 2>{std::move(p_spp), Particle(Particle::Type::Dummy)};
-						constexpr auto getter_spp = Detail::Field::GetGetters<Particle*, FIELDS...>();
-						constexpr auto SPP_INDEX = std::ptrdiff_t{ -1 }; // SPP粒子の番号を負にしておくことで、SPP粒子を計算から除外するなどの判定が可能にする
-						sum += Detail::Invoke(Detail::Field::Get(particles_spp.data() + 1, SPP_INDEX, getter_spp), func);
-					}
+			const auto n = NeighborCount(i);
+			const auto& thisX = particles[i].X();
+			for(auto idx = decltype(n){0}; idx < n; idx++)
+			{
+				const auto j = Neighbor(i, idx);
+
+				// 影響半径内のみ
+				const Vector dx = particles[j].X() - thisX;
+				const auto r2 = boost::numeric::ublas::inner_prod(dx, dx);
+				if(r2 < r_e2)
+				{
+					batch.Add(dx, r2);
+					func(j);
 				}
 			}
-#endif
-			return sum;
 		}
 
 		// 近傍粒子探索
 		void SearchNeighbor()
 		{
-			// 全消去（TODO: 全消去じゃない形に）
-			grid.Clear();
-
 			// グリッドに格納
 			const auto n = particles.size();
-			for(auto i = decltype(n){0}; i < n; i++)
+			grid.Store(n,
+				[this](const auto i) -> const Vector&
+				{
+					return particles[i].X();
+				},
+				[this](const auto i)
+				{
+					// 無効粒子は格納しない
+					return particles[i].TYPE() != Particle::Type::Disabled;
+				});
+
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
 			{
-				// 無効粒子は格納しない
-				if(particles[i].TYPE() != Particle::Type::Disabled)
+#endif
+				// 格納されなかった時は領域外なので無効化する
+				if((particles[i].TYPE() != Particle::Type::Disabled) && !grid.IsStored(i))
 				{
-					// 格納に失敗した時は領域外なので無効化する
-					const bool ok = grid.Store(particles[i].X(), i);
-					if(!ok)
-					{
-						particles[i].Disable();
-					}
+					particles[i].Disable();
 				}
 			}
 
+			// 近傍粒子を数えて、各粒子のリストの先頭位置を決める
+			// ※数える時と格納する時で同じ判定をするので、2回とも同じ近傍粒子になる
+			neighborStart.resize(n + 1);
+			neighborStart[0] = 0;
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				auto count = std::size_t{0};
+				ForEachNearParticle(i, [&count](const auto)
+				{
+					count++;
+				});
+
+				// 先頭位置は累積和で求めるので、ひとつ後ろに数えておく
+				neighborStart[i + 1] = count;
+			}
+			Detail::PrefixSum(neighborStart);
+			neighbor.resize(neighborStart[n]);
+
 			// 近傍粒子を格納
 			OMP_PARALLEL_FOR
 #ifdef SIGNED_LOOP_COUNTER
@@ -727,62 +1017,220 @@ namespace { namespace OpenMps
 			for (auto i = decltype(n){0}; i < n; i++)
 			{
 #endif
-				// 無効粒子は除く
-				if(particles[i].TYPE() != Particle::Type::Disabled)
+				auto idx = neighborStart[i];
+				ForEachNearParticle(i, [this, &idx](const auto j)
+				{
+					neighbor[idx] = static_cast<NeighborIndex>(j);
+					idx++;
+				});
+			}
+
+			// 使い回す時は、どれだけ動いたかを調べるために今の位置を保存
+			if(reuseNeighbor)
+			{
+				searchedX.resize(n);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
 				{
-					auto idx = decltype(i){0};
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					searchedX[i] = particles[i].X();
+				}
+			}
+			searchCount++;
+		}
+
+		// 近傍粒子探索が必要かどうか
+		// ※探索時より近づいた分だけ近傍粒子半径の余裕が減るので、
+		// 　2粒子の移動距離とこれから1ステップの移動距離の和が余裕を超えそうなら探索し直す
+		bool NeedsSearchNeighbor() const
+		{
+			const auto n = particles.size();
+
+			// 使い回さない時と、粒子の増減・並べ替えがあった時は必ず探索する
+			if(!reuseNeighbor || (searchedX.size() != n))
+			{
+				return true;
+			}
 
-					const auto&& begin = grid.cbegin(particles[i].X());
-					const auto&& end = grid.cend();
-					for(auto it = std::move(begin); !(it == end); ++it)
+			// 探索時からの最大移動距離
+			// ※スレッド数で区切った範囲毎の最大値を求めてから合わせる（reduction(max)はOpenMP 2.0で使えないため）
+#ifdef _OPENMP
+			const auto blockCount = static_cast<std::size_t>(::omp_get_max_threads());
+#else
+			const auto blockCount = std::size_t{1};
+#endif
+			std::vector<double> blockMaxDx2(blockCount, 0.0);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto bb = std::make_signed_t<decltype(blockCount)>{0}; bb < static_cast<std::make_signed_t<decltype(blockCount)>>(blockCount); bb++)
+			{
+				const auto b = static_cast<decltype(blockCount)>(bb);
+#else
+			for (auto b = decltype(blockCount){0}; b < blockCount; b++)
+			{
+#endif
+				auto maxDx2 = 0.0;
+				for(auto i = n * b / blockCount; i < n * (b + 1) / blockCount; i++)
+				{
+					if(particles[i].TYPE() != Particle::Type::Disabled)
 					{
-						const auto j = *it;
+						const Vector dx = particles[i].X() - searchedX[i];
+						maxDx2 = std::max(maxDx2, boost::numeric::ublas::inner_prod(dx, dx));
+					}
+				}
+				blockMaxDx2[b] = maxDx2;
+			}
+			const auto maxDx2 = *std::max_element(blockMaxDx2.cbegin(), blockMaxDx2.cend());
+
+			const auto skin = environment.NeighborLength - environment.R_e;
+			return (std::sqrt(maxDx2) + environment.MaxDx)*2 >= skin;
+		}
+
+		// 近傍粒子半径内にある粒子それぞれに対して処理をする
+		// @param i 対象の粒子番号
+		// @param func 近傍粒子番号を受け取る関数
+		template<typename FUNC>
+		void ForEachNearParticle(const std::size_t i, FUNC func) const
+		{
+			// 無効粒子は除く
+			if(particles[i].TYPE() != Particle::Type::Disabled)
+			{
+				const auto&& begin = grid.cbegin(particles[i].X());
+				const auto&& end = grid.cend();
+				for(auto it = std::move(begin); !(it == end); ++it)
+				{
+					const auto j = *it;
 
-						// 自分自身と無効粒子は除外
-						if((j != i) && (particles[j].TYPE() != Particle::Type::Disabled))
+					// 自分自身と無効粒子は除外
+					if((j != i) && (particles[j].TYPE() != Particle::Type::Disabled))
+					{
+						// 半径内なら近傍粒子とする
+						const auto r = R(particles[i].X(), particles[j].X());
+						if(r < environment.NeighborLength)
 						{
-							// 半径内なら近傍粒子とする
-							const auto r = R(particles[i], particles[j]);
-							if(r < environment.NeighborLength)
-							{
-								Neighbor(i, idx) = j;
-								idx++;
-							}
+							func(j);
 						}
 					}
-
-					NeighborCount(i) = idx;
 				}
 			}
 		}
 
+		// 粒子を空間的に並べ替える
+		// ※近傍粒子が配列上でも近くに並ぶようにして、近傍粒子の参照でキャッシュに乗りやすくする
+		void ReorderParticles()
+		{
+			// 各粒子のブロックのモートン符号を並べ替えの鍵にする
+			const auto n = particles.size();
+			std::vector<std::uint64_t> key(n);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				// 無効粒子は末尾に寄せる
+				key[i] = (particles[i].TYPE() == Particle::Type::Disabled) ?
+					std::numeric_limits<std::uint64_t>::max() :
+					grid.MortonCode(particles[i].X());
+			}
+
+			// 同じブロック内は今の順番を保つ
+			std::vector<std::size_t> order(n);
+			std::iota(order.begin(), order.end(), std::size_t{0});
+			std::stable_sort(order.begin(), order.end(),
+				[&key](const auto i, const auto j)
+				{
+					return key[i] < key[j];
+				});
+
+			// 粒子と、粒子毎の値を全て並べ替える
+			particles.Permute(order);
+			Detail::Permute(originalId, order);
+			Detail::Permute(du, order);
+			if(scheme.Ecs)
+			{
+				Detail::Permute(ecs, order);
+			}
+#ifndef PRESSURE_EXPLICIT
+			Detail::Permute(dndt, order);
+#endif
+			if(scheme.Ds)
+			{
+				Detail::Permute(originalX, order);
+			}
+			if(scheme.Spp)
+			{
+				Detail::Permute(nWithoutSpp, order);
+			}
+#ifndef PRESSURE_EXPLICIT
+			for(auto k = decltype(ppe.historyCount){0}; k < ppe.historyCount; k++)
+			{
+				Detail::Permute(ppe.history[k], order);
+			}
+#endif
+			// ※圧力方程式の行列とベクトルは毎回粒子から作り直すので並べ替え不要（初期値に使う過去の解だけは並べ替える）
+
+			// 元の粒子番号からの対応を更新
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+				currentId[originalId[i]] = i;
+			}
+
+			// 粒子番号が変わったので、近傍粒子リストは作り直す
+			searchedX.clear();
+#ifndef PRESSURE_EXPLICIT
+
+			// 集約も粒子番号で持っているので、代数的マルチグリッド法の階層も作り直す
+			ppe.preconditioning.amgReuseCount = ppe.preconditioning.amgSetupInterval;
+#endif
+		}
+
 		// 時間刻みを決定する
 		auto DetermineDt()
 		{
 			namespace ublas = boost::numeric::ublas;
 
 			// 最大速度を取得
-			const auto maxUParticle = *std::max_element(particles.cbegin(), particles.cend(),
-				[](const Particle& base, const Particle& target)
+			auto maxU2 = 0.0;
+			for(const auto& particle : particles)
 			{
-				const auto& baseU = base.U();
-				const auto& targetU = target.U();
-				return (ublas::inner_prod(baseU, baseU) < ublas::inner_prod(targetU, targetU));
-			});
-			const auto maxU = ublas::norm_2(maxUParticle.U());
-
+				const auto& u = particle.U();
+				maxU2 = std::max(maxU2, ublas::inner_prod(u, u));
+			}
+			const auto maxU = std::sqrt(maxU2);
 
+#ifdef PRESSURE_EXPLICIT
+			// 陽解法では圧力波も粒子間を伝わるので、音速と流速の和でCFL条件を満たすように時間刻みを決定する
+			const auto dt = std::min(environment.MaxDx / (environment.C + maxU), environment.MaxDt);
+#else
 			// CFL条件より時間刻みを決定する
 			const auto dt = (maxU == 0 ? environment.MaxDt : std::min(environment.MaxDx / maxU, environment.MaxDt));
+#endif
 			return dt;
 		}
 
 		// 粒子数密度を計算する
+		// ※同じ近傍粒子の走査で粒子数密度の瞬間増加速度(Dn/Dt)も計算し、圧力方程式の生成項のために保存しておく
+		// ※陽解法では、代わりに状態方程式から圧力も計算する（圧力だけのために全粒子をもう1度読み書きしないようにする）
+		// @tparam WITH_ERROR_CORRECTION ECS法の誤差修正量も計算するかどうか
+		template<bool WITH_ERROR_CORRECTION = false>
 		void ComputeNeighborDensities()
 		{
 			const double r_e = environment.R_e;
-#ifdef MPS_SPP
 			const auto n0 = environment.N0();
+#ifdef PRESSURE_EXPLICIT
+			const auto c = environment.C;
+			const auto rho0 = environment.Rho;
+#else
+			const auto dt = environment.Dt();
 #endif
 
 			// 全粒子で
@@ -796,118 +1244,88 @@ namespace { namespace OpenMps
 			for (auto i = decltype(n){0}; i < n; i++)
 			{
 #endif
-				auto& particle = particles[i];
-#ifdef MPS_SPP
-				nWithoutSpp[i] = n0;
-#endif
+				auto&& particle = particles[i];
+				if(scheme.Spp)
+				{
+					nWithoutSpp[i] = n0;
+				}
 
 				// ダミー粒子と無効粒子を除く
 				if((particle.TYPE() != Particle::Type::Dummy) && (particle.TYPE() != Particle::Type::Disabled))
 				{
 					// 粒子数密度を計算する
-					const auto thisN = AccumulateNeighbor<
-#ifdef MPS_SPP
-						Detail::Field::Name::ID,
-#endif
-						Detail::Field::Name::X>(i, 0.0, [&thisX = particle.X(), &r_e](
-#ifdef MPS_SPP
-							const auto j,
-#endif
-							const auto& x)
+					// ※SPPは粒子数密度に加えない
+					auto& batch = Detail::Simd::ThreadBatch<DIM>();
+#ifndef PRESSURE_EXPLICIT
+					if(scheme.Hs)
 					{
-						return
-#ifdef MPS_SPP
-							// SPPは粒子数密度に加えない
-							(j < 0) ? 0 :
+						// HS法の瞬間増加速度のために速度差も並べておく
+						GatherNeighbor(i, batch, [this, &batch, &thisU = particle.U()](const auto j)
+						{
+							batch.AddVector(particles[j].U() - thisU);
+						});
+					}
+					else
 #endif
-							Particle::W(R(thisX, x), r_e);
-					});
+					{
+						GatherNeighbor(i, batch, [](const auto) {});
+					}
+					const auto thisN = Detail::Simd::SumWeight(batch, r_e);
 
-#ifdef MPS_SPP
-					nWithoutSpp[i] = thisN;
-					particle.N() = std::max(thisN, n0); // SPPによって粒子数密度が足りない時には充填される
-#else
-					particle.N() = thisN;
-#endif
-				}
-			}
-		}
-
-#if !defined(PRESSURE_EXPLICIT) || defined(MPS_ECS)
-		// 粒子数密度の瞬間増加速度(Dn/Dt)を計算する
-		// @param i 対象の粒子番号
-		auto NeighborDensityVariationSpeed(const std::size_t i)
-		{
-#ifdef MPS_HS
-			const auto r_e = environment.R_e;
-#ifdef MPS_SPP
-			const auto thisN = nWithoutSpp[i];
-			const auto n0 = environment.N0();
-#endif
-
-
-			// HS法（高精度生成項）：-r_eΣ r・u / |r|^3
-			const auto result  =
-#ifdef MPS_SPP
-				(thisN < n0) ? 0.0 : 
-#endif
+					if(scheme.Spp)
+					{
+						nWithoutSpp[i] = thisN;
+						particle.N() = std::max(thisN, n0); // SPPによって粒子数密度が足りない時には充填される
+					}
+					else
+					{
+						particle.N() = thisN;
+					}
 
-				-r_e * AccumulateNeighbor<Detail::Field::Name::X, Detail::Field::Name::U>(i, 0.0,
-				[&thisX = particles[i].X(), &thisU = particles[i].U()](const auto& x, const auto& u)
-			{
-				// ここは粒子数密度の計算なので、対ダミー粒子も含める
-				const Vector dx = x - thisX;
-				const Vector du = u - thisU;
-				const auto r = boost::numeric::ublas::norm_2(dx);
-				return boost::numeric::ublas::inner_prod(dx, du) / (r*r*r);
-			});
+#ifdef PRESSURE_EXPLICIT
+					// 状態方程式から圧力を計算する：c^2 (ρ-ρ0)（仮想的な密度ρ0/n0 * nが基準密度以下なら圧力は発生しない）
+					const auto rho = rho0 / n0 * particle.N();
+					particle.P() = (rho <= rho0) ? 0 : c*c*(rho - rho0);
 #else
-			const auto n0 = environment.N0();
-			const auto dt = environment.Dt();
-			const auto thisN = particles[i].N();
+					// 粒子数密度の瞬間増加速度を計算する
+					auto speed = 0.0;
+					if(scheme.Hs)
+					{
+						// HS法（高精度生成項）：-r_eΣ r・u / |r|^3
+						// ※ここは粒子数密度の計算なので、対ダミー粒子も含める
+						// ※SPP法で粒子数密度が足りない時は0
+						if(!(scheme.Spp && IsLessThanN0(thisN)))
+						{
+							speed = -r_e * Detail::Simd::SumDivergenceHS(batch);
+						}
+					}
+					else
+					{
+						// 標準MPS法：b_i = (n_i - n0)/Δt
+						speed = (particle.N() - n0) / dt;
+					}
+					dndt[i] = speed;
 
-			// 標準MPS法：b_i = (n_i - n0)/Δt
-			const auto result = (thisN - n0) / dt;
+					if(scheme.Ecs && WITH_ERROR_CORRECTION)
+					{
+						// ECS法の誤差修正項：α Dn/Dt + β (n-n0)/n0
+						// α=|(n-n0)/n0|
+						// β=|Dn/Dt|
+						const auto error = (particle.N() - n0) / n0;
+						ecs[i] = std::abs(error) * speed + std::abs(speed) * error;
+					}
 #endif
-			return result;
+				}
+			}
 		}
-#endif
 
-#ifdef MPS_ECS
-		// 誤差修正量を計算する
-		void ComputeErrorCorrection()
+#ifndef PRESSURE_EXPLICIT
+		// 粒子数密度の瞬間増加速度(Dn/Dt)を取得する
+		// ※直前のComputeNeighborDensitiesで計算した値
+		// @param i 対象の粒子番号
+		auto NeighborDensityVariationSpeed(const std::size_t i) const
 		{
-			const auto n0 = environment.N0();
-#ifndef MPS_SPP
-			const auto surfaceRatio = environment.SurfaceRatio;
-#endif
-
-			// 全粒子で
-			const auto n = particles.size();
-			OMP_PARALLEL_FOR
-#ifdef SIGNED_LOOP_COUNTER
-			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
-			{
-				const auto i = static_cast<decltype(n)>(ii);
-#else
-			for (auto i = decltype(n){0}; i < n; i++)
-			{
-#endif
-				const auto& particle = particles[i];
-
-				// ダミー粒子と無効粒子以外
-				if((particle.TYPE() != Particle::Type::Dummy) && (particle.TYPE() != Particle::Type::Disabled))
-				{
-					const auto thisN = particle.N();
-
-					// ECS法の誤差修正項：α Dn/Dt + β (n-n0)/n0
-					// α=|(n-n0)/n0|
-					// β=|Dn/Dt|
-					const auto speed = NeighborDensityVariationSpeed(i);
-					const auto error = (thisN - n0) / n0;
-					ecs[i] = std::abs(error) * speed + std::abs(speed) * error;
-				}
-			}
+			return dndt[i];
 		}
 #endif
 
@@ -916,16 +1334,14 @@ namespace { namespace OpenMps
 		{
 			const auto n0 = environment.N0();
 			const auto r_e = environment.R_e;
-#ifndef MPS_HL
 			const auto lambda = environment.Lambda();
-#endif
 			const auto nu = environment.Nu;
 			const auto t = environment.T();
 			const auto dt = environment.Dt();
 
 #ifdef CENTRAL_GRAVITY
 			const auto l_0 = environment.L_0;
-			const auto g = environment.G[AXIS_Z];
+			const auto g = environment.G[Axis<DIM>::Z];
 #else
 			const auto g = environment.G;
 #endif
@@ -944,45 +1360,52 @@ namespace { namespace OpenMps
 			for (auto i = decltype(n){0}; i < n; i++)
 			{
 #endif
-				auto& particle = particles[i];
+				auto&& particle = particles[i];
 
 				// 水粒子のみ
 				if(particle.TYPE() == Particle::Type::IncompressibleNewton)
 				{
 					// 粘性の計算
-					const auto vis = AccumulateNeighbor<Detail::Field::Name::U, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero,
-						[&thisX = particle.X(), &thisU = particle.U(), n0, r_e,
-#ifndef MPS_HL
-						lambda,
-#endif
-						nu](const auto& u, const auto& x, const auto type)
+					Vector vis;
+					if(scheme.Hl)
 					{
-						// ダミー粒子以外
-						if(type != Particle::Type::Dummy)
+						// HL法（高精度ラプラシアン）: ν(5-D)r_e/n0 Σ(u_j - u_i) / r^3
+						// ※SPP粒子の速度は自分と同じなので寄与しない
+						auto& batch = Detail::Simd::ThreadBatch<DIM>();
+						GatherNeighbor(i, batch, [this, &batch, &thisU = particle.U()](const auto j)
 						{
-							const auto r = R(thisX, x);
-#ifdef MPS_HL
-							// HL法（高精度ラプラシアン）: ν(5-D)r_e/n0 (u_j - u_i) / r^3
-							const Vector result = (nu * (5 - DIM) * r_e / n0 / (r*r*r)) * (u - thisU);
-#else
-							// 標準MPS法：ν*2D/λn0 (u_j - u_i) w
-							const double w = Particle::W(r, r_e);
-							const Vector result = (nu * 2 * DIM / lambda / n0 * w)*(u - thisU);
-#endif
-							return result;
-						}
-						else
+							batch.AddVector(particles[j].U() - thisU);
+							batch.AddCoefficient((particles[j].TYPE() != Particle::Type::Dummy) ? 1.0 : 0.0); // ダミー粒子以外
+						});
+						vis = (nu * (5 - DIM) * r_e / n0) * Detail::Simd::SumViscosityHL(batch);
+					}
+					else
+					{
+						vis = AccumulateNeighbor<Detail::Field::Name::U, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero<DIM>,
+							[&thisX = particle.X(), &thisU = particle.U(), n0, r_e, lambda, nu](const auto& u, const auto& x, const auto type)
 						{
-							return VectorZero;
-						}
-					});
+							// ダミー粒子以外
+							if(type != Particle::Type::Dummy)
+							{
+								// 標準MPS法：ν*2D/λn0 (u_j - u_i) w
+								const auto r = R(thisX, x);
+								const double w = Particle::W(r, r_e);
+								const Vector result = (nu * 2 * DIM / lambda / n0 * w)*(u - thisU);
+								return result;
+							}
+							else
+							{
+								return VectorZero<DIM>;
+							}
+						});
+					}
 
 					// 重力 + 粘性
 					a[i] = vis;
 #ifdef CENTRAL_GRAVITY
 					const auto x = particle.X();
 					const auto r = boost::numeric::ublas::norm_2(x);
-					const auto c = (r < l_0 * 0.01) ? VectorZero : (x/r); // 方向ベクトル（中心付近にいる場合はゼロ）
+					const auto c = (r < l_0 * 0.01) ? VectorZero<DIM> : (x/r); // 方向ベクトル（中心付近にいる場合はゼロ）
 					a[i] += g * c;
 #else
 					a[i] += g;
@@ -1013,7 +1436,7 @@ namespace { namespace OpenMps
 				// 壁の位置
 				else
 				{
-					const auto x = positionWall(i, t, dt);
+					const auto x = positionWall(originalId[i], t, dt); // 壁の位置は元の粒子番号で与える
 					const auto u = (particles[i].X() - x) / dt; // 速度は位置から微分
 					particles[i].X() = x;
 					particles[i].U() = u;
@@ -1021,15 +1444,14 @@ namespace { namespace OpenMps
 			}
 		}
 
-#ifdef MPS_DS
-		// 移動前の位置を保存しておく
+		// 移動前の位置を保存しておく（DS法の時のみ）
 		void SaveX()
 		{
 			// 全粒子で
 			const auto n = particles.size();
 			for(auto i = decltype(n){0}; i < n; i++)
 			{
-				auto& particle = particles[i];
+				auto&& particle = particles[i];
 
 				// ダミー粒子と無効粒子を除く
 				if((particle.TYPE() != Particle::Type::Dummy) && (particle.TYPE() != Particle::Type::Disabled))
@@ -1038,40 +1460,35 @@ namespace { namespace OpenMps
 				}
 			}
 		}
-#endif
 
 		// 陰的に解く部分（第ニ段階）を計算する
+		// ※陽解法では圧力は粒子数密度と一緒に計算済みなので、圧力勾配項だけを計算する
 		void ComputeImplicitForces()
 		{
+#ifndef PRESSURE_EXPLICIT
 			const auto n = particles.size();
-#ifdef PRESSURE_EXPLICIT
-			OMP_PARALLEL_FOR
-#ifdef SIGNED_LOOP_COUNTER
-			for (auto ii = std::make_signed_t<decltype(n)>{ 0 }; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
-			{
-				const auto i = static_cast<decltype(n)>(ii);
-#else
-			for (auto i = decltype(n){0}; i < n; i++)
-			{
-#endif
-				const auto c = environment.C;
-				const auto n0 = environment.N0();
-				const auto rho0 = environment.Rho;
+			Timer timer;
 
-				auto& particle = particles[i];
-
-				// 仮想的な密度：ρ0/n0 * n
-				const auto rho = rho0 / n0 * particle.N();
-
-				// 圧力の計算：c^2 (ρ-ρ0)（基準密度以下なら圧力は発生しない）
-				particle.P() = (rho <= rho0) ? 0 : c*c*(rho - rho0);
-			}
-#else
 			// 圧力方程式を設定
+			timer.Start();
 			SetPressurePoissonEquation();
+			telemetry.assemblyTime = timer.Time();
 
 			// 圧力方程式を解く
+			timer.Start();
 			SolvePressurePoissonEquation();
+			telemetry.solveTime = timer.Time();
+
+			// 次の時刻の初期値に使うなら、過去の解を1つずつずらして今回の解を入れる場所を空ける
+			const bool savesHistory = (ppe.initialGuess != InitialGuess::Pressure);
+			if(savesHistory)
+			{
+				std::rotate(ppe.history.begin(), ppe.history.end() - 1, ppe.history.end());
+				std::rotate(ppe.historyT.begin(), ppe.historyT.end() - 1, ppe.historyT.end());
+				ppe.history[0].resize(n);
+				ppe.historyT[0] = environment.T();
+				ppe.historyCount = std::min(ppe.historyCount + 1, ppe.history.size());
+			}
 
 			// 得た圧力を代入する
 			OMP_PARALLEL_FOR
@@ -1083,17 +1500,18 @@ namespace { namespace OpenMps
 			for (auto i = decltype(n){0}; i < n; i++)
 			{
 #endif
+				// 未知数を持たない自由表面等は0
+				const double p = IsPpeUnknown(i) ? ppe.x(ppe.unknownIndex[i]) : 0.0;
+				if(savesHistory)
+				{
+					ppe.history[0][i] = p;
+				}
+
 				// ダミー粒子と無効粒子は除く
 				if ((particles[i].TYPE() != Particle::Type::Dummy) && (particles[i].TYPE() != Particle::Type::Disabled))
 				{
 					// 負圧は圧力0
-					const double p = ppe.x(i);
-					particles[i].P() = ((p < 0)
-#ifndef MPS_SPP
-						// 自由表面も0
-						|| IsSurface(particles[i].N(), environment.N0(), environment.SurfaceRatio)
-#endif
-						) ? 0 : p;
+					particles[i].P() = (p < 0) ? 0 : p;
 				}
 			}
 #endif
@@ -1134,302 +1552,1114 @@ namespace { namespace OpenMps
 		}
 #endif
 
-		// 近傍粒子の最大個数
-		auto MaxNeighborCount()
+#ifndef PRESSURE_EXPLICIT
+		// 圧力方程式で未知数を持たない（方程式から除く）かどうか
+		// @param i 対象の粒子番号
+		bool IsPpeIdentityRow(const std::size_t i) const
 		{
-			// 1ブロックの最大個数 * 3^Dブロック
-			return grid.MaxParticles() * 3u*3u;
+			// ダミー粒子と無効粒子
+			// ※SPP法を使わない時は自由表面も
+			return (particles[i].TYPE() == Particle::Type::Dummy) || (particles[i].TYPE() == Particle::Type::Disabled)
+				|| (!scheme.Spp && IsSurface(particles[i].N(), environment.N0(), environment.SurfaceRatio));
+		}
+
+		// 使い回せる係数行列の非零成分の位置が無いことを表す値
+		static constexpr std::size_t InvalidPattern()
+		{
+			return std::numeric_limits<std::size_t>::max();
+		}
+
+		// 圧力方程式の係数行列の非対角項
+		// @param r 粒子間距離
+		double PpeCoefficient(const double r) const
+		{
+			const auto r_e = environment.R_e;
+			const auto n0 = environment.N0();
+			if(scheme.Hl)
+			{
+				// HL法（高精度ラプラシアン）: (5-D)r_e/n0 / r^3
+				return (5 - DIM) * r_e / n0 / (r*r*r);
+			}
+			else
+			{
+				// 標準MPS法：2D/(λn0) w
+				const double w = Particle::W(r, r_e);
+				return (2 * DIM / environment.Lambda() / n0) * w;
+			}
+		}
+
+		// 圧力方程式の係数行列の1行分を計算する
+		// @param i 粒子番号（未知数を持つもの）
+		// @param store 非対角項を格納する関数（相手の粒子番号と値を受け取る）
+		// @return 対角項
+		template<typename STORE>
+		double ComputePpeRow(const std::size_t i, const STORE store) const
+		{
+			const auto n0 = environment.N0();
+			const auto surfaceRatio = environment.SurfaceRatio;
+			return AccumulateNeighbor<Detail::Field::Name::N, Detail::Field::Name::ID, Detail::Field::Name::X, Detail::Field::Name::Type>(i, 0.0,
+			[this, &thisX = particles[i].X(), n0, surfaceRatio, &store](const auto n, const auto j, const auto& x, const auto type)
+			{
+				// ダミー粒子以外
+				if(type != Particle::Type::Dummy)
+				{
+					// 非対角項を計算
+					const auto a_ij = PpeCoefficient(R(thisX, x));
+
+					// SPPの場合（SPP法を使わない時は自由表面の場合）は非対角項は設定しない
+					if(scheme.Spp ? (j >= 0) : !IsSurface(n, n0, surfaceRatio))
+					{
+						store(static_cast<std::size_t>(j), a_ij);
+					}
+
+					return -a_ij;
+				}
+				else
+				{
+					return 0.0;
+				}
+			});
+		}
+
+		// 圧力方程式の未知数を持つかどうか（未知数の番号を振った後で使う）
+		// @param i 対象の粒子番号
+		bool IsPpeUnknown(const std::size_t i) const
+		{
+			return ppe.unknownIndex[i + 1] != ppe.unknownIndex[i];
 		}
 
-#ifndef PRESSURE_EXPLICIT
 		// 圧力方程式を設定する
+		// ※ダミー粒子と無効粒子（と自由表面）は圧力が決まっているので未知数から除き、
+		// 　未知数を持つ粒子だけを詰めた番号で方程式を作る
 		void SetPressurePoissonEquation()
 		{
 			const auto n0 = environment.N0();
 			const auto dt = environment.Dt();
-#ifndef MPS_SPP
 			const auto surfaceRatio = environment.SurfaceRatio;
-#endif
-			const auto r_e = environment.R_e;
 			const auto rho = environment.Rho;
-#ifndef MPS_HL
-			const auto lambda = environment.Lambda();
-#endif
 
 			// 粒子数を取得
 			const std::size_t n = particles.size();
 
-			// 粒子に増減があれば
-			if (n != ppe.b.size())
+			// 近傍粒子リストを使い回す時は、リスト内の全粒子を非零成分の位置にしておき、
+			// リストが変わるまでは位置（行の先頭位置と列番号）を使い回して値だけ書き換える
+			// ※影響半径の外にいる粒子や自由表面の粒子の成分は0にしておく
+			const auto reusesPattern = reuseNeighbor;
+			auto isPatternChanged = !reusesPattern || (ppe.patternSearchCount != searchCount);
+			auto& unknownIndex = ppe.unknownIndex;
+			auto& unknownParticle = ppe.unknownParticle;
+
+			// 未知数を持つ粒子が変わっていれば、非零成分の位置も作り直す
+			// ※SPPを使う時はダミー粒子と無効粒子しか除かないので、近傍粒子探索をしない限り変わらない
+			if(!isPatternChanged)
 			{
-				// サイズを変えて作り直し
-				ppe.A = typename Ppe::Matrix {n, n};
-				ppe.x = typename Ppe::LongVector(n);
-				ppe.b = typename Ppe::LongVector(n);
-				ppe.cg.r = typename Ppe::LongVector(n);
-				ppe.cg.p = typename Ppe::LongVector(n);
-				ppe.cg.Ap = typename Ppe::LongVector(n);
-
-#ifdef USE_VIENNACL
-				ppe.tempA = typename Ppe::TempMatrix(n, n);
+				if(unknownIndex.size() != n + 1)
+				{
+					isPatternChanged = true;
+				}
+				else
+				{
+					auto changedCount = std::size_t{0};
+#ifdef _OPENMP
+					#pragma omp parallel for reduction(+:changedCount)
+#endif
+#ifdef SIGNED_LOOP_COUNTER
+					for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+					{
+						const auto i = static_cast<decltype(n)>(ii);
+#else
+					for (auto i = decltype(n){0}; i < n; i++)
+					{
 #endif
+						if(IsPpeUnknown(i) == IsPpeIdentityRow(i))
+						{
+							changedCount++;
+						}
+					}
+					isPatternChanged = (changedCount > 0);
+				}
+			}
 
-#ifdef _OPENMP
-				ppe.a_ij.resize(n);
+			// 未知数を持つ粒子に詰めた番号を振る
+			// ※番号は、各粒子が未知数を持つかどうかをひとつ後ろに数えて累積和で求める
+			if(isPatternChanged)
+			{
+				unknownIndex.resize(n + 1);
+				unknownIndex[0] = 0;
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
 				for (auto i = decltype(n){0}; i < n; i++)
 				{
-					ppe.a_ij[i].reserve(MaxNeighborCount());
+#endif
+					unknownIndex[i + 1] = IsPpeIdentityRow(i) ? 0 : 1;
 				}
+				Detail::PrefixSum(unknownIndex);
+
+				unknownParticle.resize(unknownIndex[n]);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
 #endif
+					if(IsPpeUnknown(i))
+					{
+						unknownParticle[unknownIndex[i]] = i;
+					}
+				}
 			}
 
+			// 未知数の数を取得
+			const auto m = unknownParticle.size();
+
+			// 未知数の数が変われば（未知数が無くても、初回は行の先頭位置を確保する）
+			if ((m != ppe.b.size()) || (ppe.rowStart.size() != m + 1))
+			{
+				// サイズを変えて作り直し
+				ppe.A = typename Ppe::Matrix {m, m};
+				ppe.x = typename Ppe::LongVector(m);
+				ppe.b = typename Ppe::LongVector(m);
+				ppe.cg.r = typename Ppe::LongVector(m);
+				ppe.cg.p = typename Ppe::LongVector(m);
+				ppe.cg.Ap = typename Ppe::LongVector(m);
+				ppe.cg.z = typename Ppe::LongVector(m);
+				ppe.cg.Az = typename Ppe::LongVector(m);
+				ppe.rowStart.resize(m + 1);
+				isPatternChanged = true;
+			}
+
+			// 初期値を外挿する時の過去の各解の重み
+			std::array<double, 3> weights;
+			const auto historyCount = InitialGuessWeights(weights);
+
 			OMP_PARALLEL_FOR
 #ifdef SIGNED_LOOP_COUNTER
-			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			for (auto rr = std::make_signed_t<decltype(m)>{0}; rr < static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
 			{
-				const auto i = static_cast<decltype(n)>(ii);
+				const auto row = static_cast<decltype(m)>(rr);
 #else
-			for (auto i = decltype(n){0}; i < n; i++)
+			for (auto row = decltype(m){0}; row < m; row++)
 			{
 #endif
-				// ダミー粒子と無効粒子は0
-				if((particles[i].TYPE() == Particle::Type::Dummy) || (particles[i].TYPE() == Particle::Type::Disabled)
-#ifndef MPS_SPP
-					// 自由表面も0
-					|| IsSurface(particles[i].N(), n0, surfaceRatio)
-#endif
-					)
+				const auto i = unknownParticle[row];
+
+				// 生成項を計算する：ρ/n0 Δt -Dn/Dt
+				// ※ECS法では誤差修正項も加える
+				const auto speed = NeighborDensityVariationSpeed(i);
+				const auto e = scheme.Ecs ? ecs[i] : 0.0;
+				ppe.b(row) = -rho / (n0 * dt) * (speed + e);
+
+				// 過去の解を外挿して未知数ベクトルの初期値にする（過去の解が無ければ圧力）
+				auto x_i = (historyCount == 0) ? particles[i].P() : 0.0;
+				for(auto k = decltype(historyCount){0}; k < historyCount; k++)
 				{
-					ppe.b(i) = 0;
-					ppe.x(i) = 0;
+					x_i += weights[k] * ppe.history[k][i];
 				}
-				else
+				ppe.x(row) = x_i;
+			}
+
+			// 係数行列を作らない時は、対角項だけ計算しておく
+			if(ppe.matrixFree)
+			{
+				ppe.diagonal.resize(m);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto rr = std::make_signed_t<decltype(m)>{0}; rr < static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
 				{
-					// 生成項を計算する：ρ/n0 Δt -Dn/Dt
-					const auto speed = NeighborDensityVariationSpeed(i);
-#ifdef MPS_ECS
-					const auto e = ecs[i];
-					ppe.b(i) = -rho / (n0 * dt) * (speed + e);
+					const auto row = static_cast<decltype(m)>(rr);
 #else
-					ppe.b(i) = -rho / (n0 * dt) * speed;
+				for (auto row = decltype(m){0}; row < m; row++)
+				{
 #endif
-
-
-					// 圧力を未知数ベクトルの初期値にする
-					const auto x_i = particles[i].P();
-					ppe.x(i) = x_i;
+					const auto i = unknownParticle[row];
+					ppe.diagonal[row] = AccumulateNeighbor<Detail::Field::Name::X, Detail::Field::Name::Type>(i, 0.0,
+						[this, &thisX = particles[i].X()](const auto& x, const auto type)
+						{
+							// ダミー粒子以外（SPP粒子も含む）
+							return (type != Particle::Type::Dummy) ? -PpeCoefficient(R(thisX, x)) : 0.0;
+						});
 				}
+				return;
 			}
 
-			// 係数行列初期化
+			auto& rowStart = ppe.rowStart;
+
 #ifdef USE_VIENNACL
-			auto& A = ppe.tempA;
+			auto& hostA = ppe.preconditioning.A;
 #else
 			auto& A = ppe.A;
 #endif
-			A.clear();
 
-			// 全粒子で
+			if(isPatternChanged)
+			{
+				// 各行の非零成分の数を数える
+				// ※先頭位置は、各行の個数をひとつ後ろに数えて累積和で求める
+				rowStart[0] = 0;
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto rr = std::make_signed_t<decltype(m)>{0}; rr < static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
+				{
+					const auto row = static_cast<decltype(m)>(rr);
+#else
+				for (auto row = decltype(m){0}; row < m; row++)
+				{
+#endif
+					const auto i = unknownParticle[row];
+					if(reusesPattern)
+					{
+						// 未知数を持つ近傍粒子と対角項
+						const auto count = NeighborCount(i);
+						auto rowCount = std::size_t{1};
+						for(auto idx = decltype(count){0}; idx < count; idx++)
+						{
+							if(IsPpeUnknown(Neighbor(i, idx)))
+							{
+								rowCount++;
+							}
+						}
+						rowStart[row + 1] = rowCount;
+					}
+					else
+					{
+						// 非対角項と対角項
+						rowStart[row + 1] = 1 + AccumulateNeighbor<Detail::Field::Name::N, Detail::Field::Name::ID, Detail::Field::Name::Type>(i, std::size_t{0},
+						[n0, surfaceRatio, spp = scheme.Spp](const auto n, const auto j, const auto type)
+						{
+							// ダミー粒子以外で、SPP粒子でない（SPPを使わない時は自由表面でない）ものが非対角項を持つ
+							return ((type != Particle::Type::Dummy) &&
+								(spp ? (j >= 0) : !IsSurface(n, n0, surfaceRatio))) ? std::size_t{1} : std::size_t{0};
+						});
+					}
+				}
+				Detail::PrefixSum(rowStart);
+
+				// 格納先を確保
+				// ※ViennaCLならCPU側の係数行列（前処理でも使う）に、そうでなければublasの疎行列の内部配列に直接書き込む
+				const auto nonZeroCount = rowStart[m];
+#ifdef USE_VIENNACL
+				hostA.start = rowStart;
+				hostA.column.resize(nonZeroCount);
+				hostA.value.resize(nonZeroCount);
+#else
+				A.reserve(nonZeroCount, false);
+				std::copy(rowStart.cbegin(), rowStart.cend(), A.index1_data().begin());
+#endif
+			}
+			const auto nonZeroCount = rowStart[m];
+#ifdef USE_VIENNACL
+			const auto column = hostA.column.begin();
+			const auto value = hostA.value.begin();
+#else
+			const auto column = A.index2_data().begin();
+			const auto value = A.value_data().begin();
+#endif
+
+			// 使い回す位置を作り直す時は、列番号を先に詰めて並べておく
+			if(reusesPattern && isPatternChanged)
+			{
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto rr = std::make_signed_t<decltype(m)>{0}; rr < static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
+				{
+					const auto row = static_cast<decltype(m)>(rr);
+#else
+				for (auto row = decltype(m){0}; row < m; row++)
+				{
+#endif
+					const auto i = unknownParticle[row];
+					auto k = rowStart[row];
+					const auto count = NeighborCount(i);
+					for(auto idx = decltype(count){0}; idx < count; idx++)
+					{
+						const auto j = Neighbor(i, idx);
+						if(IsPpeUnknown(j))
+						{
+							column[k] = unknownIndex[j];
+							k++;
+						}
+					}
+					column[k] = row;
+					std::sort(column + rowStart[row], column + rowStart[row + 1]);
+				}
+			}
+
+			// 未知数を持つ全粒子で
+			// ※対角項は、対角スケーリングの前処理で係数行列を複製せずに済むよう別にも取っておく
+			auto& diagonal = ppe.diagonal;
+			diagonal.resize(m);
 			OMP_PARALLEL_FOR
 #ifdef SIGNED_LOOP_COUNTER
-			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			for (auto rr = std::make_signed_t<decltype(m)>{0}; rr < static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
 			{
-				const auto i = static_cast<decltype(n)>(ii);
+				const auto row = static_cast<decltype(m)>(rr);
 #else
-			for (auto i = decltype(n){0}; i < n; i++)
+			for (auto row = decltype(m){0}; row < m; row++)
 			{
 #endif
-#ifdef _OPENMP
-				auto& a_i = ppe.a_ij[i];
-				a_i.clear();
+				const auto i = unknownParticle[row];
+				const auto begin = rowStart[row];
+				const auto end = rowStart[row + 1];
+
+				if(reusesPattern)
+				{
+					// 値だけ書き換える
+					const auto position = [column, begin, end](const std::size_t j)
+					{
+						return std::lower_bound(column + begin, column + end, j) - column;
+					};
+					std::fill(value + begin, value + end, 0.0);
+
+					const auto a_ii = ComputePpeRow(i, [&value, &position, &unknownIndex](const std::size_t j, const double a_ij)
+					{
+						value[position(unknownIndex[j])] = a_ij;
+					});
+					value[position(row)] = a_ii;
+					diagonal[row] = a_ii;
+				}
+				else
+				{
+					// 非対角項を詰めながら対角項を計算
+					auto k = begin;
+					const auto a_ii = ComputePpeRow(i, [&column, &value, &k, &unknownIndex](const std::size_t j, const double a_ij)
+					{
+						column[k] = unknownIndex[j];
+						value[k] = a_ij;
+						k++;
+					});
+					column[k] = row;
+					value[k] = a_ii;
+					diagonal[row] = a_ii;
+
+					// 列番号順に並べる
+					// ※近傍粒子は粒子番号順にほぼ並んでいるので挿入ソートで十分
+					for(auto l = begin + 1; l < end; l++)
+					{
+						const auto c = column[l];
+						const auto v = value[l];
+						auto pos = l;
+						for(; (pos > begin) && (column[pos - 1] > c); pos--)
+						{
+							column[pos] = column[pos - 1];
+							value[pos] = value[pos - 1];
+						}
+						column[pos] = c;
+						value[pos] = v;
+					}
+				}
+			}
+			ppe.patternSearchCount = reusesPattern ? searchCount : InvalidPattern();
+
+#ifdef USE_VIENNACL
+			if(isPatternChanged)
+			{
+				hostA.FindDiagonal();
+
+				// 作成した係数行列をデバイス側に複製
+				ppe.deviceRowStart.resize(m + 1);
+				ppe.deviceColumn.resize(nonZeroCount);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto rr = std::make_signed_t<decltype(m)>{0}; rr <= static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
+				{
+					const auto row = static_cast<decltype(m)>(rr);
+#else
+				for (auto row = decltype(m){0}; row <= m; row++)
+				{
 #endif
-				// ダミー粒子と無効粒子は対角項だけ1
-				if((particles[i].TYPE() == Particle::Type::Dummy) || (particles[i].TYPE() == Particle::Type::Disabled)
-#ifndef MPS_SPP
-					// 自由表面も1
-					|| IsSurface(particles[i].N(), n0, surfaceRatio)
+					ppe.deviceRowStart[row] = static_cast<unsigned int>(rowStart[row]);
+					if(row < m)
+					{
+						for(auto k = rowStart[row]; k < rowStart[row + 1]; k++)
+						{
+							ppe.deviceColumn[k] = static_cast<unsigned int>(hostA.column[k]);
+						}
+					}
+				}
+				ppe.A.set(ppe.deviceRowStart.data(), ppe.deviceColumn.data(), hostA.value.data(), m, m, nonZeroCount);
+			}
+			else
+			{
+				// 位置は変わっていないので値だけデバイス側に書き込む
+				viennacl::backend::memory_write(ppe.A.handle(), 0, sizeof(double) * nonZeroCount, hostA.value.data());
+			}
+#else
+			if(isPatternChanged)
+			{
+				A.set_filled(m + 1, nonZeroCount);
+			}
 #endif
-)
+		}
+
+		// 前処理行列を作成する
+		void ComputePreconditioner()
+		{
+			auto& pre = ppe.preconditioning;
+
+			// 係数行列を作らない時は、対角項だけで済む対角スケーリングしかできない
+			if(ppe.matrixFree)
+			{
+				if(ppe.preconditioner != Preconditioner::None)
 				{
-#ifdef _OPENMP
-					a_i.emplace_back(i, 1.0);
+					pre.jacobi.Compute(ppe.diagonal);
+				}
+				return;
+			}
+
+			switch(ppe.preconditioner)
+			{
+			case Preconditioner::Jacobi:
+#ifdef USE_VIENNACL
+				pre.deviceJacobi = std::make_unique<viennacl::linalg::jacobi_precond<typename Ppe::Matrix>>(ppe.A, viennacl::linalg::jacobi_tag());
 #else
-					A(i, i) = 1.0;
+				pre.jacobi.Compute(ppe.diagonal);
+#endif
+				break;
+
+			case Preconditioner::IncompleteCholesky:
+			case Preconditioner::Ssor:
+			{
+				// ViennaCL付属の不完全コレスキー分解は平方根を使うので、対角成分が負のMPS法の係数行列には使えない
+				// そのため、どちらもCPU側の係数行列から作成する（ViennaCLなら係数行列の作成時に作られていて、ublasなら内部配列から並列に複製する）
+#ifndef USE_VIENNACL
+				ppe.A.complete_index1_data();
+				pre.A.Assign(ppe.A.size1(), ppe.A.index1_data(), ppe.A.index2_data(), ppe.A.value_data());
 #endif
+				if(ppe.preconditioner == Preconditioner::IncompleteCholesky)
+				{
+					pre.ic.Compute(pre.A);
 				}
 				else
 				{
-					// 対角項を設定
-					const auto a_ii = AccumulateNeighbor<
-#ifndef MPS_SPP
-						Detail::Field::Name::N, 
+					pre.ssor.Compute(pre.A);
+				}
+				break;
+			}
+
+			case Preconditioner::Amg:
+			{
+				// ViennaCL付属の代数的マルチグリッド法は対角成分が正の行列向けなので、こちらもCPU側で作成する
+#ifndef USE_VIENNACL
+				ppe.A.complete_index1_data();
+				pre.A.Assign(ppe.A.size1(), ppe.A.index1_data(), ppe.A.index2_data(), ppe.A.value_data());
 #endif
-						Detail::Field::Name::ID, Detail::Field::Name::X, Detail::Field::Name::Type>(i, 0.0,
-					[&thisX = particles[i].X(), r_e, n0,
-#ifndef MPS_SPP
-						surfaceRatio,
+				// 粒子数が変わった時、並べ替えた時、一定間隔毎に階層を作り直す
+				if((pre.amg.Size() != pre.A.Size()) || (pre.amgReuseCount >= pre.amgSetupInterval))
+				{
+					pre.amg.Compute(pre.A);
+					pre.amgReuseCount = 0;
+				}
+				else
+				{
+					pre.amg.Update(pre.A);
+					pre.amgReuseCount++;
+				}
+				break;
+			}
+
+			default:
+				break;
+			}
+		}
+
+		// 前処理を適用する：z = M^-1 r
+		// @param r 残差
+		// @param z 前処理後の残差
+		void Precondition(const typename Ppe::LongVector& r, typename Ppe::LongVector& z)
+		{
+			auto& pre = ppe.preconditioning;
+
+			// 係数行列を作らない時は、どの前処理でも対角スケーリング
+			if(ppe.matrixFree && (ppe.preconditioner != Preconditioner::None))
+			{
+#ifdef USE_VIENNACL
+				// CPU側で計算する
+				pre.r.resize(r.size(), false);
+				viennacl::copy(r, pre.r);
+				pre.jacobi.Apply(pre.A, pre.r, pre.z);
+				viennacl::copy(pre.z, z);
+#else
+				pre.jacobi.Apply(pre.A, r, z);
 #endif
-#ifndef MPS_HL
-						lambda,
+				return;
+			}
+
+			switch(ppe.preconditioner)
+			{
+			case Preconditioner::Jacobi:
+#ifdef USE_VIENNACL
+				z = r;
+				pre.deviceJacobi->apply(z);
+#else
+				pre.jacobi.Apply(pre.A, r, z);
 #endif
-#ifdef _OPENMP
-						&a_i
+				break;
+
+			case Preconditioner::IncompleteCholesky:
+			case Preconditioner::Ssor:
+			case Preconditioner::Amg:
+			{
+#ifdef USE_VIENNACL
+				// CPU側で計算する
+				const auto n = r.size();
+				pre.r.resize(n, false);
+				viennacl::copy(r, pre.r);
+				auto& hostR = pre.r;
+				auto& hostZ = pre.z;
 #else
-						&A, i
+				auto& hostR = r;
+				auto& hostZ = z;
 #endif
-					](
-#ifndef MPS_SPP
-						const auto n, 
+				PreconditionOnHost(hostR, hostZ);
+#ifdef USE_VIENNACL
+				viennacl::copy(hostZ, z);
+#endif
+				break;
+			}
+
+			default:
+				z = r;
+				break;
+			}
+		}
+
+		// CPU側の係数行列で前処理を適用する：z = M^-1 r（不完全コレスキー分解と対称SOR法と代数的マルチグリッド法）
+		// @param r 残差
+		// @param z 前処理後の残差
+		void PreconditionOnHost(const Detail::Preconditioning::LongVector& r, Detail::Preconditioning::LongVector& z) const
+		{
+			const auto& pre = ppe.preconditioning;
+			if(ppe.preconditioner == Preconditioner::IncompleteCholesky)
+			{
+				pre.ic.Apply(pre.A, r, z);
+			}
+			else if(ppe.preconditioner == Preconditioner::Ssor)
+			{
+				pre.ssor.Apply(pre.A, r, z);
+			}
+			else
+			{
+				pre.amg.Apply(pre.A, r, z);
+			}
+		}
+
+		// 係数行列を作らずに、係数行列とベクトルの積を近傍粒子から直接計算する：Av = A v
+		// ※非対角項を毎回計算し直す代わりに、係数行列を保持しないので、メモリ量と転送量が減る
+		// @param v ベクトル
+		// @param Av 係数行列とベクトルの積
+		void MultiplyMatrixFree(const Detail::Preconditioning::LongVector& v, Detail::Preconditioning::LongVector& Av) const
+		{
+			const auto r_e = environment.R_e;
+			const auto r_e2 = r_e * r_e;
+
+			const auto m = ppe.unknownParticle.size();
+			Av.resize(m, false);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto rr = std::make_signed_t<decltype(m)>{0}; rr < static_cast<std::make_signed_t<decltype(m)>>(m); rr++)
+			{
+				const auto row = static_cast<decltype(m)>(rr);
+#else
+			for (auto row = decltype(m){0}; row < m; row++)
+			{
 #endif
-						const auto j, const auto& x, const auto type)
+				auto Av_i = ppe.diagonal[row] * v(row);
+
+				// 影響半径内の近傍粒子について非対角項を足す
+				// ※SPP粒子は非対角項を持たないので、AccumulateNeighborは使わずに直接近傍粒子リストを回す
+				const auto i = ppe.unknownParticle[row];
+				const auto count = NeighborCount(i);
+				const auto& thisX = particles[i].X();
+				for(auto idx = decltype(count){0}; idx < count; idx++)
+				{
+					const auto j = Neighbor(i, idx);
+
+					// 未知数を持つもの（ダミー粒子（と自由表面）以外）
+					if(IsPpeUnknown(j))
 					{
-						// ダミー粒子以外
-						if(type != Particle::Type::Dummy)
+						const Vector dx = particles[j].X() - thisX;
+						const auto r2 = boost::numeric::ublas::inner_prod(dx, dx);
+						if(r2 < r_e2)
 						{
-							const auto r = R(thisX, x);
-							// 非対角項を計算
-#ifdef MPS_HL
-							// HL法（高精度ラプラシアン）: (5-D)r_e/n0 / r^3
-							const auto a_ij = (5 - DIM) * r_e / n0 / (r*r*r);
+							Av_i += PpeCoefficient(std::sqrt(r2)) * v(ppe.unknownIndex[j]);
+						}
+					}
+				}
+				Av(row) = Av_i;
+			}
+		}
+
+		// 係数行列とベクトルの積：Av = A v
+		// @param v ベクトル
+		// @param Av 係数行列とベクトルの積
+		void MultiplyPpe(const typename Ppe::LongVector& v, typename Ppe::LongVector& Av)
+		{
+			if(ppe.matrixFree)
+			{
+#ifdef USE_VIENNACL
+				// CPU側で計算する
+				ppe.hostV.resize(v.size(), false);
+				viennacl::copy(v, ppe.hostV);
+				MultiplyMatrixFree(ppe.hostV, ppe.hostAv);
+				viennacl::copy(ppe.hostAv, Av);
+#else
+				MultiplyMatrixFree(v, Av);
+#endif
+			}
+			else
+			{
+#ifdef USE_VIENNACL
+				Av = viennacl::linalg::prod(ppe.A, v);
+#else
+				Av = boost::numeric::ublas::prod(ppe.A, v);
+#endif
+			}
+		}
+
+		// 未知数の初期値を過去の解から外挿する時の重みを計算する
+		// @param weights 過去の各解の重み
+		// @return 使う過去の解の数（0なら粒子の圧力をそのまま使う）
+		std::size_t InitialGuessWeights(std::array<double, 3>& weights) const
+		{
+			auto count = std::size_t{0};
+			switch(ppe.initialGuess)
+			{
+			case InitialGuess::Previous:
+				count = 1;
+				break;
+
+			case InitialGuess::Linear:
+				count = 2;
+				break;
+
+			case InitialGuess::Quadratic:
+				count = 3;
+				break;
+
+			default:
+				count = 0;
+				break;
+			}
+
+			// 粒子を追加した直後等で過去の解が足りなければ、ある分だけで外挿する
+			count = std::min(count, ppe.historyCount);
+			return Detail::ConjugateGradient::ExtrapolationWeights(environment.T(), ppe.historyT, count, weights);
+		}
+
+		// 共役勾配法の収束判定に使う残差の2乗の閾値
+		// ※基準は初期値の決め方に依らず、指定されたもの（初期残差か右辺）にする
+		// @param rr 初期残差の2乗
+		double ConvergenceThreshold(const double rr) const
+		{
+#ifdef USE_VIENNACL
+			namespace op = viennacl::linalg;
+#else
+			namespace op = boost::numeric::ublas;
+#endif
+			const auto reference = (ppe.residualReference == ResidualReference::RightHandSide) ? op::inner_prod(ppe.b, ppe.b) : rr;
+			return reference*ppe.allowableResidual*ppe.allowableResidual;
+		}
+
+		// 共役勾配法の最大反復回数
+		// ※理論上は未知数の数だけ繰り返せば収束するので、指定が無ければそれを上限にする
+		// @param n 未知数の数
+		std::size_t IterationLimit(const std::size_t n) const
+		{
+			return (ppe.maxIteration > 0) ? ppe.maxIteration : n;
+		}
+
+		// 圧力方程式の解が収束しなかったことを通知する
+		// @param iteration 反復回数
+		// @param residual 最終残差
+		[[noreturn]] static void ThrowNotConverged(const std::size_t iteration, const double residual)
+		{
+			std::ostringstream message;
+			message << "Conjugate Gradient method couldn't solve Pressure Poison Equation (" << iteration << " iterations, residual " << residual << ")";
+			Exception exception;
+			exception.Message = message.str();
+			throw exception;
+		}
+
+		// 圧力方程式をを解く
+		void SolvePressurePoissonEquation()
+		{
+			if(ppe.mixedPrecision)
+			{
+				SolveByMixedPrecision();
+			}
+			else if(ppe.method == ConjugateGradientMethod::ChronopoulosGear)
+			{
+				SolveByChronopoulosGear();
+			}
+			else
+			{
+				SolveByConjugateGradient();
+			}
+		}
+
+		// 圧力方程式を前処理付き共役勾配法で解く
+		void SolveByConjugateGradient()
+		{
+
+#ifdef USE_VIENNACL
+			namespace op = viennacl::linalg;
+#else
+			namespace op = boost::numeric::ublas;
+#endif
+
+			auto& x = ppe.x;
+			auto& b = ppe.b;
+			auto& r = ppe.cg.r;
+			auto& p = ppe.cg.p;
+			auto& Ap = ppe.cg.Ap;
+			auto& z = ppe.cg.z;
+
+			// 前処理行列を作成
+			ComputePreconditioner();
+
+			// 初期値を設定
+			//  (Ap)_0 = A * x
+			//  r_0 = b - Ap
+			//  z_0 = M^-1 r_0
+			//  p_0 = z_0
+			//  rz = r・z
+			MultiplyPpe(x, Ap);
+			r = b - Ap;
+			Precondition(r, z);
+			p = z;
+			double rz = op::inner_prod(r, z);
+			auto rr = op::inner_prod(r, r);
+			const double residual0 = ConvergenceThreshold(rr);
+			telemetry.initialResidual = std::sqrt(rr);
+
+			// 初期値で既に収束している場合は即時終了
+			bool isConverged = (rr <= residual0);
+			const auto n = IterationLimit(x.size());
+			auto iteration = decltype(n){0};
+			// 未知数分（指定があればその回数）だけ繰り返す
+			for (; (iteration < n) && (!isConverged); iteration++)
+			{
+				// 計算を実行
+				//  Ap = A * p
+				//  α = rz/(p・Ap)
+				//  x' += αp
+				//  r' -= αAp
+				//  r'r' = r'・r'
+				MultiplyPpe(p, Ap);
+				const auto alpha = rz / op::inner_prod(p, Ap);
+				x += alpha * p;
+				r -= alpha * Ap;
+				const auto rrNew = op::inner_prod(r, r);
+				rr = rrNew;
+
+				// 収束判定
+				const auto residual = rrNew;
+				isConverged = (residual < residual0);
+
+				// 収束していなければ、残りの計算を実行
+				if (!isConverged)
+				{
+					// 残りの計算を実行
+					//  z' = M^-1 r'
+					//  β= r'z'/rz
+					//  p = z' + βp
+					//  rz = r'z'
+					Precondition(r, z);
+					const auto rzNew = op::inner_prod(r, z);
+					const auto beta = rzNew / rz;
+					p = z + beta * p;
+					rz = rzNew;
+				}
+			}
+			ppe.iterationCount += iteration;
+			telemetry.iterationCount = iteration;
+			telemetry.finalResidual = std::sqrt(rr);
+
+			// 理論上は未知数分だけ繰り返せば収束するはずだが、収束しなかった場合は
+			if (!isConverged)
+			{
+				// どうしようもないので例外
+				ThrowNotConverged(iteration, telemetry.finalResidual);
+			}
+		};
+
+		// 単精度で解く時の係数行列と前処理を作成する
+		void ComputeSinglePrecision()
+		{
+			auto& single = ppe.single;
+#ifdef USE_VIENNACL
+			// 係数行列の作成時にCPU側にも作られているので、そちらから変換する
+			const auto& hostA = ppe.preconditioning.A;
+			single.A.Assign(hostA.Size(), hostA.start, hostA.column, hostA.value);
+#else
+			// 要素毎に設定された場合でも各行の先頭位置が揃うようにしてから、そのまま変換する
+			ppe.A.complete_index1_data();
+			single.A.Assign(ppe.A.size1(), ppe.A.index1_data(), ppe.A.index2_data(), ppe.A.value_data());
+#endif
+
+			switch(ppe.preconditioner)
+			{
+			case Preconditioner::None:
+				break;
+
+			case Preconditioner::Jacobi:
+				single.A.InverseDiagonal(single.invDiagonal);
+				break;
+
+			default:
+				// それ以外の前処理は倍精度のまま作って使う
+				ComputePreconditioner();
+				break;
+			}
+		}
+
+		// 圧力方程式を単精度の前処理付き共役勾配法と倍精度の反復改良で解く
+		// ※係数行列とベクトルの積の転送量を半分にしつつ、残差は倍精度で計算し直すので倍精度と同じ精度の解が得られる
+		void SolveByMixedPrecision()
+		{
+			// 内側の共役勾配法で残差を減らす割合の下限
+			// ※単精度の丸め誤差（約1e-7）より大きくしておかないと、内側が収束しなくなる
+			constexpr double INNER_TOLERANCE = 1e-5;
+
+			// 反復改良の最大回数
+			constexpr std::size_t MAX_REFINEMENT = 20;
+
+#ifdef USE_VIENNACL
+			namespace op = viennacl::linalg;
+#else
+			namespace op = boost::numeric::ublas;
+#endif
+
+			auto& x = ppe.x;
+			auto& b = ppe.b;
+			auto& r = ppe.cg.r;
+			auto& Ax = ppe.cg.Ap;
+			auto& dx = ppe.cg.z;
+			auto& single = ppe.single;
+			auto& pre = ppe.preconditioning;
+
+			// 係数行列を単精度に変換し、前処理行列を作成
+			ComputeSinglePrecision();
+
+			// 単精度での前処理
+			const auto precondition = [this, &single, &pre](const Detail::MixedPrecision::Vector& singleR, Detail::MixedPrecision::Vector& singleZ)
+			{
+				switch(ppe.preconditioner)
+				{
+				case Preconditioner::None:
+					singleZ = singleR;
+					break;
+
+				case Preconditioner::Jacobi:
+				{
+					const auto n = singleR.size();
+					singleZ.resize(n);
+					OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+					for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+					{
+						const auto i = static_cast<decltype(n)>(ii);
 #else
-							// 標準MPS法：2D/(λn0) w
-							const double w = Particle::W(r, r_e);
-							const auto a_ij = (2 * DIM / lambda / n0) * w;
+					for (auto i = decltype(n){0}; i < n; i++)
+					{
 #endif
+						singleZ[i] = single.invDiagonal[i] * singleR[i];
+					}
+					break;
+				}
 
-#ifdef MPS_SPP
-							// SPPの場合は非対角項は設定しない
-							if(j >= 0)
-#else
-							// 自由表面の場合は非対角項は設定しない
-							if (!IsSurface(n, n0, surfaceRatio))
-#endif
-							{
-#ifdef _OPENMP
-								a_i.emplace_back(j, a_ij);
-#else
-								A(i, j) = a_ij;
-#endif
-							}
+				default:
+					// 倍精度に戻して前処理する
+					Detail::MixedPrecision::ToDouble(singleR, pre.r);
+					pre.z.resize(singleR.size(), false);
+					PreconditionOnHost(pre.r, pre.z);
+					Detail::MixedPrecision::ToSingle(pre.z, singleZ);
+					break;
+				}
+			};
 
-							return -a_ij;
-						}
-						else
-						{
-							return 0.0;
-						}
-					});
+			// 初期残差を倍精度で計算
+			//  r_0 = b - A x
+			MultiplyPpe(x, Ax);
+			r = b - Ax;
+			auto rr = op::inner_prod(r, r);
+			const double residual0 = ConvergenceThreshold(rr);
+			telemetry.initialResidual = std::sqrt(rr);
 
-#ifdef _OPENMP
-					a_i.emplace_back(i, a_ii);
+			// 初期値で既に収束している場合は即時終了
+			bool isConverged = (rr <= residual0);
+			const auto n = x.size();
+			const auto maxIteration = IterationLimit(n);
+			auto iteration = decltype(n){0};
+			for (auto refinement = decltype(MAX_REFINEMENT){0}; (refinement < MAX_REFINEMENT) && (iteration < maxIteration) && (!isConverged); refinement++)
+			{
+				// 修正量の方程式を単精度で解く
+				//  A dx = r
+#ifdef USE_VIENNACL
+				// CPU側で計算する
+				pre.r.resize(n, false);
+				viennacl::copy(r, pre.r);
+				Detail::MixedPrecision::ToSingle(pre.r, single.b);
 #else
-					A(i, i) = a_ii;
+				Detail::MixedPrecision::ToSingle(r, single.b);
 #endif
-				}
-			}
+				// ※最後の改良では、収束判定誤差まで減らせば十分なのでそこで止める（少し余裕を持たせる）
+				const auto tolerance = std::max(INNER_TOLERANCE, 0.5 * std::sqrt(residual0 / rr));
+				iteration += Detail::MixedPrecision::Solve(single.A, precondition, single.b,
+					single.x, single.r, single.p, single.Ap, single.z,
+					tolerance, maxIteration - iteration);
 
-#ifdef _OPENMP
-			// 全行の
-#ifdef SIGNED_LOOP_COUNTER
-			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
-			{
-				const auto i = static_cast<decltype(n)>(ii);
+				// 倍精度で解を修正し、残差を計算し直す
+				//  x' += dx
+				//  r' = b - A x'
+#ifdef USE_VIENNACL
+				Detail::MixedPrecision::ToDouble(single.x, pre.z);
+				viennacl::copy(pre.z, dx);
 #else
-			for (auto i = decltype(n){0}; i < n; i++)
-			{
+				Detail::MixedPrecision::ToDouble(single.x, dx);
 #endif
-				// 全有効列で
-				for (auto k : ppe.a_ij[i])
-				{
-					// 行列に格納
-					const auto j = k.first;
-					const auto a_ij = k.second;
+				x += dx;
+				MultiplyPpe(x, Ax);
+				r = b - Ax;
+				const auto rrNew = op::inner_prod(r, r);
+
+				// 収束判定
+				isConverged = (rrNew < residual0);
 
-					A(i, j) = a_ij;
+				// 残差が減らなくなったら、それ以上改良できない
+				const auto isImproved = (rrNew < rr);
+				rr = rrNew;
+				if(!isImproved)
+				{
+					break;
 				}
 			}
-#endif
+			ppe.iterationCount += iteration;
+			telemetry.iterationCount = iteration;
+			telemetry.finalResidual = std::sqrt(rr);
 
-#ifdef USE_VIENNACL
-			// 作成した係数行列をデバイス側に複製
-			viennacl::copy(ppe.tempA, ppe.A);
-#endif
+			// 収束しなかった場合は
+			if (!isConverged)
+			{
+				// どうしようもないので例外
+				ThrowNotConverged(iteration, telemetry.finalResidual);
+			}
 		}
 
-		// 圧力方程式をを解く
-		void SolvePressurePoissonEquation()
+		// 圧力方程式をChronopoulos-Gear法で解く
+		// ※前処理付き共役勾配法の漸化式を変形して内積を1か所にまとめ、ベクトルの更新と内積をそれぞれ1回の走査で計算する
+		//   スレッド間の同期が1反復で3回から1回に減るので、スレッド数が多い時に効く
+		void SolveByChronopoulosGear()
 		{
-			// 共役勾配法で解く
-			// TODO: 前処理ぐらい入れようよ
+			auto& x = ppe.x;
+			auto& b = ppe.b;
+			auto& r = ppe.cg.r;
+			auto& p = ppe.cg.p;
+			auto& s = ppe.cg.Ap;
+			auto& u = ppe.cg.z;
+			auto& w = ppe.cg.Az;
 
 #ifdef USE_VIENNACL
-			namespace op = viennacl::linalg;
+			// ViennaCLのベクトルは要素毎に計算できないので、ViennaCLの演算を並べる
+			const auto update = [&x, &r, &p, &s, &u, &w](const double alpha, const double beta)
+			{
+				p = u + beta * p;
+				s = w + beta * s;
+				x += alpha * p;
+				r -= alpha * s;
+			};
+			const auto innerProducts = [&r, &u, &w](double& ru, double& wu, double& rr)
+			{
+				ru = viennacl::linalg::inner_prod(r, u);
+				wu = viennacl::linalg::inner_prod(w, u);
+				rr = viennacl::linalg::inner_prod(r, r);
+			};
 #else
-			namespace op = boost::numeric::ublas;
+			const auto update = [&x, &r, &p, &s, &u, &w](const double alpha, const double beta)
+			{
+				Detail::ConjugateGradient::Update(alpha, beta, u, w, p, s, x, r);
+			};
+			const auto innerProducts = [&r, &u, &w](double& ru, double& wu, double& rr)
+			{
+				Detail::ConjugateGradient::InnerProducts(r, u, w, ru, wu, rr);
+			};
 #endif
 
-			auto& A = ppe.A;
-			auto& x = ppe.x;
-			auto& b = ppe.b;
-			auto& r = ppe.cg.r;
-			auto& p = ppe.cg.p;
-			auto& Ap = ppe.cg.Ap;
+			// 前処理行列を作成
+			ComputePreconditioner();
 
 			// 初期値を設定
-			//  (Ap)_0 = A * x
-			//  r_0 = b - Ap
-			//  p_0 = r_0
-			//  rr = r・r
-			Ap = op::prod(A, x);
-			r = b - Ap;
-			p = r;
-			double rr = op::inner_prod(r, r);
-			const double residual0 = rr*ppe.allowableResidual*ppe.allowableResidual;
+			//  r_0 = b - A x
+			//  u_0 = M^-1 r_0
+			//  w_0 = A u_0
+			//  γ = r・u, δ = w・u
+			//  α = γ/δ, β = 0, p = s = 0
+			MultiplyPpe(x, s);
+			r = b - s;
+			Precondition(r, u);
+			MultiplyPpe(u, w);
+			auto gamma = 0.0;
+			auto delta = 0.0;
+			auto rr = 0.0;
+			innerProducts(gamma, delta, rr);
+			const double residual0 = ConvergenceThreshold(rr);
+			telemetry.initialResidual = std::sqrt(rr);
+			auto alpha = gamma / delta;
+			auto beta = 0.0;
+			p.clear();
+			s.clear();
 
 			// 初期値で既に収束している場合は即時終了
-			bool isConverged = (residual0 == 0);
-			const auto n = x.size();
-			// 未知数分だけ繰り返す
-			for (auto i = decltype(n){0}; (i < n) && (!isConverged); i++)
+			bool isConverged = (rr <= residual0);
+			const auto n = IterationLimit(x.size());
+			auto iteration = decltype(n){0};
+			// 未知数分（指定があればその回数）だけ繰り返す
+			for (; (iteration < n) && (!isConverged); iteration++)
 			{
 				// 計算を実行
-				//  Ap = A * p
-				//  α = rr/(p・Ap)
+				//  p = u + βp
+				//  s = w + βs (= A p)
 				//  x' += αp
-				//  r' -= αAp
-				//  r'r' = r'・r'
-				Ap = op::prod(A, p);
-				const auto alpha = rr / op::inner_prod(p, Ap);
-				x += alpha * p;
-				r -= alpha * Ap;
-				const auto rrNew = op::inner_prod(r, r);
+				//  r' -= αs
+				//  u' = M^-1 r'
+				//  w' = A u'
+				//  γ' = r'・u', δ = w'・u', r'r' = r'・r'
+				update(alpha, beta);
+				Precondition(r, u);
+				MultiplyPpe(u, w);
+				auto gammaNew = 0.0;
+				innerProducts(gammaNew, delta, rr);
 
 				// 収束判定
-				const auto residual = rrNew;
-				isConverged = (residual < residual0);
+				isConverged = (rr < residual0);
 
 				// 収束していなければ、残りの計算を実行
 				if (!isConverged)
 				{
-					// 残りの計算を実行
-					//  β= r'r'/rr
-					//  p = r' + βp
-					//  rr = r'r'
-					const auto beta = rrNew / rr;
-					p = r + beta * p;
-					rr = rrNew;
+					//  β = γ'/γ
+					//  α = γ'/(δ - βγ'/α)
+					beta = gammaNew / gamma;
+					alpha = gammaNew / (delta - beta * gammaNew / alpha);
+					gamma = gammaNew;
 				}
 			}
+			ppe.iterationCount += iteration;
+			telemetry.iterationCount = iteration;
+			telemetry.finalResidual = std::sqrt(rr);
 
 			// 理論上は未知数分だけ繰り返せば収束するはずだが、収束しなかった場合は
 			if (!isConverged)
 			{
 				// どうしようもないので例外
-				Exception exception;
-				exception.Message = "Conjugate Gradient method couldn't solve Pressure Poison Equation";
-				throw exception;
+				ThrowNotConverged(iteration, telemetry.finalResidual);
 			}
-		};
+		}
 #endif
 
 		// 圧力勾配によって速度と位置を修正する
@@ -1446,7 +2676,7 @@ namespace { namespace OpenMps
 			for (auto i = decltype(n){0}; i < n; i++)
 			{
 #endif
-				auto& particle = particles[i];
+				auto&& particle = particles[i];
 
 				// 水粒子のみ
 				if (particle.TYPE() == Particle::Type::IncompressibleNewton)
@@ -1457,88 +2687,90 @@ namespace { namespace OpenMps
 					const double n0 = environment.N0();
 
 					// 圧力勾配を計算する
-#ifdef MPS_GC
-					// 勾配修正行列を計算
-					auto invC = AccumulateNeighbor<Detail::Field::Name::X>(i, Detail::MatrixZero,
-						[&thisX = particle.X(), r_e](const auto& x)
-					{
-						namespace ublas = boost::numeric::ublas;
-
-						// C = (1/n Σr⊗r/r^2 * w)^-1
-						const Vector dx = x - thisX;
-						const auto r2 = ublas::inner_prod(dx, dx);
-						const auto w = Particle::W(R(x, thisX), r_e);
-						const Detail::CorrectiveMatrix result = (w / r2) * ublas::outer_prod(dx, dx);
-						return result;
-					});
-
-					const auto C = Detail::InvertMatrix(std::move(invC), DIM / n0);
-
-					// 速度修正量を計算
-					const Vector d = (-dt * particle.N() / (rho * n0)) * AccumulateNeighbor<Detail::Field::Name::P, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero,
-						[&thisP = particle.P(), &thisX = particle.X(), r_e, &C]
-						(const auto p, const auto& x, const auto type)
+					Vector d;
+					if(scheme.Gc)
 					{
-						// ダミー粒子以外
-						if(type != Particle::Type::Dummy)
+						// 勾配修正行列を計算
+						auto invC = AccumulateNeighbor<Detail::Field::Name::X>(i, Detail::MatrixZero<DIM>,
+							[&thisX = particle.X(), r_e](const auto& x)
 						{
 							namespace ublas = boost::numeric::ublas;
 
-#ifdef PRESSURE_GRADIENT_MIDPOINT
-							const auto p_ij = p + thisP;
-#else
-							const auto p_ij = p - thisP;
-#endif
-							// GC法：-Δt/ρ p_ij/r^2 w * C dx
+							// C = (1/n Σr⊗r/r^2 * w)^-1
 							const Vector dx = x - thisX;
 							const auto r2 = ublas::inner_prod(dx, dx);
-							const Vector result = (p_ij / r2 * Particle::W(R(x, thisX), r_e)) * ublas::prod(C, dx);
+							const auto w = Particle::W(R(x, thisX), r_e);
+							const Detail::CorrectiveMatrix<DIM> result = (w / r2) * ublas::outer_prod(dx, dx);
 							return result;
-						}
-						else
+						});
+
+						const auto C = Detail::InvertMatrix(std::move(invC), DIM / n0);
+
+						// 速度修正量を計算
+						d = (-dt * particle.N() / (rho * n0)) * AccumulateNeighbor<Detail::Field::Name::P, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero<DIM>,
+							[&thisP = particle.P(), &thisX = particle.X(), r_e, &C]
+							(const auto p, const auto& x, const auto type)
 						{
-							return VectorZero;
-						}
-					});
-#else
+							// ダミー粒子以外
+							if(type != Particle::Type::Dummy)
+							{
+								namespace ublas = boost::numeric::ublas;
+
 #ifdef PRESSURE_GRADIENT_MIDPOINT
-					// 速度修正量を計算
-					// 標準MPS法：-Δt/ρ D/n_0 (p_j + p_i)/r^2 w * dx
-					const Vector d = (-dt / rho * DIM / n0) * AccumulateNeighbor<Detail::Field::Name::P, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero,
-						[thisP = particle.P(), thisX = particle.X(), r_e](const auto p, const auto& x, const auto type)
+								const auto p_ij = p + thisP;
+#else
+								const auto p_ij = p - thisP;
+#endif
+								// GC法：-Δt/ρ p_ij/r^2 w * C dx
+								const Vector dx = x - thisX;
+								const auto r2 = ublas::inner_prod(dx, dx);
+								const Vector result = (p_ij / r2 * Particle::W(R(x, thisX), r_e)) * ublas::prod(C, dx);
+								return result;
+							}
+							else
+							{
+								return VectorZero<DIM>;
+							}
+						});
+					}
+					else
 					{
-						// ダミー粒子以外
-						if(type != Particle::Type::Dummy)
+#ifdef PRESSURE_GRADIENT_MIDPOINT
+						// 速度修正量を計算
+						// 標準MPS法：-Δt/ρ D/n_0 Σ(p_j + p_i)/r^2 w * dx
+						const auto thisP = particle.P();
+						auto& batch = Detail::Simd::ThreadBatch<DIM>();
+						GatherNeighbor(i, batch, [this, &batch, thisP](const auto j)
 						{
-							namespace ublas = boost::numeric::ublas;
-
-							const auto dx = x - thisX;
-							const auto r2 = ublas::inner_prod(dx, dx);
-							const Vector result = ((p + thisP) / r2 * Particle::W(std::sqrt(r2), r_e)) * dx;
-							return result;
-						}
-						else
+							batch.AddCoefficient((particles[j].TYPE() != Particle::Type::Dummy) ? (particles[j].P() + thisP) : 0.0); // ダミー粒子以外
+						});
+						Vector sum = Detail::Simd::SumPressureGradient(batch, r_e);
+						// SPP粒子の圧力は0
+						Vector x_spp;
+						if(scheme.Spp && SppPosition(i, Detail::Simd::SumWeightedDx(batch, r_e), x_spp))
 						{
-							return VectorZero;
+							const Vector dx = x_spp - particle.X();
+							const auto r2 = boost::numeric::ublas::inner_prod(dx, dx);
+							sum += (thisP / r2 * Particle::W(std::sqrt(r2), r_e)) * dx;
 						}
-					});
+						d = (-dt / rho * DIM / n0) * sum;
 #else
-					// 最小圧力を取得する
-					auto minPparticle = std::min_element(particles.cbegin(), particles.cend(),
-						[](const Particle::Ptr& base, const Particle::Ptr& target)
-					{
-						return base->p < target->p;
-					});
+						// 最小圧力を取得する
+						auto minPparticle = std::min_element(particles.cbegin(), particles.cend(),
+							[](const Particle::Ptr& base, const Particle::Ptr& target)
+						{
+							return base->p < target->p;
+						});
 
-					// 速度修正量を計算
-					d = std::accumulate(particles.cbegin(), particles.cend(), VectorZero,
-						[this, &r_e, &dt, &rho, &n0, &minPparticle](const Vector& sum, const Particle::Ptr& particle)
-					{
-						auto du = particle->PressureGradientTo(*this, (*minPparticle)->p, r_e, dt, rho, n0);
-						return (Vector)(sum + du);
-					});
-#endif
+						// 速度修正量を計算
+						d = std::accumulate(particles.cbegin(), particles.cend(), VectorZero<DIM>,
+							[this, &r_e, &dt, &rho, &n0, &minPparticle](const Vector& sum, const Particle::Ptr& particle)
+						{
+							auto du = particle->PressureGradientTo(*this, (*minPparticle)->p, r_e, dt, rho, n0);
+							return (Vector)(sum + du);
+						});
 #endif
+					}
 					du[i] = d;
 				}
 			}
@@ -1566,7 +2798,6 @@ namespace { namespace OpenMps
 			}
 		}
 
-#ifdef MPS_DS
 		// DS法による人工斥力を追加
 		void DynamicStabilize()
 		{
@@ -1592,15 +2823,12 @@ namespace { namespace OpenMps
 				{
 					// DS法：Λ = -1/(2 n0 Δt) Σ(√(d^2 - r⊥^2) - r||) x/r
 					const auto& thisX = particle.X();
-					const Vector result = -1.0/(2 * dt * n0) * AccumulateNeighbor<Detail::Field::Name::ID, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero,
+					const Vector result = -1.0/(2 * dt * n0) * AccumulateNeighbor<Detail::Field::Name::ID, Detail::Field::Name::X, Detail::Field::Name::Type>(i, VectorZero<DIM>,
 						[&x0 = originalX[i], &originalX = this->originalX, &thisX, d2 = d*d](const auto j, const auto& x, const auto type)
 					{
 						// ダミー粒子以外
-						if((type != Particle::Type::Dummy)
-#ifdef MPS_SPP
-							&& (j >= 0) // SPP粒子も除く
-#endif
-							)
+						// ※SPP粒子も除く
+						if((type != Particle::Type::Dummy) && (j >= 0))
 						{
 							namespace ublas = boost::numeric::ublas;
 
@@ -1624,12 +2852,12 @@ namespace { namespace OpenMps
 							}
 							else
 							{
-								return VectorZero;
+								return VectorZero<DIM>;
 							}
 						}
 						else
 						{
-							return VectorZero;
+							return VectorZero<DIM>;
 						}
 					});
 
@@ -1657,7 +2885,6 @@ namespace { namespace OpenMps
 				}
 			}
 		}
-#endif
 
 	public:
 		struct Exception
@@ -1671,69 +2898,117 @@ namespace { namespace OpenMps
 		// @param env MPS計算用の計算空間固有パラメータ
 		// @param posWall 壁粒子の位置
 		// @param posWallPre 壁粒子の位置計算の前処理
+		// @param sch 計算手法の組み合わせ
 		Computer(
 #ifndef PRESSURE_EXPLICIT
 			const double allowableResidual,
 #endif
 			const Environment& env,
 			const POSITION_WALL& posWall,
-			const POSITION_WALL_PRE& posWallPre)
+			const POSITION_WALL_PRE& posWallPre,
+			const SCHEME& sch = SCHEME{})
 			: environment(env),
-			grid(env.NeighborLength, env.L_0, env.MinX, env.MaxX),
+			scheme(sch),
+			grid(env.NeighborLength, env.MinX, env.MaxX),
+			neighborStart(1, 0),
 			neighbor(),
+			reuseNeighbor(false),
+			searchedX(),
+			searchCount(0),
 			positionWall(posWall),
-			positionWallPre(posWallPre)
+			positionWallPre(posWallPre),
+			reorderInterval(0),
+			forwardCount(0),
+			telemetry()
 		{
 #ifndef PRESSURE_EXPLICIT
 			// 圧力方程式の許容誤差を設定
 			ppe.allowableResidual = allowableResidual;
+
+			// 前処理は既定ではしない
+			ppe.preconditioner = Preconditioner::None;
+			ppe.method = ConjugateGradientMethod::Standard;
+			ppe.matrixFree = false;
+			ppe.mixedPrecision = false;
+			ppe.patternSearchCount = InvalidPattern();
+			ppe.preconditioning.amgSetupInterval = 10;
+			ppe.preconditioning.amgReuseCount = 0;
+			ppe.iterationCount = 0;
+			ppe.maxIteration = 0;
+			ppe.initialGuess = InitialGuess::Pressure;
+			ppe.residualReference = ResidualReference::Initial;
+			ppe.historyT.fill(0);
+			ppe.historyCount = 0;
 #endif
 		}
 
 		Computer(Computer&& src)
 			: particles(std::move(src.particles)),
+			originalId(std::move(src.originalId)),
+			currentId(std::move(src.currentId)),
 			environment(std::move(src.environment)),
+			scheme(src.scheme),
 			grid(std::move(src.grid)),
-			neighbor(src.neighbor),
+			neighborStart(std::move(src.neighborStart)),
+			neighbor(std::move(src.neighbor)),
+			reuseNeighbor(src.reuseNeighbor),
+			searchedX(std::move(src.searchedX)),
+			searchCount(src.searchCount),
 #ifndef PRESSURE_EXPLICIT
 			ppe(std::move(src.ppe)),
 #endif
 			du(std::move(src.du)),
-#ifdef MPS_ECS
 			ecs(std::move(src.ecs)),
+#ifndef PRESSURE_EXPLICIT
+			dndt(std::move(src.dndt)),
 #endif
-#ifdef MPS_DS
 			originalX(std::move(src.originalX)),
-#endif
-#ifdef MPS_SPP
 			nWithoutSpp(std::move(src.nWithoutSpp)),
-#endif
 			positionWall(std::move(src.positionWall)),
-			positionWallPre(std::move(src.positionWallPre))
+			positionWallPre(std::move(src.positionWallPre)),
+			reorderInterval(src.reorderInterval),
+			forwardCount(src.forwardCount),
+			telemetry(src.telemetry)
 		{}
 
 		Computer(const Computer&) = delete;
 		Computer& operator=(const Computer&) = delete;
 
 		// 時間を進める
-		void ForwardTime(const double dt)
+		// @return この時間刻みの計算の統計
+		Telemetry ForwardTime(const double dt)
 		{
+			Timer timer;
+			timer.Start();
+			telemetry = Telemetry{};
+
 			// 時間刻みを設定
 			environment.Dt() = dt;
 
 			// 時間を進める
 			environment.SetNextT();
 
+			// 一定間隔で粒子を空間的に並べ替える
+			if((reorderInterval > 0) && (forwardCount % reorderInterval == 0))
+			{
+				ReorderParticles();
+			}
+			forwardCount++;
+
 			// 近傍粒子探索
 			// ※近傍粒子半径を大きめにとっているので1回で良い
-			SearchNeighbor();
+			// ※使い回す時は、近傍粒子半径の余裕を使い切りそうな時だけ探索する
+			if(NeedsSearchNeighbor())
+			{
+				SearchNeighbor();
+			}
 
 			// 粒子数密度を計算する
-			ComputeNeighborDensities();
-
-#ifdef MPS_ECS
-			ComputeErrorCorrection();
-#endif
+			// ※ECS法の誤差修正量は移動前の粒子数密度から計算する（それ以外には使わないので、ECS法でなければ走査しない）
+			if(scheme.Ecs)
+			{
+				ComputeNeighborDensities<true>();
+			}
 
 			// 第一段階の計算
 			ComputeExplicitForces();
@@ -1743,64 +3018,327 @@ namespace { namespace OpenMps
 			ModifyTooNear();
 #endif
 
-			// 粒子数密度を計算する
+			// 粒子数密度を計算する（陽解法では圧力も）
 			ComputeNeighborDensities();
 
-#ifdef MPS_DS
 			// 圧力勾配の前の位置を保存
-			SaveX();
-#endif
+			if(scheme.Ds)
+			{
+				SaveX();
+			}
 
 			// 第二段階の計算
 			ComputeImplicitForces();
 
-#ifdef MPS_DS
 			// DS法による人工斥力の追加
-			DynamicStabilize();
-#endif
+			if(scheme.Ds)
+			{
+				DynamicStabilize();
+			}
+
+			telemetry.stepTime = timer.Time();
+			return telemetry;
 		}
 
 		// 時間を進める
-		void ForwardTime()
+		// @return この時間刻みの計算の統計
+		Telemetry ForwardTime()
 		{
 			// 時間刻みを設定
 			const auto dt = DetermineDt();
 
-			ForwardTime(dt);
+			return ForwardTime(dt);
 		}
 
 		// 粒子を追加する
 		template<typename PARTICLES>
 		void AddParticles(PARTICLES&& src)
 		{
-			particles.insert(particles.end(),
-				std::make_move_iterator(src.begin()),
-				std::make_move_iterator(src.end()));
+			const auto oldN = particles.size();
+			particles.reserve(oldN + src.size());
+			for(const auto& particle : src)
+			{
+				particles.push_back(particle);
+			}
 
 			const auto n = particles.size();
 
-			neighbor.resize(boost::extents
-				[static_cast<NeighborIndex>(n)]
-				[1 + static_cast<NeighborIndex>(grid.MaxParticles()*Grid::MAX_NEIGHBOR_BLOCK)]); // 先頭は近傍粒子数
+			// 追加した粒子には続きの番号を振る
+			originalId.resize(n);
+			currentId.resize(n);
+			for (auto i = oldN; i < n; i++)
+			{
+				originalId[i] = i;
+				currentId[i] = i;
+			}
 
 			du.resize(n);
-#ifdef MPS_ECS
-			ecs.resize(n);
-#endif
-#ifdef MPS_DS
-			originalX.resize(n);
+#ifndef PRESSURE_EXPLICIT
+			dndt.resize(n);
 #endif
-#ifdef MPS_SPP
-			nWithoutSpp.resize(n);
+			// ※使わない計算手法の値は確保しない
+			if(scheme.Ecs)
+			{
+				ecs.resize(n);
+			}
+			if(scheme.Ds)
+			{
+				originalX.resize(n);
+			}
+			if(scheme.Spp)
+			{
+				nWithoutSpp.resize(n);
+			}
+#ifndef PRESSURE_EXPLICIT
+
+			// 追加した粒子の過去の解は無いので、初期値の外挿はやり直す
+			ppe.historyCount = 0;
 #endif
 		}
 
 		// 粒子リストを取得する
+		// ※並べ替えにより、追加した順番とは限らない
 		const auto& Particles() const
 		{
 			return this->particles;
 		}
 
+		// 元の粒子番号（追加した順番）で粒子を取得する
+		// @param id 元の粒子番号
+		auto OriginalParticle(const std::size_t id) const
+		{
+			return particles[currentId[id]];
+		}
+
+		// 計算の全状態をチェックポイントに書き出す
+		// ※書き出しても計算の状態は変えないので、書き出さずに続けた計算と同じ結果になる
+		// @param writer 書き出し先
+		void SaveCheckpoint(CheckpointWriter& writer) const
+		{
+			writer.WriteValue("scheme", CheckpointScheme());
+			writer.WriteValue("t", environment.T());
+			writer.WriteValue("dt", environment.Dt());
+			writer.WriteValue("forwardCount", forwardCount);
+
+			// 粒子（今の並び順のまま）
+			const auto n = particles.size();
+			{
+				std::vector<typename Particle::Type> type(n);
+				std::vector<Vector> x(n);
+				std::vector<Vector> u(n);
+				std::vector<double> p(n);
+				std::vector<double> nd(n);
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					type[i] = particles[i].TYPE();
+					x[i] = particles[i].X();
+					u[i] = particles[i].U();
+					p[i] = particles[i].P();
+					nd[i] = particles[i].N();
+				}
+				writer.WriteArray("particles.type", type);
+				writer.WriteVectors<DIM>("particles.x", x);
+				writer.WriteVectors<DIM>("particles.u", u);
+				writer.WriteArray("particles.p", p);
+				writer.WriteArray("particles.n", nd);
+			}
+			writer.WriteArray("originalId", originalId);
+
+			// 近傍粒子リスト（使い回している途中のものもそのまま）
+			writer.WriteArray("neighborStart", neighborStart);
+			writer.WriteArray("neighbor", neighbor);
+			writer.WriteVectors<DIM>("searchedX", searchedX);
+			writer.WriteValue("searchCount", searchCount);
+
+			// 粒子毎の値
+			writer.WriteVectors<DIM>("du", du);
+			writer.WriteArray("ecs", ecs);
+#ifndef PRESSURE_EXPLICIT
+			writer.WriteArray("dndt", dndt);
+#endif
+			writer.WriteVectors<DIM>("originalX", originalX);
+			writer.WriteArray("nWithoutSpp", nWithoutSpp);
+
+#ifndef PRESSURE_EXPLICIT
+			// 圧力方程式の初期値に使う過去の解
+			writer.WriteValue("ppe.iterationCount", ppe.iterationCount);
+			writer.WriteValue("ppe.historyCount", ppe.historyCount);
+			writer.WriteValue("ppe.historyT", ppe.historyT);
+			for(auto k = decltype(ppe.history.size()){0}; k < ppe.history.size(); k++)
+			{
+				writer.WriteArray("ppe.history" + std::to_string(k), ppe.history[k]);
+			}
+
+			// 代数的マルチグリッド法の階層（集約を使い回している途中のものもそのまま）
+			writer.WriteValue("ppe.amgReuseCount", ppe.preconditioning.amgReuseCount);
+			ppe.preconditioning.amg.Save(writer, "ppe.amg");
+#endif
+		}
+
+		// チェックポイントから計算の全状態を読み込む
+		// ※計算手法の組み合わせと次元は書き出した時と同じでなければならない
+		// ※計算条件（並べ替える間隔や前処理など）は読み込まないので、書き出した時と同じものを設定しておく
+		// @param reader 読み込み元
+		void LoadCheckpoint(CheckpointReader& reader)
+		{
+			if(reader.Dimension() != DIM)
+			{
+				throw std::runtime_error("Checkpoint dimension mismatch: " + std::to_string(reader.Dimension()));
+			}
+			if(reader.ReadValue<std::uint32_t>("scheme") != CheckpointScheme())
+			{
+				throw std::runtime_error("Checkpoint was written with another scheme");
+			}
+			environment.T() = reader.ReadValue<double>("t");
+			environment.Dt() = reader.ReadValue<double>("dt");
+			forwardCount = reader.ReadValue<std::size_t>("forwardCount");
+
+			// 粒子
+			{
+				std::vector<typename Particle::Type> type;
+				std::vector<Vector> x;
+				std::vector<Vector> u;
+				std::vector<double> p;
+				std::vector<double> nd;
+				reader.ReadArray("particles.type", type);
+				reader.ReadVectors<DIM>("particles.x", x);
+				reader.ReadVectors<DIM>("particles.u", u);
+				reader.ReadArray("particles.p", p);
+				reader.ReadArray("particles.n", nd);
+
+				const auto n = type.size();
+				if((x.size() != n) || (u.size() != n) || (p.size() != n) || (nd.size() != n))
+				{
+					throw std::runtime_error("Checkpoint particles are inconsistent");
+				}
+				particles = ParticleArray();
+				particles.reserve(n);
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					Particle particle(type[i]);
+					particle.X() = x[i];
+					particle.U() = u[i];
+					particle.P() = p[i];
+					particle.N() = nd[i];
+					particles.push_back(particle);
+				}
+			}
+			const auto n = particles.size();
+			reader.ReadArray("originalId", originalId);
+			if(originalId.size() != n)
+			{
+				throw std::runtime_error("Checkpoint particles are inconsistent");
+			}
+			currentId.resize(n);
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+				currentId[originalId[i]] = i;
+			}
+
+			reader.ReadArray("neighborStart", neighborStart);
+			reader.ReadArray("neighbor", neighbor);
+			reader.ReadVectors<DIM>("searchedX", searchedX);
+			searchCount = reader.ReadValue<std::size_t>("searchCount");
+
+			reader.ReadVectors<DIM>("du", du);
+			reader.ReadArray("ecs", ecs);
+#ifndef PRESSURE_EXPLICIT
+			reader.ReadArray("dndt", dndt);
+#endif
+			reader.ReadVectors<DIM>("originalX", originalX);
+			reader.ReadArray("nWithoutSpp", nWithoutSpp);
+
+#ifndef PRESSURE_EXPLICIT
+			ppe.iterationCount = reader.ReadValue<std::size_t>("ppe.iterationCount");
+			ppe.historyCount = reader.ReadValue<std::size_t>("ppe.historyCount");
+			ppe.historyT = reader.ReadValue<decltype(ppe.historyT)>("ppe.historyT");
+			for(auto k = decltype(ppe.history.size()){0}; k < ppe.history.size(); k++)
+			{
+				reader.ReadArray("ppe.history" + std::to_string(k), ppe.history[k]);
+			}
+
+			ppe.preconditioning.amgReuseCount = reader.ReadValue<std::size_t>("ppe.amgReuseCount");
+			ppe.preconditioning.amg.Load(reader, "ppe.amg");
+
+			// 係数行列の非零成分の位置は作り直す
+			ppe.patternSearchCount = InvalidPattern();
+#endif
+		}
+
+		// 粒子を並べ替える間隔（時間刻みの回数、0なら並べ替えない）
+		std::size_t& ReorderInterval()
+		{
+			return reorderInterval;
+		}
+
+		// 近傍粒子リストを複数ステップで使い回すかどうか
+		bool& ReuseNeighbor()
+		{
+			return reuseNeighbor;
+		}
+
+		// これまでに近傍粒子探索をした回数
+		auto SearchCount() const
+		{
+			return searchCount;
+		}
+
+#ifndef PRESSURE_EXPLICIT
+		// 圧力方程式を解く時の前処理
+		Preconditioner& PpePreconditioner()
+		{
+			return ppe.preconditioner;
+		}
+
+		// 代数的マルチグリッド法の階層を作り直す間隔（時間刻みの回数、0なら毎回）
+		std::size_t& AmgSetupInterval()
+		{
+			return ppe.preconditioning.amgSetupInterval;
+		}
+
+		// 圧力方程式を解く共役勾配法の種類
+		ConjugateGradientMethod& PpeConjugateGradientMethod()
+		{
+			return ppe.method;
+		}
+
+		// 圧力方程式の係数行列を作らずに解くかどうか（前処理は対角スケーリングのみ）
+		bool& PpeMatrixFree()
+		{
+			return ppe.matrixFree;
+		}
+
+		// 圧力方程式を単精度と倍精度の反復改良で解くかどうか（係数行列を作る時のみ）
+		bool& PpeMixedPrecision()
+		{
+			return ppe.mixedPrecision;
+		}
+
+		// これまでに圧力方程式の共役勾配法で反復した回数
+		auto PpeIterationCount() const
+		{
+			return ppe.iterationCount;
+		}
+
+		// 圧力方程式の共役勾配法の最大反復回数（0なら未知数の数）
+		std::size_t& PpeMaxIteration()
+		{
+			return ppe.maxIteration;
+		}
+
+		// 圧力方程式の未知数の初期値の決め方
+		InitialGuess& PpeInitialGuess()
+		{
+			return ppe.initialGuess;
+		}
+
+		// 圧力方程式の収束判定で残差と比べる基準
+		ResidualReference& PpeResidualReference()
+		{
+			return ppe.residualReference;
+		}
+#endif
+
 		// 計算空間パラメーターを取得する
 		const Environment& GetEnvironment() const
 		{
@@ -1816,21 +3354,26 @@ namespace { namespace OpenMps
 	// @param env MPS計算用の計算空間固有パラメータ
 	// @param posWall 壁粒子の位置
 	// @param posWallPre 壁粒子の位置計算の前処理
-	template<typename POSITION_WALL, typename POSITION_WALL_PRE>
+	// @param scheme 計算手法の組み合わせ
+	// @tparam SCHEME 計算手法の組み合わせ（SchemeかDynamicScheme）
+	// @tparam DIM 次元（計算空間パラメータから決まる）
+	template<typename SCHEME = DefaultScheme, std::size_t DIM, typename POSITION_WALL, typename POSITION_WALL_PRE>
 	inline decltype(auto) CreateComputer(
 #ifndef PRESSURE_EXPLICIT
 		const double allowableResidual,
 #endif
-		const Environment& env,
+		const Environment<DIM>& env,
 		const POSITION_WALL& posWall,
-		const POSITION_WALL_PRE& posWallPre)
+		const POSITION_WALL_PRE& posWallPre,
+		const SCHEME& scheme = SCHEME{})
 	{
-		return Computer<decltype(posWall), decltype(posWallPre)>(
+		return Computer<decltype(posWall), decltype(posWallPre), SCHEME, DIM>(
 #ifndef PRESSURE_EXPLICIT
 			allowableResidual,
 #endif
 			env,
-			posWall, posWallPre);
+			posWall, posWallPre,
+			scheme);
 	}
 }}
 #endif
@@ -3,6 +3,14 @@
 
 #include "defines.hpp"
 
+#pragma warning(push, 0)
+#include <string>
+#pragma warning(pop)
+
+#include "Preconditioner.hpp"
+#include "ConjugateGradient.hpp"
+#include "Snapshot.hpp"
+
 namespace { namespace OpenMps
 {
 	// MPS計算の計算条件
@@ -13,6 +21,30 @@ namespace { namespace OpenMps
 #ifndef PRESSURE_EXPLICIT
 		// 収束判定誤差
 		const double Eps = 1e-10;
+
+		// 圧力方程式を解く時の前処理
+		const Preconditioner PpePreconditioner;
+
+		// 代数的マルチグリッド法の階層を作り直す間隔（時間刻みの回数、0なら毎回）
+		const std::size_t AmgSetupInterval;
+
+		// 圧力方程式の係数行列を作らずに解くかどうか
+		const bool PpeMatrixFree;
+
+		// 圧力方程式を解く共役勾配法の種類
+		const ConjugateGradientMethod PpeConjugateGradientMethod;
+
+		// 圧力方程式を単精度と倍精度の反復改良で解くかどうか
+		const bool PpeMixedPrecision;
+
+		// 圧力方程式の共役勾配法の最大反復回数（0なら未知数の数）
+		const std::size_t PpeMaxIteration;
+
+		// 圧力方程式の未知数の初期値の決め方
+		const InitialGuess PpeInitialGuess;
+
+		// 圧力方程式の収束判定で残差と比べる基準
+		const ResidualReference PpeResidualReference;
 #endif
 
 		// 開始時刻
@@ -24,25 +56,91 @@ namespace { namespace OpenMps
 		// 出力時間刻み
 		const double OutputInterval;
 
+		// 計算結果の出力形式
+		const OutputFormat ResultFormat;
+
+		// 計算結果を専用のスレッドで書き出すかどうか
+		const bool AsyncOutput;
+
+		// 粒子を空間的に並べ替える間隔（時間刻みの回数、0なら並べ替えない）
+		const std::size_t ReorderInterval;
+
+		// 近傍粒子リストを複数ステップで使い回すかどうか
+		const bool ReuseNeighbor;
+
+		// 時間刻み毎の計算の統計を出力するCSVファイル名（空なら出力しない）
+		const std::string TelemetryLog;
+
+		// チェックポイントを書き出す間隔（時間刻みの回数、0なら終了を要求された時だけ書き出す）
+		const std::size_t CheckpointInterval;
+
+		// チェックポイントがあれば、そこから計算を再開するかどうか
+		const bool Resume;
+
 #ifndef PRESSURE_EXPLICIT
 		// @param eps 収束判定誤差
+		// @param ppePreconditioner 圧力方程式を解く時の前処理
+		// @param amgSetupInterval 代数的マルチグリッド法の階層を作り直す間隔
+		// @param ppeMatrixFree 圧力方程式の係数行列を作らずに解くかどうか
+		// @param ppeConjugateGradientMethod 圧力方程式を解く共役勾配法の種類
+		// @param ppeMixedPrecision 圧力方程式を単精度と倍精度の反復改良で解くかどうか
+		// @param ppeMaxIteration 圧力方程式の共役勾配法の最大反復回数
+		// @param ppeInitialGuess 圧力方程式の未知数の初期値の決め方
+		// @param ppeResidualReference 圧力方程式の収束判定で残差と比べる基準
 #endif
 		// @param startTime 開始時刻
 		// @param endTime 終了時刻
 		// @param outputInterval 出力時間刻み
+		// @param resultFormat 計算結果の出力形式
+		// @param asyncOutput 計算結果を専用のスレッドで書き出すかどうか
+		// @param reorderInterval 粒子を並べ替える間隔
+		// @param reuseNeighbor 近傍粒子リストを使い回すかどうか
+		// @param telemetryLog 計算の統計を出力するCSVファイル名
+		// @param checkpointInterval チェックポイントを書き出す間隔
+		// @param resume チェックポイントから計算を再開するかどうか
 		ComputingCondition(
 #ifndef PRESSURE_EXPLICIT
 			const double eps,
+			const Preconditioner ppePreconditioner,
+			const std::size_t amgSetupInterval,
+			const bool ppeMatrixFree,
+			const ConjugateGradientMethod ppeConjugateGradientMethod,
+			const bool ppeMixedPrecision,
+			const std::size_t ppeMaxIteration,
+			const InitialGuess ppeInitialGuess,
+			const ResidualReference ppeResidualReference,
 #endif
 			const double startTime,
 			const double endTime,
-			const double outputInterval)
+			const double outputInterval,
+			const OutputFormat resultFormat,
+			const bool asyncOutput,
+			const std::size_t reorderInterval,
+			const bool reuseNeighbor,
+			const std::string& telemetryLog,
+			const std::size_t checkpointInterval,
+			const bool resume)
 			:
 #ifndef PRESSURE_EXPLICIT
 			Eps(eps),
+			PpePreconditioner(ppePreconditioner),
+			AmgSetupInterval(amgSetupInterval),
+			PpeMatrixFree(ppeMatrixFree),
+			PpeConjugateGradientMethod(ppeConjugateGradientMethod),
+			PpeMixedPrecision(ppeMixedPrecision),
+			PpeMaxIteration(ppeMaxIteration),
+			PpeInitialGuess(ppeInitialGuess),
+			PpeResidualReference(ppeResidualReference),
 #endif
 			StartTime(startTime), EndTime(endTime),
-			OutputInterval(outputInterval)
+			OutputInterval(outputInterval),
+			ResultFormat(resultFormat),
+			AsyncOutput(asyncOutput),
+			ReorderInterval(reorderInterval),
+			ReuseNeighbor(reuseNeighbor),
+			TelemetryLog(telemetryLog),
+			CheckpointInterval(checkpointInterval),
+			Resume(resume)
 		{}
 
 		ComputingCondition(ComputingCondition&&) = default;
@@ -0,0 +1,164 @@
+﻿#ifndef CONJUGATE_GRADIENT_INCLUDED
+#define CONJUGATE_GRADIENT_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <type_traits>
+#include <array>
+#include <algorithm>
+#pragma warning(pop)
+
+namespace { namespace OpenMps
+{
+	// 圧力方程式を解く共役勾配法の種類
+	enum class ConjugateGradientMethod
+	{
+		// 通常の前処理付き共役勾配法（1反復で内積の集計が3回）
+		Standard,
+
+		// Chronopoulos-Gear法（内積をまとめて計算し、1反復で集計が1回）
+		ChronopoulosGear,
+	};
+
+	// 圧力方程式の未知数の初期値の決め方
+	enum class InitialGuess
+	{
+		// 前の時刻の粒子の圧力（負圧と自由表面の圧力は0になっている）
+		Pressure,
+
+		// 前の時刻の解をそのまま使う
+		Previous,
+
+		// 前の2時刻の解から時間方向に線形外挿
+		Linear,
+
+		// 前の3時刻の解から時間方向に2次外挿
+		Quadratic,
+	};
+
+	// 圧力方程式の収束判定で残差と比べる基準
+	enum class ResidualReference
+	{
+		// 初期残差（初期値の良し悪しに依らず、同じ割合だけ残差を減らす）
+		Initial,
+
+		// 右辺ベクトル（初期値が良いほど反復が減る）
+		RightHandSide,
+	};
+
+	namespace Detail { namespace ConjugateGradient
+	{
+		// 過去の解から時間方向に外挿する時の各解の重みを計算する（ラグランジュ補間）
+		// ※同じ時刻の解が含まれていると外挿できないので、その手前までの解に次数を下げる
+		// @param t 外挿する時刻
+		// @param times 過去の解の時刻（新しい順）
+		// @param count 使いたい過去の解の数
+		// @param weights 各解の重み
+		// @return 実際に使う過去の解の数
+		template<std::size_t N>
+		inline std::size_t ExtrapolationWeights(const double t, const std::array<double, N>& times, std::size_t count, std::array<double, N>& weights)
+		{
+			count = std::min(count, N);
+			for(auto k = decltype(count){1}; k < count; k++)
+			{
+				for(auto m = decltype(k){0}; m < k; m++)
+				{
+					if(times[k] == times[m])
+					{
+						count = k;
+					}
+				}
+			}
+
+			weights.fill(0);
+			for(auto k = decltype(count){0}; k < count; k++)
+			{
+				auto w = 1.0;
+				for(auto m = decltype(count){0}; m < count; m++)
+				{
+					if(m != k)
+					{
+						w *= (t - times[m]) / (times[k] - times[m]);
+					}
+				}
+				weights[k] = w;
+			}
+			return count;
+		}
+
+		// Chronopoulos-Gear法のベクトルの更新をまとめて1回で計算する
+		//  p = u + βp
+		//  s = w + βs
+		//  x += αp
+		//  r -= αs
+		// @param alpha α
+		// @param beta β
+		// @param u 前処理後の残差
+		// @param w 係数行列と前処理後の残差の積
+		// @param p 探索方向
+		// @param s 係数行列と探索方向の積
+		// @param x 解
+		// @param r 残差
+		template<typename VECTOR>
+		inline void Update(const double alpha, const double beta,
+			const VECTOR& u, const VECTOR& w,
+			VECTOR& p, VECTOR& s, VECTOR& x, VECTOR& r)
+		{
+			const auto n = x.size();
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				const auto p_i = u(i) + beta * p(i);
+				const auto s_i = w(i) + beta * s(i);
+				p(i) = p_i;
+				s(i) = s_i;
+				x(i) += alpha * p_i;
+				r(i) -= alpha * s_i;
+			}
+		}
+
+		// Chronopoulos-Gear法で使う内積をまとめて1回で計算する
+		// @param r 残差
+		// @param u 前処理後の残差
+		// @param w 係数行列と前処理後の残差の積
+		// @param ru (r, u)
+		// @param wu (w, u)
+		// @param rr (r, r)
+		template<typename VECTOR>
+		inline void InnerProducts(const VECTOR& r, const VECTOR& u, const VECTOR& w,
+			double& ru, double& wu, double& rr)
+		{
+			const auto n = r.size();
+			auto sumRu = 0.0;
+			auto sumWu = 0.0;
+			auto sumRr = 0.0;
+#ifdef _OPENMP
+			#pragma omp parallel for reduction(+:sumRu, sumWu, sumRr)
+#endif
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				const auto r_i = r(i);
+				const auto u_i = u(i);
+				sumRu += r_i * u_i;
+				sumWu += w(i) * u_i;
+				sumRr += r_i * r_i;
+			}
+			ru = sumRu;
+			wu = sumWu;
+			rr = sumRr;
+		}
+	}}
+}}
+#endif
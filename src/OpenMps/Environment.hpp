@@ -1,13 +1,24 @@
 ﻿#ifndef ENVIRONMENT_INCLUDED
 #define ENVIRONMENT_INCLUDED
 
+#pragma warning(push, 0)
+#include <array>
+#include <algorithm>
+#pragma warning(pop)
+
 #include "Vector.hpp"
+#include "Particle.hpp"
 
 namespace { namespace OpenMps
 {
 	// MPS計算用の計算空間固有パラメータ
+	// @tparam DIM 次元
+	template<std::size_t DIM = OpenMps::DIM>
 	class Environment final
 	{
+	public:
+		using Vector = OpenMps::Vector<DIM>;
+
 	private:
 		// 現在時刻
 		double t;
@@ -18,10 +29,8 @@ namespace { namespace OpenMps
 		// 基準粒子数密度
 		double n0;
 
-#ifndef MPS_HL
-		// 拡散モデル定数
+		// 拡散モデル定数（HL法では使わない）
 		double lambda;
-#endif
 
 	public:
 
@@ -59,10 +68,8 @@ namespace { namespace OpenMps
 		// 動粘性係数
 		const double Nu;
 
-#ifndef MPS_SPP
-		// 自由表面を判定する係数
+		// 自由表面を判定する係数（SPP法では使わない）
 		const double SurfaceRatio;
-#endif
 
 		// 計算空間の最小座標
 		const Vector MinX;
@@ -83,21 +90,11 @@ namespace { namespace OpenMps
 		// @param rho 密度
 		// @param nu 動粘性係数
 		// @param r_eByl_0 影響半径と初期粒子間距離の比
-#ifndef MPS_SPP
 		// @param surfaceRatio 自由表面判定の係数
-#endif
 		// @param c 音速
 		// @param l_0 初期粒子間距離
-		// @param minX 計算空間の最小X座標
-#ifdef DIM3
-		// @param minY 計算空間の最小Y座標
-#endif
-		// @param minZ 計算空間の最小Z座標
-		// @param maxX 計算空間の最大X座標
-#ifdef DIM3
-		// @param maxY 計算空間の最大Y座標
-#endif
-		// @param maxZ 計算空間の最大Z座標
+		// @param minX 計算空間の最小座標
+		// @param maxX 計算空間の最大座標
 		Environment(
 			const double maxDt,
 			const double courant,
@@ -108,24 +105,14 @@ namespace { namespace OpenMps
 			const double g,
 			const double rho,
 			const double nu,
-#ifndef MPS_SPP
 			const double surfaceRatio,
-#endif
 			const double r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 			const double c,
 #endif
 			const double l_0,
-			const double minX,
-#ifdef DIM3
-			const double minY,
-#endif
-			const double minZ,
-			const double maxX,
-#ifdef DIM3
-			const double maxY,
-#endif
-			const double maxZ)
+			const Vector& minX,
+			const Vector& maxX)
 			:t(0), dt(0),
 
 #ifdef PRESSURE_EXPLICIT
@@ -143,76 +130,73 @@ namespace { namespace OpenMps
 			MaxDx(courant*l_0),
 			L_0(l_0),
 			R_e(r_eByl_0 * l_0),
-#ifdef DIM3
-			G(CreateVector(0, 0, -g)),
-#else
-			G(CreateVector(0, -g)),
-#endif
+			G(Gravity(g)),
 			Rho(rho),
 			Nu(nu),
-#ifndef MPS_SPP
 			SurfaceRatio(surfaceRatio),
-#endif
-#ifdef DIM3
-			MinX(CreateVector(minX, minY, minZ)), MaxX(CreateVector(maxX, maxY, maxZ)),
-#else
-			MinX(CreateVector(minX, minZ)), MaxX(CreateVector(maxX, maxZ)),
-#endif
+			MinX(minX), MaxX(maxX),
 			NeighborLength(r_eByl_0 * l_0 * (1 + courant*2)) // 計算の安定化のためクーラン数の2倍の距離までを近傍粒子として保持する
 		{
 			// 基準粒子数密度とλの計算
 			const auto range = static_cast<int>(std::ceil(r_eByl_0));
 			n0 = 0;
-#ifndef MPS_HL
 			lambda = 0;
-#endif
-			for (auto i = -range; i < range; i++)
+
+			// 各方向に-rangeからrange-1までの格子点を、最後の方向が連続する順に辿る
+			std::array<int, DIM> index;
+			index.fill(-range);
+			for (auto isEnd = false; !isEnd; )
 			{
-				for (auto j = -range; j < range; j++)
+				// 自分以外との
+				if (std::any_of(index.cbegin(), index.cend(), [](const int i) { return i != 0; }))
 				{
-#ifdef DIM3
-					for (auto k = -range; k < range; k++)
+					// 相対位置を計算
+					Vector x;
+					for (auto d = decltype(DIM){0}; d < DIM; d++)
 					{
-						// 自分以外との
-						if (!((i == 0) && (j == 0) && (k == 0)))
-						{
-							// 相対位置を計算
-							const auto x = CreateVector(i*l_0, j*l_0, k*l_0);
-#else
-						// 自分以外との
-						if (!((i == 0) && (j == 0)))
-						{
-							// 相対位置を計算
-							const auto x = CreateVector(i*l_0, j*l_0);
-#endif
+						x[d] = index[d] * l_0;
+					}
 
-							// 影響半径内なら
-							const auto r = boost::numeric::ublas::norm_2(x);
-							if (r < R_e)
-							{
-								// 重み関数を計算
-								const auto w = Particle::W(r, R_e);
+					// 影響半径内なら
+					const auto r = boost::numeric::ublas::norm_2(x);
+					if (r < R_e)
+					{
+						// 重み関数を計算
+						const auto w = Particle<DIM>::W(r, R_e);
 
-								// 基準粒子数密度に足す
-								n0 += w;
+						// 基準粒子数密度に足す
+						n0 += w;
 
-#ifndef MPS_HL
-								// λに足す
-								lambda += r*r * w;
-#endif
-							}
-						}
-#ifdef DIM3
+						// λに足す
+						lambda += r*r * w;
 					}
-#endif
+				}
+
+				// 次の格子点へ
+				isEnd = true;
+				for (auto d = DIM; d > 0; d--)
+				{
+					if (++index[d - 1] < range)
+					{
+						isEnd = false;
+						break;
+					}
+					index[d - 1] = -range;
 				}
 			}
 
-#ifndef MPS_HL
 			// λの最終計算
 			// λ = (Σr^2 w)/(Σw)
 			lambda /= n0;
-#endif
+		}
+
+		// 鉛直下向きの重力加速度
+		// @param g 重力加速度の大きさ
+		static Vector Gravity(const double g)
+		{
+			auto G = VectorZero<DIM>;
+			G[Axis<DIM>::Z] = -g;
+			return G;
 		}
 
 		// 時刻を進める
@@ -225,6 +209,10 @@ namespace { namespace OpenMps
 		{
 			return t;
 		}
+		double& T()
+		{
+			return t;
+		}
 
 		double& Dt()
 		{
@@ -240,12 +228,10 @@ namespace { namespace OpenMps
 			return n0;
 		}
 
-#ifndef MPS_HL
 		double Lambda() const
 		{
 			return lambda;
 		}
-#endif
 
 		// 代入演算子
 		// @param src 代入元
@@ -254,18 +240,14 @@ namespace { namespace OpenMps
 			this->t = src.t;
 			this->dt = src.dt;
 			this->n0 = src.n0;
-#ifndef MPS_HL
 			this->lambda = src.lambda;
-#endif
 			const_cast<double&>(this->MaxDt) = src.MaxDt;
 			const_cast<double&>(this->MaxDx) = src.MaxDx;
 			const_cast<double&>(this->R_e) = src.R_e;
 			const_cast<Vector&>(this->G) = src.G;
 			const_cast<double&>(this->Rho) = src.Rho;
 			const_cast<double&>(this->Nu) = src.Nu;
-#ifndef MPS_SPP
 			const_cast<double&>(this->SurfaceRatio) = src.SurfaceRatio;
-#endif
 #ifdef ARTIFICIAL_COLLISION_FORCE
 			const_cast<double&>(TooNearLength) = src.TooNearLength;
 			const_cast<double&>(TooNearCoefficient) = src.TooNearCoefficient;
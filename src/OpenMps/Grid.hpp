@@ -4,52 +4,65 @@
 #pragma warning(push, 0)
 #include <iterator>
 #include <array>
-#include <boost/multi_array.hpp>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
 #pragma warning(pop)
 
+#include "defines.hpp"
 #include "Vector.hpp"
-
-// OpenMP関連
-#ifdef _OPENMP
-	#if _OPENMP < 200805 // v3.0未満の場合、atomic captureが使えないので
-		#define ATOMIC_LOCK
-	#endif
-#endif
-#ifdef ATOMIC_LOCK
-#include <omp.h>
-#endif
+#include "PrefixSum.hpp"
 
 namespace { namespace OpenMps
 {
 	// 近傍粒子探索用グリッド
+	// 粒子をブロック番号で計数ソートし、各ブロックの先頭位置とブロック順に並べた粒子番号の組で保持する
+	// @tparam DIM 次元
+	template<std::size_t DIM = OpenMps::DIM>
 	class Grid final
 	{
 	public:
+		using Vector = OpenMps::Vector<DIM>;
 		using ParticleID = std::size_t;
 
-		// 探索対象ブロックの総数
-#ifdef DIM3
-		static constexpr std::size_t MAX_NEIGHBOR_BLOCK = 3 * 3 * 3; // 3次元なので
-#else
-		static constexpr std::size_t MAX_NEIGHBOR_BLOCK = 3 * 3; // 2次元なので
-#endif
+		// 探索対象ブロックの総数（各方向に前後と自分の3ブロックずつ）
+		static constexpr std::size_t MAX_NEIGHBOR_BLOCK = (DIM == 3) ? (3 * 3 * 3) : (3 * 3);
 
 	private:
+		using Index = std::ptrdiff_t;
+
+		// 各方向のブロック番号
+		using Blocks = std::array<Index, DIM>;
+
+		// 格納されていない粒子のブロック番号
+		static constexpr std::size_t NOT_STORED = std::numeric_limits<std::size_t>::max();
+
 		// 1ブロックの長さ（影響半径に等しい）
 		const double blockLength;
 
 		// 原点（計算空間の最大座標に等しい）
 		const Vector origin;
 
-		// 各ブロックの粒子番号
-		boost::multi_array<ParticleID, DIM + 1> data;
+		// 各方向の最大ブロック数
+		const Blocks size;
 
-#ifdef ATOMIC_LOCK
-		// 登録粒子数計算用のスレッドロック
-		boost::multi_array<::omp_lock_t, DIM> locks;
-#endif
+		// 各ブロックの先頭の粒子の位置（末尾には格納した粒子数が入る）
+		std::vector<ParticleID> cellStart;
 
-		using Index = decltype(data)::index;
+		// ブロック番号順に並べた粒子番号
+		std::vector<ParticleID> sortedIds;
+
+		// 各粒子のブロック番号
+		std::vector<std::size_t> cell;
+
+		// 各粒子のブロック内での順番（格納時の作業用）
+		std::vector<ParticleID> rank;
+
+		// 1ブロック内の最大粒子数
+		ParticleID maxParticles;
 
 		static auto Ceil(const double a, const double b)
 		{
@@ -60,412 +73,286 @@ namespace { namespace OpenMps
 			return static_cast<Index>(std::floor(a / b));
 		}
 
-		// 最大ブロック数
-		template<decltype(AXIS_X) AXIS>
-		auto GridSize() const
+		// 各方向の最大ブロック数（近傍粒子探索の分を含める）
+		// @param neighborLength 近傍粒子半径
+		// @param minX 計算空間の最小座標
+		// @param maxX 計算空間の最大座標
+		static auto GridSize(const double neighborLength, const Vector& minX, const Vector& maxX)
+		{
+			Blocks s;
+			for (auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				s[d] = Ceil(maxX[d] - minX[d], neighborLength) + 2;
+			}
+			return s;
+		}
+
+		// 全ブロック数
+		auto CellCount() const
 		{
-			return static_cast<Index>(data.shape()[AXIS]);
+			auto count = std::size_t{1};
+			for (auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				count *= static_cast<std::size_t>(size[d]);
+			}
+			return count;
 		}
 
-#ifdef DIM3
-		// 各ブロック内の粒子
-		auto& Particle(const Index i, const Index j, const Index k, const Index l)
+		// 範囲内のブロックかどうか
+		// @param b 各方向のブロック番号
+		bool IsInside(const Blocks& b) const
 		{
-			return data[i][j][k][l + 1]; // 先頭は粒子数を格納してある
+			for (auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				if((b[d] < 0) || (size[d] <= b[d]))
+				{
+					return false;
+				}
+			}
+			return true;
 		}
-		auto Particle(const Index i, const Index j, const Index k, const Index l) const
+
+		// 1次元化したブロック番号（最後の方向が連続する）
+		// @param b 各方向のブロック番号
+		std::size_t CellIndex(const Blocks& b) const
 		{
-			return data[i][j][k][l + 1]; // 先頭は粒子数を格納してある
+			auto index = b[0];
+			for (auto d = decltype(DIM){1}; d < DIM; d++)
+			{
+				index = index * size[d] + b[d];
+			}
+			return static_cast<std::size_t>(index);
 		}
-#else
-		// 各ブロック内の粒子
-		auto& Particle(const Index i, const Index k, const Index l)
+
+		// 対象の位置を含む各方向のブロック番号
+		// @param x 対象の位置
+		Blocks Block(const Vector& x) const
 		{
-			return data[i][k][l + 1]; // 先頭は粒子数を格納してある
+			Blocks b;
+			for (auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				b[d] = Floor(x[d] - origin[d], blockLength);
+			}
+			return b;
 		}
-		auto Particle(const Index i, const Index k, const Index l) const
+
+		// 対象の位置を含むブロックの1次元化した番号（範囲外ならNOT_STORED）
+		std::size_t CellIndex(const Vector& x) const
 		{
-			return data[i][k][l + 1]; // 先頭は粒子数を格納してある
+			const auto b = Block(x);
+			return IsInside(b) ? CellIndex(b) : NOT_STORED;
 		}
-#endif
 
 	public:
 
-		struct Exception : public std::runtime_error
-		{
-		public:
-			Exception(std::string&& msg)
-				: std::runtime_error(msg)
-			{}
-		};
-
 		// @param neighborLength 近傍粒子半径
-		// @param l_0 初期粒子間距離
 		// @param minX 計算空間の最小座標
 		// @param maxX 計算空間の最大座標
-		Grid(const double neighborLength, const double l_0,
+		Grid(const double neighborLength,
 			const Vector& minX, const Vector& maxX)
 			: blockLength(neighborLength), origin(minX),
-			data(boost::extents
-				[Ceil(maxX[AXIS_X] - minX[AXIS_X], neighborLength)+2] // 水平方向の最大ブロック数（近傍粒子探索の分を含める）
-#ifdef DIM3
-				[Ceil(maxX[AXIS_Y] - minX[AXIS_Y], neighborLength) + 2] // 奥行き方向の最大ブロック数（近傍粒子探索の分を含める）
-#endif
-				[Ceil(maxX[AXIS_Z] - minX[AXIS_Z], neighborLength)+2] // 鉛直方向の最大ブロック数（近傍粒子探索の分を含める）
-#ifdef DIM3
-				[1 + (Ceil(neighborLength, l_0) + 1)*(Ceil(neighborLength, l_0) + 1)*(Ceil(neighborLength, l_0) + 1)]) // 1ブロック内の最大粒子数＋存在する粒子数
-#else
-				[1 + (Ceil(neighborLength, l_0)+1)*(Ceil(neighborLength, l_0) + 1)]) // 1ブロック内の最大粒子数＋存在する粒子数
-#endif
-#ifdef ATOMIC_LOCK
-			, locks(boost::extents
-				[data.shape()[AXIS_X]]
-#ifdef DIM3
-				[data.shape()[AXIS_Y]]
-#endif
-				[data.shape()[AXIS_Z]])
-#endif
-		{
-#ifdef ATOMIC_LOCK
-			const auto nx = GridSize<AXIS_X>();
-#ifdef DIM3
-			const auto ny = GridSize<AXIS_Y>();
-#endif
-			const auto nz = GridSize<AXIS_Z>();
-			for (auto i = decltype(nx){0}; i < nx; i++)
-			{
-#ifdef DIM3
-				for (auto j = decltype(ny){0}; j < nx; j++)
-				{
-#endif
-					for (auto k = decltype(nz){0}; k < nz; k++)
-					{
-#ifdef DIM3
-						::omp_init_lock(&(locks[i][j][k]));
-#else
-						::omp_init_lock(&(locks[i][k]));
-#endif
-					}
-#ifdef DIM3
-				}
-#endif
-			}
-#endif
-		}
-
-#ifdef ATOMIC_LOCK
-		~Grid()
-		{
-			const auto nx = GridSize<AXIS_X>();
-#ifdef DIM3
-			const auto ny = GridSize<AXIS_Y>();
-#endif
-			const auto nz = GridSize<AXIS_Z>();
-			for (auto i = decltype(nx){0}; i < nx; i++)
-			{
-#ifdef DIM3
-				for (auto j = decltype(ny){0}; j < nx; j++)
-				{
-#endif
-					for (auto k = decltype(nz){0}; k < nz; k++)
-					{
-#ifdef DIM3
-						::omp_destroy_lock(&(locks[i][j][k]));
-#else
-						::omp_destroy_lock(&(locks[i][k]));
-#endif
-					}
-#ifdef DIM3
-				}
-#endif
-			}
-		}
-#endif
+			size(GridSize(neighborLength, minX, maxX)),
+			cellStart(CellCount() + 1, 0),
+			sortedIds(), cell(), rank(),
+			maxParticles(0)
+		{}
 
 		Grid(Grid&&) = default;
 		Grid(const Grid&) = delete;
 		Grid& operator = (const Grid&) = delete;
 
-		// 全消去（全ブロックの粒子数を0にする）
-		void Clear()
+		// 対象の位置を含むブロックのモートン符号（Z曲線上の順番）
+		// ※近い位置のブロックほど近い値になるので、粒子の並べ替えに使う
+		// @param x 対象の位置
+		std::uint64_t MortonCode(const Vector& x) const
 		{
-			const auto nx = GridSize<AXIS_X>();
-#ifdef DIM3
-			const auto ny = GridSize<AXIS_Y>();
-#endif
-			const auto nz = GridSize<AXIS_Z>();
-			for (auto i = decltype(nx){0}; i < nx; i++)
+			// 各方向のブロック番号のビットを交互に並べる
+			constexpr std::size_t BITS = 64 / DIM; // 64ビットに全方向分詰めるので
+			const auto b = Block(x);
+			std::array<std::uint64_t, DIM> block;
+			for (auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				// 範囲外は端のブロックに寄せる
+				block[d] = static_cast<std::uint64_t>(std::max(b[d], Index{0}));
+			}
+
+			std::uint64_t code = 0;
+			for (auto bit = decltype(BITS){0}; bit < BITS; bit++)
 			{
-#ifdef DIM3
-				for (auto j = decltype(ny){0}; j < nx; j++)
+				for (auto d = decltype(DIM){0}; d < DIM; d++)
 				{
-#endif
-					for (auto k = decltype(nz){0}; k < nz; k++)
-					{
-#ifdef DIM3
-						data[i][j][k][0] = 0; // 先頭は粒子数を格納してある
-#else
-						data[i][k][0] = 0; // 先頭は粒子数を格納してある
-#endif
-					}
-#ifdef DIM3
+					code |= ((block[d] >> bit) & 1) << (bit*DIM + d);
 				}
-#endif
 			}
+			return code;
 		}
 
-		// 対象の位置を含むブロック番号
-		template<decltype(AXIS_X) AXIS>
-		auto Block(const Vector& x) const
-		{
-			return Floor(x[AXIS] - origin[AXIS], blockLength);
-		}
-
-		// 各ブロック内の粒子数
-#ifdef DIM3
-		auto ParticleCount(const Index i, const Index j, const Index k) const
-		{
-			return data[i][j][k][0]; // 先頭は粒子数を格納してある
-		}
-#else
-		auto ParticleCount(const Index i, const Index k) const
+		// 1ブロック内の最大粒子数（最後に格納した時の値）
+		auto MaxParticles() const
 		{
-			return data[i][k][0]; // 先頭は粒子数を格納してある
+			return maxParticles;
 		}
-#endif
 
-		// 1ブロック内の最大粒子数
-		auto MaxParticles() const
+		// 粒子が格納されているかどうか
+		// @param particle 粒子番号
+		bool IsStored(const ParticleID particle) const
 		{
-			return static_cast<ParticleID>(data.shape()[AXIS_Z + 1]) - 1; // 先頭の粒子数の格納分を除く
+			return cell[particle] != NOT_STORED;
 		}
 
-		// 粒子を格納する
-		bool Store(const Vector& x, const ParticleID particle)
+		// 全粒子を格納する（以前の格納内容は全て破棄される）
+		// @param n 粒子数
+		// @param getX 粒子の位置を取得する関数
+		// @param isTarget 格納対象の粒子かどうかを判定する関数
+		template<typename GET_X, typename IS_TARGET>
+		void Store(const std::size_t n, const GET_X getX, const IS_TARGET isTarget)
 		{
-			const auto i = Block<AXIS_X>(x); const auto nx = GridSize<AXIS_X>();
-#ifdef DIM3
-			const auto j = Block<AXIS_Y>(x); const auto ny = GridSize<AXIS_Y>();
-#endif
-			const auto k = Block<AXIS_Z>(x); const auto nz = GridSize<AXIS_Z>();
+			cell.resize(n);
+			rank.resize(n);
+			sortedIds.resize(n);
+			std::fill(cellStart.begin(), cellStart.end(), 0);
 
-			// 領域外なら格納しない
-			if(
-				(0 <= i) && (i < nx) &&
-#ifdef DIM3
-				(0 <= j) && (j < ny) &&
-#endif
-				(0 <= k) && (k < nz))
-			{
-				decltype(data)::element l;
+			// 各ブロックの粒子数を数える
+			// ※ブロック番号の次の位置に数えておくと、累積和がそのまま先頭位置になる
 #ifdef ATOMIC_LOCK
-				auto lock = &locks[i]
-#ifdef DIM3
-					[j]
-#endif
-					[k];
-				omp_set_lock(lock);
+			// atomic captureが使えないので逐次処理
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
 #else
-#ifdef _OPENMP
-				#pragma omp atomic capture
-#endif
-#endif
-#ifdef DIM3
-				l = data[i][j][k][0]++;
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
 #else
-				l = data[i][k][0]++;
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
 #endif
-#ifdef ATOMIC_LOCK
-				omp_unset_lock(lock);
 #endif
+				// 対象外の粒子と領域外の粒子は格納しない
+				const auto c = isTarget(i) ? CellIndex(getX(i)) : NOT_STORED;
+				cell[i] = c;
 
-				const auto maxCount = MaxParticles();
-				if(l >= maxCount)
+				if (c != NOT_STORED)
 				{
-					throw Exception("Too many particle in a block");
+					ParticleID l;
+#ifdef _OPENMP
+#ifndef ATOMIC_LOCK
+					#pragma omp atomic capture
+#endif
+#endif
+					l = cellStart[c + 1]++;
+					rank[i] = l;
 				}
-#ifdef DIM3
-				Particle(i, j, k, static_cast<Index>(l)) = particle;
+			}
+
+			// 最大粒子数を取得
+			maxParticles = *std::max_element(cellStart.cbegin(), cellStart.cend());
+
+			// 累積して各ブロックの先頭位置にする
+			Detail::PrefixSum(cellStart);
+
+			// ブロック番号順に粒子番号を並べる
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
 #else
-				Particle(i, k, static_cast<Index>(l)) = particle;
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
 #endif
-
-				return true;
+				const auto c = cell[i];
+				if (c != NOT_STORED)
+				{
+					sortedIds[cellStart[c] + rank[i]] = i;
+				}
 			}
-			else
+
+#ifndef ATOMIC_LOCK
+			// 並列に数えるとブロック内の順番が実行毎に変わるので、粒子番号順に揃えておく
+			const auto cellCount = CellCount();
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto cc = std::make_signed_t<decltype(cellCount)>{0}; cc < static_cast<std::make_signed_t<decltype(cellCount)>>(cellCount); cc++)
 			{
-				return false;
+				const auto c = static_cast<decltype(cellCount)>(cc);
+#else
+			for (auto c = decltype(cellCount){0}; c < cellCount; c++)
+			{
+#endif
+				if (cellStart[c + 1] - cellStart[c] > 1)
+				{
+					std::sort(sortedIds.begin() + static_cast<std::ptrdiff_t>(cellStart[c]), sortedIds.begin() + static_cast<std::ptrdiff_t>(cellStart[c + 1]));
+				}
 			}
+#endif
 		}
 
 		// 近傍粒子イテレーター
 		struct Iterator final : public std::iterator<std::input_iterator_tag, ParticleID>
 		{
 		private:
-#ifdef DIM3
-			using Block = std::tuple<Index, Index, Index>;
-#else
-			using Block = std::tuple<Index, Index>;
-#endif
-
-			// 末尾の近傍ブロック番号（探索対象ブロックの総数）
-			static constexpr std::size_t LAST_NEIGHBOR = MAX_NEIGHBOR_BLOCK;
+			// 1ブロック分の粒子番号の範囲
+			using Range = std::pair<const ParticleID*, const ParticleID*>;
 
-			// 末尾も含めた近傍ブロックの総数
-			static constexpr auto MAX_NEIGHBOR = LAST_NEIGHBOR + 1;
+			// 探索対象ブロック（粒子が存在するもののみ）
+			std::array<Range, MAX_NEIGHBOR_BLOCK> neighbor;
 
-			// 参照先のグリッド
-			const Grid& grid;
+			// 探索対象ブロック数
+			std::size_t neighborCount;
 
-			// 探索対象ブロック
-			const std::array<Block, LAST_NEIGHBOR> neighbor;
+			// 今のブロック
+			std::size_t block;
 
-			// 今のイテレーターの遷移状態 = 粒子番号*LAST_NEIGHBOR_ID + 近傍ブロック番号
-			std::size_t index;
+			// 今の粒子
+			const ParticleID* current;
 
 			// begin用
 			// @param g 参照先のグリッド
 			// @param x 探索対象の位置
-			// @param idx 遷移状態
-			Iterator(const Grid& g, const Vector& x, const decltype(index) idx)
-				: grid(g), neighbor{{
-#ifdef DIM3
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) - 1, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) + 0, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Y>(x) + 1, g.Block<AXIS_Z>(x) + 1),
-#else
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) - 1, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 0, g.Block<AXIS_Z>(x) + 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Z>(x) - 1),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Z>(x) + 0),
-				std::make_tuple(g.Block<AXIS_X>(x) + 1, g.Block<AXIS_Z>(x) + 1),
-#endif
-				}},
-				index(idx)
+			Iterator(const Grid& g, const Vector& x)
+				: neighbor(), neighborCount(0), block(0), current(nullptr)
 			{
-				// 先頭ブロックが空なら次のブロックに移動しておく
-				const auto neighborIndex = index%MAX_NEIGHBOR;
-				const auto neighborBlock = neighbor[neighborIndex];
-				const auto i = std::get<AXIS_X>(neighborBlock);
-#ifdef DIM3
-				const auto j = std::get<AXIS_Y>(neighborBlock);
-#endif
-				const auto k = std::get<AXIS_Z>(neighborBlock);
+				const auto b0 = g.Block(x);
 
-#ifdef DIM3
-				auto count = grid.ParticleCount(i, j, k);
-#else
-				auto count = grid.ParticleCount(i, k);
-#endif
-				if(count == 0)
+				// 各方向に前後と自分のブロックを、最後の方向が連続する順に辿る
+				const auto data = g.sortedIds.data();
+				for (auto offset = decltype(MAX_NEIGHBOR_BLOCK){0}; offset < MAX_NEIGHBOR_BLOCK; offset++)
 				{
-					Increment();
-				}
-			}
-
-			// end用
-			// @param g 参照先のグリッド
-			// @param idx 遷移状態
-			Iterator(const Grid& g, const decltype(index) idx)
-				: grid(g), neighbor{}, index(idx)
-			{}
-
-			void Increment()
-			{
-				const auto neighborIndex = index%MAX_NEIGHBOR;
-				const auto neighborBlock = neighbor[neighborIndex];
-				const auto i = std::get<AXIS_X>(neighborBlock);
-#ifdef DIM3
-				const auto j = std::get<AXIS_Y>(neighborBlock);
-#endif
-				const auto k = std::get<AXIS_Z>(neighborBlock);
-				const auto l = index / MAX_NEIGHBOR;
-
-#ifdef DIM3
-				const auto count = grid.ParticleCount(i, j, k);
-#else
-				const auto count = grid.ParticleCount(i, k);
-#endif
-				if(l + 1 >= count)
-				{
-					if(neighborIndex == LAST_NEIGHBOR - 1)
+					Blocks b;
+					auto digits = offset;
+					for (auto d = DIM; d > 0; d--)
 					{
-						// 次が最終ブロックなら最終ブロックに移動するだけ
-						index = LAST_NEIGHBOR;
+						b[d - 1] = b0[d - 1] + static_cast<Index>(digits % 3) - 1;
+						digits /= 3;
 					}
-					else
-					{
-						// 最終ブロック以外なら、次の有効なブロックまで移動
-						const auto nx = grid.GridSize<AXIS_X>();
-#ifdef DIM3
-						const auto ny = grid.GridSize<AXIS_Y>();
-#endif
-						const auto nz = grid.GridSize<AXIS_Z>();
-						bool isValid = false;
-						for(index = neighborIndex; !isValid && (index + 1 < LAST_NEIGHBOR); index++)
-						{
-							const auto nextNeighborBlock = neighbor[index + 1];
-							const auto nextI = std::get<AXIS_X>(nextNeighborBlock);
-#ifdef DIM3
-							const auto nextJ = std::get<AXIS_Y>(nextNeighborBlock);
-#endif
-							const auto nextK = std::get<AXIS_Z>(nextNeighborBlock);
 
-							// 範囲内かつ粒子数が存在するところのみ有効
-							isValid =
-								(0 <= nextI) && (nextI < nx) &&
-#ifdef DIM3
-								(0 <= nextJ) && (nextJ < ny) &&
-#endif
-								(0 <= nextK) && (nextK < nz);
-							if(isValid)
-							{
-#ifdef DIM3
-								const auto nextCount = grid.ParticleCount(nextI, nextJ, nextK);
-#else
-								const auto nextCount = grid.ParticleCount(nextI, nextK);
-#endif
-								isValid = (nextCount > 0);
-							}
-						}
-						if(!isValid) // 最後まで空のブロックが続くなら末尾に移動
+					// 範囲内かつ粒子が存在するところのみ探索対象にする
+					if (g.IsInside(b))
+					{
+						const auto c = g.CellIndex(b);
+						const auto begin = g.cellStart[c];
+						const auto end = g.cellStart[c + 1];
+						if (begin < end)
 						{
-							index = LAST_NEIGHBOR;
+							neighbor[neighborCount] = std::make_pair(data + begin, data + end);
+							neighborCount++;
 						}
 					}
 				}
-				else
-				{
-					index += MAX_NEIGHBOR; // 次の粒子に移動
-				}
+
+				current = (neighborCount > 0) ? neighbor[0].first : nullptr;
+			}
+
+			// end用
+			Iterator()
+				: neighbor(), neighborCount(0), block(0), current(nullptr)
+			{}
+
+			bool IsEnd() const
+			{
+				return block >= neighborCount;
 			}
 
 		public:
@@ -475,54 +362,37 @@ namespace { namespace OpenMps
 			// @param x 探索対象の位置
 			static auto CreateBegin(const Grid& g, const Vector& x)
 			{
-				return Iterator(g, x, decltype(index)(0) +
-#ifdef DIM3
-					3 * 3 * ((g.Block<AXIS_X>(x) == 0) ? 1 : 0) +
-					    3 * ((g.Block<AXIS_Y>(x) == 0) ? 1 : 0) +
-#else
-					    3 * ((g.Block<AXIS_X>(x) == 0) ? 1 : 0) +
-#endif
-					    1 * ((g.Block<AXIS_Z>(x) == 0) ? 1 : 0));
+				return Iterator(g, x);
 			}
 
 			// 末尾イテレーターを作成
-			// @param g 参照先のグリッド
-			// @param x 探索対象の位置
-			static auto CreateEnd(const Grid& g)
+			static auto CreateEnd()
 			{
-				return Iterator(g, LAST_NEIGHBOR);
+				return Iterator();
 			}
 
-			Iterator& operator=(const Iterator&) = delete;
-
 			ParticleID operator*() const
 			{
-				const auto neighborIndex = index%MAX_NEIGHBOR;
-				const auto neighborBlock = neighbor[neighborIndex];
-				const auto i = std::get<AXIS_X>(neighborBlock);
-#ifdef DIM3
-				const auto j = std::get<AXIS_Y>(neighborBlock);
-#endif
-				const auto k = std::get<AXIS_Z>(neighborBlock);
-				const auto l = static_cast<Index>(index / MAX_NEIGHBOR);
-
-#ifdef DIM3
-				return grid.Particle(i, j, k, l);
-#else
-				return grid.Particle(i, k, l);
-#endif
+				return *current;
 			}
 
 			Iterator& operator++()
 			{
-				Increment();
+				++current;
+
+				// ブロックの末尾まで来たら次のブロックに移動
+				if (current == neighbor[block].second)
+				{
+					block++;
+					current = IsEnd() ? nullptr : neighbor[block].first;
+				}
 				return *this;
 			}
 
-			bool operator==(const Iterator& it)
+			bool operator==(const Iterator& it) const
 			{
-				// 遷移状態が同じなら同じイテレーターとする
-				return this->index == it.index;
+				// 両方末尾か、同じ粒子を指していれば同じイテレーターとする
+				return (this->IsEnd() && it.IsEnd()) || (this->current == it.current);
 			}
 		};
 
@@ -535,7 +405,7 @@ namespace { namespace OpenMps
 		// 末尾イテレーターを作成
 		auto cend() const
 		{
-			return Iterator::CreateEnd(*this);
+			return Iterator::CreateEnd();
 		}
 	};
 }}
@@ -4,8 +4,11 @@
 #include <ctime>
 #include <type_traits>
 #include <sstream>
-#include <unordered_map>
 #include <algorithm>
+#include <array>
+#include <string>
+#include <memory>
+#include <csignal>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -14,8 +17,12 @@
 
 #include "ComputingCondition.hpp"
 #include "Computer.hpp"
+#include "Snapshot.hpp"
+#include "AsyncOutput.hpp"
+#include "Vtu.hpp"
+#include "Checkpoint.hpp"
+#include "ParticleCsv.hpp"
 #include "Timer.hpp"
-#include "stov.hpp"
 
 // iccはC++14の対応が遅れているので
 #ifdef __INTEL_COMPILER
@@ -29,37 +36,49 @@ namespace { namespace std
 namespace
 {
 	// 計算結果をCSVへ出力する
-	template<typename COMPUTER>
-	inline auto OutputToCsv(const COMPUTER& computer, const std::size_t& outputCount)
+	// @tparam DIM 次元
+	// @param n 粒子数
+	// @param getParticle 粒子番号から粒子を取得する関数
+	template<std::size_t DIM, typename GET_PARTICLE>
+	inline auto OutputToCsv(const std::size_t n, GET_PARTICLE getParticle, const std::size_t& outputCount)
 	{
+		using Particle = OpenMps::Particle<DIM>;
+
 		// ファイルを開く
 		auto filename = (boost::format("result/particles_%05d.csv") % outputCount).str();
 		std::ofstream output(filename);
 
 		// ヘッダ出力
-#ifdef DIM3
-		output << "Type, x, y, z, u, v, w, p, n" << std::endl;
-#else
-		output << "Type, x, z, u, w, p, n" << std::endl;
-#endif
+		output << "Type, ";
+		for(const auto& name : OpenMps::AxisName<DIM>::X())
+		{
+			output << name << ", ";
+		}
+		for(const auto& name : OpenMps::AxisName<DIM>::U())
+		{
+			output << name << ", ";
+		}
+		output << "p, n" << "\n";
 
 		// 各粒子を出力
 		std::size_t nonDisalbeCount = 0;
-		for(const auto& particle : computer.Particles())
+		for(auto id = decltype(n){0}; id < n; id++)
 		{
+			const auto& particle = getParticle(id);
+			output << static_cast<std::underlying_type_t<typename Particle::Type>>(particle.TYPE()) << ", ";
+			for(auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				output << particle.X()[d] << ", ";
+			}
+			for(auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				output << particle.U()[d] << ", ";
+			}
 			output
-				<< static_cast<std::underlying_type_t<OpenMps::Particle::Type>>(particle.TYPE()) << ", "
-#ifdef DIM3
-				<< particle.X()[0] << ", " << particle.X()[1] << ", " << particle.X()[2] << ", "
-				<< particle.U()[0] << ", " << particle.U()[1] << ", " << particle.U()[2] << ", "
-#else
-				<< particle.X()[0] << ", " << particle.X()[1] << ", "
-				<< particle.U()[0] << ", " << particle.U()[1] << ", "
-#endif
 				<< particle.P() << ", "
-				<< particle.N() << std::endl;
+				<< particle.N() << "\n"; // 1行毎にフラッシュすると遅いので
 
-			if (particle.TYPE() != OpenMps::Particle::Type::Disabled)
+			if (particle.TYPE() != Particle::Type::Disabled)
 			{
 				nonDisalbeCount++;
 			}
@@ -68,132 +87,79 @@ namespace
 		return nonDisalbeCount;
 	}
 
-	// 粒子を読み込む
-	inline auto InputFromCsv(const std::string& csv)
+	// 計算結果をスナップショット（バイナリ）へ出力する
+	// @tparam DIM 次元
+	// @param n 粒子数
+	// @param getParticle 粒子番号から粒子を取得する関数
+	// @param t 時刻
+	template<std::size_t DIM, typename GET_PARTICLE>
+	inline auto OutputToSnapshot(const std::size_t n, GET_PARTICLE getParticle, const std::size_t& outputCount, const double t)
 	{
-		std::vector<OpenMps::Particle> particles;
-
-		std::vector<std::string> input;
-		boost::algorithm::split(input, csv, boost::is_any_of("\n"));
-
-		// 先頭の空行は飛ばす
-		auto itr = input.cbegin();
-		for (; itr->size() == 0; ++itr) {}
-
-		// 行をカンマ区切りで分割する関数
-		const auto GetItems = [](std::string str)
-		{
-			str.erase(std::remove_if(str.begin(), str.end(),
-				[](const char c)
-				{
-					return (c == ' ') || (c == '\t');
-				}), str.end());
-
-			std::vector<std::string> data;
-			if (str.size() > 0)
-			{
-				boost::algorithm::split(data, str, boost::is_any_of(","));
-			}
-			return data;
-		};
-
-		// ヘッダー項目の列番号を取得（ない場合は0が入る）
-		constexpr std::size_t HEADER_NOT_FOUND = 0;
-		auto header = std::unordered_map<std::string, std::size_t>(
-		{
-			{ "Type", HEADER_NOT_FOUND },
-			{ "x", HEADER_NOT_FOUND },
-#ifdef DIM3
-			{ "y", HEADER_NOT_FOUND },
-#endif
-			{ "z", HEADER_NOT_FOUND },
-			{ "u", HEADER_NOT_FOUND },
-#ifdef DIM3
-			{ "v", HEADER_NOT_FOUND },
-#endif
-			{ "w", HEADER_NOT_FOUND },
-			{ "p", HEADER_NOT_FOUND },
-			{ "n", HEADER_NOT_FOUND },
-		});
-		{
-			// 先頭行を読み込み
-			auto& line = *itr; ++itr;
-			const auto headerItems = GetItems(line);
-			for (auto i = decltype(headerItems.size())(0); i < headerItems.size(); i++)
-			{
-				const auto name = headerItems[i];
-				if (header.find(name) != header.end())
-				{
-					header[name] = static_cast<decltype(header)::mapped_type>(i + 1); // 列番号+1を格納しておく（0が「ない」を表すため）
-				}
-				else
-				{
-					throw std::runtime_error("Illegal header item in input csv");
-				}
-			}
-
-			for (auto& item : header)
-			{
-				// ない項目があったらエラー
-				if (item.second == HEADER_NOT_FOUND)
-				{
-					throw std::runtime_error("Some header item doesn't exist");
-				}
+		const auto filename = (boost::format("result/particles_%05d.bin") % outputCount).str();
+		return OpenMps::WriteSnapshot<DIM>(filename, n, t, getParticle);
+	}
 
-				// 列番号に戻す
-				item.second--;
-			}
-		}
+	// 計算結果をVTK XMLの非構造格子へ出力し、時系列に追加する
+	// @tparam DIM 次元
+	// @param n 粒子数
+	// @param getParticle 粒子番号から粒子を取得する関数
+	// @param t 時刻
+	// @param collection 時系列
+	template<std::size_t DIM, typename GET_PARTICLE>
+	inline auto OutputToVtu(const std::size_t n, GET_PARTICLE getParticle, const std::size_t& outputCount, const double t, OpenMps::VtuCollection& collection)
+	{
+		const auto file = (boost::format("particles_%05d.vtu") % outputCount).str();
+		const auto count = OpenMps::WriteVtu<DIM>("result/" + file, n, t, getParticle);
+		collection.Add(t, file);
+		return count;
+	}
 
-		// 粒子を作成して入れていく
-		for (;itr != input.cend(); ++itr)
+	// 計算結果を出力する
+	// @tparam DIM 次元
+	// @param format 出力形式
+	// @param n 粒子数
+	// @param getParticle 粒子番号から粒子を取得する関数
+	// @param t 時刻
+	// @param collection VTK XMLの時系列
+	template<std::size_t DIM, typename GET_PARTICLE>
+	inline auto OutputResult(const OpenMps::OutputFormat format, const std::size_t n, GET_PARTICLE getParticle, const std::size_t& outputCount, const double t, OpenMps::VtuCollection& collection)
+	{
+		switch(format)
 		{
-			auto& line = *itr;
-			const auto data = GetItems(line);
-			if (data.size() > 0) // 空行は飛ばす
-			{
-				auto particle = OpenMps::Particle(static_cast<OpenMps::Particle::Type>(stov<std::underlying_type_t<OpenMps::Particle::Type>>(data[header["Type"]])));
-
-				// 位置ベクトル
-				particle.X()[OpenMps::AXIS_X] = stov<double>(data[header["x"]]);
-#ifdef DIM3
-				particle.X()[OpenMps::AXIS_Y] = stov<double>(data[header["y"]]);
-#endif
-				particle.X()[OpenMps::AXIS_Z] = stov<double>(data[header["z"]]);
-
-				// 速度ベクトル
-				particle.U()[OpenMps::AXIS_X] = stov<double>(data[header["u"]]);
-#ifdef DIM3
-				particle.U()[OpenMps::AXIS_Y] = stov<double>(data[header["v"]]);
-#endif
-				particle.U()[OpenMps::AXIS_Z] = stov<double>(data[header["w"]]);
+		case OpenMps::OutputFormat::Binary:
+			return OutputToSnapshot<DIM>(n, getParticle, outputCount, t);
 
-				// 圧力
-				particle.P() = stov<double>(data[header["p"]]);
+		case OpenMps::OutputFormat::Vtu:
+			return OutputToVtu<DIM>(n, getParticle, outputCount, t, collection);
 
-				// 粒子数密度
-				particle.N() = stov<double>(data[header["n"]]);
-
-				particles.push_back(std::move(particle));
-			}
+		default:
+			return OutputToCsv<DIM>(n, getParticle, outputCount);
 		}
-
-		// 粒子数を表示
-		std::cout << particles.size() << " particles" << std::endl;
-
-		return particles;
 	}
 
 	// 粒子の初期状態を読み込む
+	// @tparam DIM 次元
+	template<std::size_t DIM>
 	inline decltype(auto) LoadParticles(const boost::property_tree::ptree& xml)
 	{
 		// 粒子データの読み込み
-		std::vector<OpenMps::Particle> particles;
+		std::vector<OpenMps::Particle<DIM>> particles;
 		auto type = xml.get_optional<std::string>("openmps.particles.<xmlattr>.type").get();
 		if (type == "csv")
 		{
-			const auto txt = xml.get<std::string>("openmps.particles");
-			particles = InputFromCsv(std::move(txt));
+			// ファイルが指定されていればそこから、無ければ要素の中身から読み込む
+			const auto file = xml.get_optional<std::string>("openmps.particles.<xmlattr>.file");
+			particles = file ?
+				OpenMps::ReadParticleCsv<DIM>(*file) :
+				OpenMps::ParseParticleCsv<DIM>(xml.get<std::string>("openmps.particles"));
+			std::cout << particles.size() << " particles" << std::endl;
+		}
+		else if (type == "snapshot")
+		{
+			// 以前の計算結果のスナップショットから始める
+			const auto file = xml.get<std::string>("openmps.particles.<xmlattr>.file");
+			particles = OpenMps::SnapshotReader(file).Particles<DIM>();
+			std::cout << particles.size() << " particles" << std::endl;
 		}
 		else
 		{
@@ -203,8 +169,29 @@ namespace
 		return particles;
 	}
 
+	// 計算手法の組み合わせを読み込む
+	// ※古い入力にはないので、無ければdefines.hppで指定した既定値を使う
+	inline auto LoadScheme(const boost::property_tree::ptree& xml)
+	{
+		auto scheme = OpenMps::DefaultScheme::Selection();
+		scheme.Hs = xml.get<bool>("openmps.scheme.hs.<xmlattr>.value", scheme.Hs);
+		scheme.Hl = xml.get<bool>("openmps.scheme.hl.<xmlattr>.value", scheme.Hl);
+		scheme.Ecs = xml.get<bool>("openmps.scheme.ecs.<xmlattr>.value", scheme.Ecs);
+		scheme.Gc = xml.get<bool>("openmps.scheme.gc.<xmlattr>.value", scheme.Gc);
+		scheme.Ds = xml.get<bool>("openmps.scheme.ds.<xmlattr>.value", scheme.Ds);
+		scheme.Spp = xml.get<bool>("openmps.scheme.spp.<xmlattr>.value", scheme.Spp);
+#ifdef PRESSURE_EXPLICIT
+		// 陽解法では圧力方程式を解かないので、その生成項を修正するECS法は使わない
+		scheme.Ecs = false;
+#endif
+		return scheme;
+	}
+
 	// 計算環境を読み込む
-	inline decltype(auto) LoadEnvironment(const boost::property_tree::ptree& xml, const double outputInterval)
+	// @tparam DIM 次元
+	// @param scheme 計算手法の組み合わせ
+	template<std::size_t DIM>
+	inline decltype(auto) LoadEnvironment(const boost::property_tree::ptree& xml, const double outputInterval, const OpenMps::SchemeSelection& scheme)
 	{
 		const auto l_0 = xml.get<double>("openmps.environment.l_0.<xmlattr>.value");
 		const auto minStepCountPerOutput = xml.get<std::size_t>("openmps.environment.minStepCountPerOutput.<xmlattr>.value");
@@ -214,9 +201,9 @@ namespace
 		const double rho = xml.get<double>("openmps.environment.rho.<xmlattr>.value");
 		const double nu = xml.get<double>("openmps.environment.nu.<xmlattr>.value");
 		const double r_eByl_0 = xml.get<double>("openmps.environment.r_eByl_0.<xmlattr>.value");
-#ifndef MPS_SPP
-		const double surfaceRatio = xml.get<double>("openmps.environment.surfaceRatio.<xmlattr>.value");
-#endif
+		const double surfaceRatio = scheme.Spp ?
+			xml.get<double>("openmps.environment.surfaceRatio.<xmlattr>.value", 0) : // SPP法では自由表面を判定しないので無くても良い
+			xml.get<double>("openmps.environment.surfaceRatio.<xmlattr>.value");
 #ifdef PRESSURE_EXPLICIT
 		const double c = xml.get<double>("openmps.environment.c.<xmlattr>.value");
 #endif
@@ -225,59 +212,219 @@ namespace
 		const double tooNearCoefficient = xml.get<double>("openmps.environment.tooNearCoefficient.<xmlattr>.value");
 #endif
 
-		const double minX = xml.get<double>("openmps.environment.minX.<xmlattr>.value");
-#ifdef DIM3
-		const double minY = xml.get<double>("openmps.environment.minY.<xmlattr>.value");
-#endif
-		const double minZ = xml.get<double>("openmps.environment.minZ.<xmlattr>.value");
-		const double maxX = xml.get<double>("openmps.environment.maxX.<xmlattr>.value");
-#ifdef DIM3
-		const double maxY = xml.get<double>("openmps.environment.maxY.<xmlattr>.value");
-#endif
-		const double maxZ = xml.get<double>("openmps.environment.maxZ.<xmlattr>.value");
+		// 計算空間の範囲（minX, maxXなど）
+		OpenMps::Vector<DIM> minX, maxX;
+		const auto name = OpenMps::AxisName<DIM>::X();
+		for(auto d = decltype(DIM){0}; d < DIM; d++)
+		{
+			const auto axis = boost::algorithm::to_upper_copy(name[d]);
+			minX[d] = xml.get<double>("openmps.environment.min" + axis + ".<xmlattr>.value");
+			maxX[d] = xml.get<double>("openmps.environment.max" + axis + ".<xmlattr>.value");
+		}
 
-		return OpenMps::Environment(outputInterval / minStepCountPerOutput, courant,
+		return OpenMps::Environment<DIM>(outputInterval / minStepCountPerOutput, courant,
 #ifdef ARTIFICIAL_COLLISION_FORCE
 			tooNearRatio, tooNearCoefficient,
 #endif
 			g, rho, nu,
-#ifndef MPS_SPP
 			surfaceRatio,
-#endif
 			r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 			c,
 #endif
 			l_0,
-#ifdef DIM3
-			minX, minY, minZ,
-			maxX, maxY, maxZ
-#else
-			minX, minZ,
-			maxX, maxZ
-#endif
+			minX, maxX
 		);
 	}
 
+#ifndef PRESSURE_EXPLICIT
+	// 圧力方程式の前処理を名前から取得する
+	// @param name 前処理の名前
+	inline OpenMps::Preconditioner GetPreconditioner(const std::string& name)
+	{
+		if(name == "none")
+		{
+			return OpenMps::Preconditioner::None;
+		}
+		else if(name == "jacobi")
+		{
+			return OpenMps::Preconditioner::Jacobi;
+		}
+		else if(name == "ic0")
+		{
+			return OpenMps::Preconditioner::IncompleteCholesky;
+		}
+		else if(name == "ssor")
+		{
+			return OpenMps::Preconditioner::Ssor;
+		}
+		else if(name == "amg")
+		{
+			return OpenMps::Preconditioner::Amg;
+		}
+		else
+		{
+			throw std::runtime_error("Unknown preconditioner: " + name);
+		}
+	}
+
+	// 圧力方程式を解く共役勾配法の種類を名前から取得する
+	// @param name 共役勾配法の名前
+	inline OpenMps::ConjugateGradientMethod GetConjugateGradientMethod(const std::string& name)
+	{
+		if(name == "standard")
+		{
+			return OpenMps::ConjugateGradientMethod::Standard;
+		}
+		else if(name == "chronopoulosGear")
+		{
+			return OpenMps::ConjugateGradientMethod::ChronopoulosGear;
+		}
+		else
+		{
+			throw std::runtime_error("Unknown conjugate gradient method: " + name);
+		}
+	}
+
+	// 圧力方程式の未知数の初期値の決め方を名前から取得する
+	// @param name 初期値の決め方の名前
+	inline OpenMps::InitialGuess GetInitialGuess(const std::string& name)
+	{
+		if(name == "pressure")
+		{
+			return OpenMps::InitialGuess::Pressure;
+		}
+		else if(name == "previous")
+		{
+			return OpenMps::InitialGuess::Previous;
+		}
+		else if(name == "linear")
+		{
+			return OpenMps::InitialGuess::Linear;
+		}
+		else if(name == "quadratic")
+		{
+			return OpenMps::InitialGuess::Quadratic;
+		}
+		else
+		{
+			throw std::runtime_error("Unknown initial guess: " + name);
+		}
+	}
+
+	// 圧力方程式の収束判定で残差と比べる基準を名前から取得する
+	// @param name 基準の名前
+	inline OpenMps::ResidualReference GetResidualReference(const std::string& name)
+	{
+		if(name == "initial")
+		{
+			return OpenMps::ResidualReference::Initial;
+		}
+		else if(name == "rhs")
+		{
+			return OpenMps::ResidualReference::RightHandSide;
+		}
+		else
+		{
+			throw std::runtime_error("Unknown residual reference: " + name);
+		}
+	}
+#endif
+
+	// 計算結果の出力形式を名前から取得する
+	// @param name 出力形式の名前
+	inline OpenMps::OutputFormat GetOutputFormat(const std::string& name)
+	{
+		if(name == "csv")
+		{
+			return OpenMps::OutputFormat::Csv;
+		}
+		else if(name == "binary")
+		{
+			return OpenMps::OutputFormat::Binary;
+		}
+		else if(name == "vtu")
+		{
+			return OpenMps::OutputFormat::Vtu;
+		}
+		else
+		{
+			throw std::runtime_error("Unknown output format: " + name);
+		}
+	}
+
 	// 計算条件を読み込む
 	inline decltype(auto) LoadCondition(const boost::property_tree::ptree& xml)
 	{
 		const auto startTime = xml.get<double>("openmps.condition.startTime.<xmlattr>.value");
 		const auto endTime = xml.get<double>("openmps.condition.endTime.<xmlattr>.value");
 		const auto outputInterval = xml.get<double>("openmps.condition.outputInterval.<xmlattr>.value");
+		const auto outputFormat = GetOutputFormat(xml.get<std::string>("openmps.condition.outputFormat.<xmlattr>.value", "csv")); // 古い入力にはないので既定値を使う
+		const auto asyncOutput = xml.get<bool>("openmps.condition.asyncOutput.<xmlattr>.value", false); // 古い入力にはないので既定値を使う
 #ifndef PRESSURE_EXPLICIT
 		const auto eps = xml.get<double>("openmps.condition.eps.<xmlattr>.value");
+		const auto preconditioner = GetPreconditioner(xml.get<std::string>("openmps.condition.preconditioner.<xmlattr>.value", "none")); // 古い入力にはないので既定値を使う
+		const auto amgSetupInterval = xml.get<std::size_t>("openmps.condition.amgSetupInterval.<xmlattr>.value", 10); // 古い入力にはないので既定値を使う
+		const auto matrixFree = xml.get<bool>("openmps.condition.matrixFree.<xmlattr>.value", false); // 古い入力にはないので既定値を使う
+		if(matrixFree && (preconditioner != OpenMps::Preconditioner::None) && (preconditioner != OpenMps::Preconditioner::Jacobi))
+		{
+			// 係数行列が無いと作れない前処理は使えない
+			throw std::runtime_error("matrixFree can be used only with preconditioner none or jacobi");
+		}
+		const auto conjugateGradient = GetConjugateGradientMethod(xml.get<std::string>("openmps.condition.conjugateGradient.<xmlattr>.value", "standard")); // 古い入力にはないので既定値を使う
+		const auto mixedPrecision = xml.get<bool>("openmps.condition.mixedPrecision.<xmlattr>.value", false); // 古い入力にはないので既定値を使う
+		if(mixedPrecision && (matrixFree || (conjugateGradient != OpenMps::ConjugateGradientMethod::Standard)))
+		{
+			// 単精度の係数行列を作り、内側は通常の共役勾配法で解くので組み合わせられない
+			throw std::runtime_error("mixedPrecision can be used only with conjugateGradient standard and without matrixFree");
+		}
+		const auto maxIteration = xml.get<std::size_t>("openmps.condition.maxIteration.<xmlattr>.value", 0); // 古い入力にはないので既定値を使う
+		const auto initialGuess = GetInitialGuess(xml.get<std::string>("openmps.condition.initialGuess.<xmlattr>.value", "pressure")); // 古い入力にはないので既定値を使う
+		const auto residualReference = GetResidualReference(xml.get<std::string>("openmps.condition.residualReference.<xmlattr>.value", "initial")); // 古い入力にはないので既定値を使う
 #endif
+		const auto reorderInterval = xml.get<std::size_t>("openmps.condition.reorderInterval.<xmlattr>.value", 100); // 古い入力にはないので既定値を使う
+		const auto reuseNeighbor = xml.get<bool>("openmps.condition.reuseNeighbor.<xmlattr>.value", false); // 古い入力にはないので既定値を使う
+		const auto telemetryLog = xml.get<std::string>("openmps.condition.telemetryLog.<xmlattr>.value", ""); // 古い入力にはないので既定値を使う
+		const auto checkpointInterval = xml.get<std::size_t>("openmps.condition.checkpointInterval.<xmlattr>.value", 0); // 古い入力にはないので既定値を使う
+		const auto resume = xml.get<bool>("openmps.condition.resume.<xmlattr>.value", false); // 古い入力にはないので既定値を使う
 
 		return OpenMps::ComputingCondition(
 #ifndef PRESSURE_EXPLICIT
 			eps,
+			preconditioner,
+			amgSetupInterval,
+			matrixFree,
+			conjugateGradient,
+			mixedPrecision,
+			maxIteration,
+			initialGuess,
+			residualReference,
 #endif
 			startTime, endTime,
-			outputInterval
+			outputInterval,
+			outputFormat,
+			asyncOutput,
+			reorderInterval,
+			reuseNeighbor,
+			telemetryLog,
+			checkpointInterval,
+			resume
 		);
 	}
 
+	// チェックポイントの出力先
+	static const std::string checkpointFilename = "result/checkpoint.bin";
+
+	// 終了が要求されたかどうか（シグナルを受けたら立てる）
+	static volatile std::sig_atomic_t isStopRequested = 0;
+
+	// 終了を要求するシグナルを受け付ける
+	// ※すぐには止めず、今の時間刻みを終えてチェックポイントを書き出してから止める
+	static void RequestStop(int)
+	{
+		isStopRequested = 1;
+	}
+
 	template<typename T>
 	static void System(T&& arg)
 	{
@@ -287,115 +434,339 @@ namespace
 			throw std::runtime_error("Error!");
 		}
 	}
-}
 
-// エントリポイント
-int main(const int argc, const char* const argv[])
-{
-	System("mkdir result");
+	// 計算する
+	// @tparam SCHEME 計算手法の組み合わせ
+	// @param scheme 計算手法の組み合わせ
+	// @param condition 計算条件
+	// @param environment 計算空間パラメーター
+	// @param particles 初期状態の粒子
+	template<typename SCHEME, std::size_t DIM>
+	inline void Run(const SCHEME& scheme, const OpenMps::ComputingCondition& condition, const OpenMps::Environment<DIM>& environment, std::vector<OpenMps::Particle<DIM>>&& particles)
+	{
+		// 粒子の初期位置を保存
+		auto initialPosition = std::make_unique<OpenMps::Vector<DIM>[]>(particles.size());
+		std::transform(particles.cbegin(), particles.cend(), initialPosition.get(),
+			[](auto particle)
+			{
+				return particle.X();
+			});
 
-	const auto filename = (argc == 1) ? "../../Benchmark/DamBreak/Sample.xml" : argv[1];
-	std::cout << "Input XML file: " << filename << std::endl;
-	auto xml = std::make_unique<boost::property_tree::ptree>();
-	boost::property_tree::read_xml(filename, *xml);
+		// 壁は動かさない
+		const auto positionWall = [&initialPosition](auto i, auto, auto)
+		{
+			return initialPosition[i];
+		};
+		const auto positionWallPre = [](auto, auto)
+		{
+		};
 
-	auto&& condition = LoadCondition(*xml);
-	auto&& environment = LoadEnvironment(*xml, condition.OutputInterval);
-	auto&& particles = LoadParticles(*xml);
+		// 計算空間の初期化
+		auto computer = OpenMps::CreateComputer<SCHEME>(
+	#ifndef PRESSURE_EXPLICIT
+			condition.Eps,
+	#endif
+			environment,
+			positionWall, positionWallPre,
+			scheme);
+
+		// 粒子を追加
+		computer.AddParticles(std::move(particles));
+		computer.ReorderInterval() = condition.ReorderInterval;
+		computer.ReuseNeighbor() = condition.ReuseNeighbor;
+	#ifndef PRESSURE_EXPLICIT
+		computer.PpePreconditioner() = condition.PpePreconditioner;
+		computer.AmgSetupInterval() = condition.AmgSetupInterval;
+		computer.PpeMatrixFree() = condition.PpeMatrixFree;
+		computer.PpeConjugateGradientMethod() = condition.PpeConjugateGradientMethod;
+		computer.PpeMixedPrecision() = condition.PpeMixedPrecision;
+		computer.PpeMaxIteration() = condition.PpeMaxIteration;
+		computer.PpeInitialGuess() = condition.PpeInitialGuess;
+		computer.PpeResidualReference() = condition.PpeResidualReference;
+	#endif
+
+		// 開始時間を保存
+		Timer timer;
+		timer.Start();
+		boost::format timeFormat("#%3$05d: t=%1$8.4lf (%2$05d), %10$12d particles, %11$5d searches, %12$8.4lf s/step at most, "
+	#ifndef PRESSURE_EXPLICIT
+			"%13$7.1lf iterations/step (%14$5d at most), assembly %15$7.2lf s, solve %16$7.2lf s, "
+	#endif
+			"@ %4$02d/%5$02d %6$02d:%7$02d:%8$02d (%9$8.2lf)");
+
+		// チェックポイントがあれば、計算の全状態と出力の進み具合を読み込んで続きから再開する
+		const auto isResumed = condition.Resume && std::ifstream(checkpointFilename).good();
+		auto firstOutputCount = std::size_t{1};
+		double nextOutputT = condition.OutputInterval;
+		std::size_t iteration = 0;
+		if(isResumed)
+		{
+			OpenMps::CheckpointReader reader(checkpointFilename);
+			computer.LoadCheckpoint(reader);
+			firstOutputCount = reader.ReadValue<std::size_t>("outputCount");
+			nextOutputT = reader.ReadValue<double>("nextOutputT");
+			iteration = reader.ReadValue<std::size_t>("iteration");
+			std::cout << "Resumed from " << checkpointFilename << ": t=" << computer.GetEnvironment().T() + condition.StartTime << " (" << iteration << ")" << std::endl;
+		}
 
-	xml.~unique_ptr(); // 読み込んだテキストデータを強制的に廃棄
+		// 時間刻み毎の計算の統計を出力するファイルを開く
+		// ※再開した時は続きに追記する
+		std::ofstream telemetryLog;
+		if(!condition.TelemetryLog.empty())
+		{
+			telemetryLog.open(condition.TelemetryLog, isResumed ? std::ios::app : std::ios::out);
+			if(!isResumed)
+			{
+				telemetryLog << "step, t, dt, stepTime"
+	#ifndef PRESSURE_EXPLICIT
+					<< ", iterations, initialResidual, finalResidual, assemblyTime, solveTime"
+	#endif
+					<< std::endl;
+			}
+		}
 
-	// 粒子の初期位置を保存
-	auto initialPosition = std::make_unique<OpenMps::Vector[]>(particles.size());
-	std::transform(particles.cbegin(), particles.cend(), initialPosition.get(),
-		[](auto particle)
+		// 計算結果の出力
+		// ※非同期出力では、粒子を複製したらすぐに計算を続け、書き出しは専用のスレッドで行う
+		const auto resultFormat = condition.ResultFormat;
+		OpenMps::VtuCollection vtuCollection("result/particles.pvd");
+		std::unique_ptr<OpenMps::AsyncOutput<DIM>> asyncOutput;
+		if(condition.AsyncOutput)
 		{
-			return particle.X();
-		});
+			asyncOutput = std::make_unique<OpenMps::AsyncOutput<DIM>>(
+				[resultFormat, &vtuCollection](const std::vector<OpenMps::Particle<DIM>>& outputParticles, const std::size_t outputCount, const double t)
+				{
+					OutputResult<DIM>(resultFormat, outputParticles.size(),
+						[&outputParticles](const std::size_t id) -> decltype(auto)
+						{
+							return outputParticles[id];
+						},
+						outputCount, t, vtuCollection);
+				});
+		}
+		const auto Output = [&computer, &asyncOutput, resultFormat, &vtuCollection](const std::size_t outputCount, const double t)
+		{
+			// 元の粒子番号順
+			const auto n = computer.Particles().size();
+			const auto getParticle = [&computer](const std::size_t id)
+			{
+				return computer.OriginalParticle(id);
+			};
+			return asyncOutput ?
+				asyncOutput->Push(n, getParticle, outputCount, t) :
+				OutputResult<DIM>(resultFormat, n, getParticle, outputCount, t, vtuCollection);
+		};
 
-	// 壁は動かさない
-	const auto positionWall = [&initialPosition](auto i, auto, auto)
-	{
-		return initialPosition[i];
-	};
-	const auto positionWallPre = [](auto, auto)
-	{
-	};
+		const auto outputIterationOffset = static_cast<std::size_t>(std::ceil(condition.StartTime / condition.OutputInterval));
+		if(!isResumed)
+		{
+			// 初期状態を出力
+			const auto count = Output(outputIterationOffset, condition.StartTime);
 
-	// 計算空間の初期化
-	auto computer = OpenMps::CreateComputer(
-#ifndef PRESSURE_EXPLICIT
-		condition.Eps,
-#endif
-		environment,
-		positionWall, positionWallPre);
+			// 開始時間を画面表示
+			const auto tComputer = condition.StartTime;
+			const auto t = std::time(nullptr);
+			const auto tm = std::localtime(&t);
+			std::cout << timeFormat % tComputer % 0 % outputIterationOffset
+				% (tm->tm_mon + 1) % tm->tm_mday % tm->tm_hour % tm->tm_min % tm->tm_sec
+				% timer.Time() % count % 0 % 0.0
+	#ifndef PRESSURE_EXPLICIT
+				% 0.0 % 0 % 0.0 % 0.0
+	#endif
+				<< std::endl;
+		}
 
-	// 粒子を追加
-	computer.AddParticles(std::move(particles));
+		// 計算が終了するまで
+		auto searchCount = computer.SearchCount();
+		auto isStopped = false;
+		const auto endCount = static_cast<std::size_t>(std::ceil((condition.EndTime - condition.StartTime) / condition.OutputInterval));
+		for(auto outputCount = firstOutputCount; outputCount <= endCount; outputCount++)
+		{
+			double tComputer = computer.GetEnvironment().T();
+			try
+			{
+				// この出力間隔での計算の統計
+				auto maxStepTime = 0.0;
+	#ifndef PRESSURE_EXPLICIT
+				const auto iterationBegin = iteration;
+				auto ppeIterationCount = std::size_t{0};
+				auto maxPpeIterationCount = std::size_t{0};
+				auto assemblyTime = 0.0;
+				auto solveTime = 0.0;
+	#endif
+				while(tComputer < nextOutputT)
+				{
+					// 時間を進める
+					const auto telemetry = computer.ForwardTime();
+					tComputer = computer.GetEnvironment().T();
+					iteration++;
+
+					maxStepTime = std::max(maxStepTime, telemetry.stepTime);
+	#ifndef PRESSURE_EXPLICIT
+					ppeIterationCount += telemetry.iterationCount;
+					maxPpeIterationCount = std::max(maxPpeIterationCount, telemetry.iterationCount);
+					assemblyTime += telemetry.assemblyTime;
+					solveTime += telemetry.solveTime;
+	#endif
+
+					// 統計を出力
+					if(telemetryLog.is_open())
+					{
+						telemetryLog << iteration << ", "
+							<< tComputer + condition.StartTime << ", "
+							<< computer.GetEnvironment().Dt() << ", "
+							<< telemetry.stepTime
+	#ifndef PRESSURE_EXPLICIT
+							<< ", " << telemetry.iterationCount
+							<< ", " << telemetry.initialResidual
+							<< ", " << telemetry.finalResidual
+							<< ", " << telemetry.assemblyTime
+							<< ", " << telemetry.solveTime
+	#endif
+							<< "\n";
+					}
+
+					// 一定間隔と終了を要求された時に、チェックポイントを書き出す
+					const auto isCheckpointStep = (condition.CheckpointInterval > 0) && (iteration % condition.CheckpointInterval == 0);
+					if(isCheckpointStep || isStopRequested)
+					{
+						// それまでの結果と統計は書き終えておく
+						if(asyncOutput)
+						{
+							asyncOutput->Flush();
+						}
+						telemetryLog.flush();
+
+						OpenMps::CheckpointWriter writer(checkpointFilename, DIM);
+						computer.SaveCheckpoint(writer);
+						writer.WriteValue("outputCount", outputCount);
+						writer.WriteValue("nextOutputT", nextOutputT);
+						writer.WriteValue("iteration", iteration);
+						writer.Commit();
+
+						if(isStopRequested)
+						{
+							isStopped = true;
+							break;
+						}
+					}
+				}
 
-	// 開始時間を保存
-	Timer timer;
-	timer.Start();
-	boost::format timeFormat("#%3$05d: t=%1$8.4lf (%2$05d), %10$12d particles, @ %4$02d/%5$02d %6$02d:%7$02d:%8$02d (%9$8.2lf)");
+				// 終了を要求されたら、チェックポイントを書き出したところで止める
+				if(isStopped)
+				{
+					std::cout << boost::format("Stopped with checkpoint %1%: t=%2% (%3%)") % checkpointFilename % (tComputer + condition.StartTime) % iteration << std::endl;
+					break;
+				}
 
-	const auto outputIterationOffset = static_cast<std::size_t>(std::ceil(condition.StartTime / condition.OutputInterval));
-	{
+				tComputer += condition.StartTime;
+
+				// 結果を出力
+				const auto count = Output(outputCount + outputIterationOffset, tComputer);
+
+				// この出力間隔で近傍粒子探索をした回数
+				const auto searchCountNew = computer.SearchCount();
+				const auto searches = searchCountNew - searchCount;
+				searchCount = searchCountNew;
+
+	#ifndef PRESSURE_EXPLICIT
+				// この出力間隔での1時間刻みあたりの圧力方程式の反復回数
+				const auto steps = iteration - iterationBegin;
+				const auto ppeIterations = (steps == 0) ? 0.0 : static_cast<double>(ppeIterationCount) / steps;
+	#endif
+
+				// 現在時刻を画面表示
+				const auto t = std::time(nullptr);
+				const auto tm = std::localtime(&t);
+				std::cout << timeFormat % tComputer % iteration % (outputCount + outputIterationOffset)
+					% (tm->tm_mon+1) % tm->tm_mday % tm->tm_hour % tm->tm_min % tm->tm_sec
+					% timer.Time() % count % searches % maxStepTime
+	#ifndef PRESSURE_EXPLICIT
+					% ppeIterations % maxPpeIterationCount % assemblyTime % solveTime
+	#endif
+					<< std::endl;
+
+				// 次の出力時間まで
+				nextOutputT += condition.OutputInterval;
+			}
+			// 計算で例外があったら
+			catch(typename decltype(computer)::Exception ex)
+			{
+				// エラーメッセージを出して止める
+				std::cout << "!!!!ERROR!!!!" << std::endl
+					<< boost::format("#%3%: t=%1% (%2%)") % tComputer % iteration % (outputCount + outputIterationOffset) << std::endl
+					<< ex.Message << std::endl;
+				break;
+			}
+		}
 
-		// 初期状態を出力
-		const auto count = OutputToCsv(computer, outputIterationOffset);
-
-		// 開始時間を画面表示
-		const auto tComputer = condition.StartTime;
-		const auto t = std::time(nullptr);
-		const auto tm = std::localtime(&t);
-		std::cout << timeFormat % tComputer % 0 % outputIterationOffset
-			% (tm->tm_mon + 1) % tm->tm_mday % tm->tm_hour % tm->tm_min % tm->tm_sec
-			% timer.Time() % count
-			<< std::endl;
+		// 残っている出力を書き終えるまで待つ
+		if(asyncOutput)
+		{
+			asyncOutput->Flush();
+		}
 	}
 
-	// 計算が終了するまで
-	double nextOutputT = 0;
-	std::size_t iteration = 0;
-	const auto endCount = static_cast<std::size_t>(std::ceil((condition.EndTime - condition.StartTime) / condition.OutputInterval));
-	for(auto outputCount = decltype(endCount){1}; outputCount <= endCount; outputCount++)
+	// 入力を読み込んで計算する
+	// @tparam DIM 次元
+	// @param xml 入力データ（読み込み後に廃棄する）
+	// @param scheme 計算手法の組み合わせ
+	template<std::size_t DIM>
+	inline void LoadAndRun(std::unique_ptr<boost::property_tree::ptree>&& xml, const OpenMps::SchemeSelection& scheme)
 	{
-		double tComputer = computer.GetEnvironment().T();
-		try
+		auto&& condition = LoadCondition(*xml);
+		auto&& environment = LoadEnvironment<DIM>(*xml, condition.OutputInterval, scheme);
+		auto&& particles = LoadParticles<DIM>(*xml);
+
+		xml.reset(); // 読み込んだテキストデータを強制的に廃棄
+
+		// 選ばれた計算手法の組み合わせで計算する
+		OpenMps::DispatchScheme(scheme, [&condition, &environment, &particles](const auto selected)
 		{
-			// 次の出力時間まで
-			nextOutputT += condition.OutputInterval;
-			while(tComputer < nextOutputT)
-			{
-				// 時間を進める
-				computer.ForwardTime();
-				tComputer = computer.GetEnvironment().T();
-				iteration++;
-			}
+			Run(selected, condition, environment, std::move(particles));
+		});
+	}
+}
+
+// エントリポイント
+int main(const int argc, const char* const argv[])
+{
+	System("mkdir result");
 
-			// CSVに結果を出力
-			const auto count = OutputToCsv(computer, outputCount + outputIterationOffset);
+	const auto filename = (argc == 1) ? "../../Benchmark/DamBreak/Sample.xml" : argv[1];
+	std::cout << "Input XML file: " << filename << std::endl;
 
-			tComputer += condition.StartTime;
+	// ジョブの打ち切りなどで終了を要求されたら、チェックポイントを書き出して止める
+	std::signal(SIGTERM, RequestStop);
 
-			// 現在時刻を画面表示
-			const auto t = std::time(nullptr);
-			const auto tm = std::localtime(&t);
-			std::cout << timeFormat % tComputer % iteration % (outputCount + outputIterationOffset)
-				% (tm->tm_mon+1) % tm->tm_mday % tm->tm_hour % tm->tm_min % tm->tm_sec
-				% timer.Time() % count
-				<< std::endl;
-		}
-		// 計算で例外があったら
-		catch(decltype(computer)::Exception ex)
+	try
+	{
+		auto xml = std::make_unique<boost::property_tree::ptree>();
+		boost::property_tree::read_xml(filename, *xml);
+
+		const auto scheme = LoadScheme(*xml);
+
+		// 選ばれた次元で計算する
+		// ※古い入力にはないので、無ければdefines.hppで指定した既定値を使う
+		const auto dimension = xml->get<std::size_t>("openmps.environment.dimension.<xmlattr>.value", OpenMps::DIM);
+		switch(dimension)
 		{
-			// エラーメッセージを出して止める
-			std::cout << "!!!!ERROR!!!!" << std::endl
-				<< boost::format("#%3%: t=%1% (%2%)") % tComputer % iteration % (outputCount + outputIterationOffset) << std::endl
-				<< ex.Message << std::endl;
+		case 2:
+			LoadAndRun<2>(std::move(xml), scheme);
 			break;
+		case 3:
+			LoadAndRun<3>(std::move(xml), scheme);
+			break;
+		default:
+			throw std::runtime_error("Unsupported dimension: " + std::to_string(dimension));
 		}
 	}
+	catch(const std::exception& ex)
+	{
+		// 入力の誤りなどは、メッセージを出して止める
+		std::cout << "!!!!ERROR!!!!" << std::endl
+			<< ex.what() << std::endl;
+		return 1;
+	}
 
 	// 終了
 	std::cout << "finished" << std::endl;
@@ -0,0 +1,275 @@
+﻿#ifndef MIXED_PRECISION_INCLUDED
+#define MIXED_PRECISION_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#pragma warning(pop)
+
+namespace { namespace OpenMps
+{
+	// 単精度で圧力方程式を解く時用
+	// ※疎行列とベクトルの積はメモリ帯域で律速されるので、値と列番号を半分の大きさにして転送量を減らす
+	namespace Detail { namespace MixedPrecision
+	{
+		using Vector = std::vector<float>;
+
+		// 単精度の圧縮行格納形式（CSR）の疎行列
+		class Csr final
+		{
+		public:
+			// 各行の先頭位置
+			std::vector<std::uint32_t> start;
+
+			// 各非零成分の列番号
+			std::vector<std::uint32_t> column;
+
+			// 各非零成分の値
+			std::vector<float> value;
+
+			// 行数
+			std::size_t Size() const
+			{
+				return start.empty() ? 0 : (start.size() - 1);
+			}
+
+			// 倍精度のCSR形式の配列から作成する
+			// @param n 行数
+			// @param sourceStart 各行の先頭位置
+			// @param sourceColumn 各非零成分の列番号
+			// @param sourceValue 各非零成分の値
+			template<typename START, typename COLUMN, typename VALUE>
+			void Assign(const std::size_t n, const START& sourceStart, const COLUMN& sourceColumn, const VALUE& sourceValue)
+			{
+				start.resize(n + 1);
+				start[0] = 0;
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					start[i + 1] = static_cast<std::uint32_t>(sourceStart[i + 1]);
+				}
+
+				const std::size_t nnz = start[n];
+				column.resize(nnz);
+				value.resize(nnz);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto kk = std::make_signed_t<decltype(nnz)>{0}; kk < static_cast<std::make_signed_t<decltype(nnz)>>(nnz); kk++)
+				{
+					const auto k = static_cast<decltype(nnz)>(kk);
+#else
+				for (auto k = decltype(nnz){0}; k < nnz; k++)
+				{
+#endif
+					column[k] = static_cast<std::uint32_t>(sourceColumn[k]);
+					value[k] = static_cast<float>(sourceValue[k]);
+				}
+			}
+
+			// 対角成分の逆数を計算する（対角成分が0なら1にする）
+			// @param invDiagonal 対角成分の逆数
+			void InverseDiagonal(Vector& invDiagonal) const
+			{
+				const auto n = Size();
+				invDiagonal.resize(n);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					auto a_ii = 0.0f;
+					for(auto k = start[i]; k < start[i + 1]; k++)
+					{
+						if(column[k] == i)
+						{
+							a_ii = value[k];
+						}
+					}
+					invDiagonal[i] = 1.0f / ((a_ii != 0) ? a_ii : 1.0f);
+				}
+			}
+		};
+
+		// 疎行列とベクトルの積：y = A x
+		// @param A 行列
+		// @param x ベクトル
+		// @param y 結果
+		inline void Multiply(const Csr& A, const Vector& x, Vector& y)
+		{
+			const auto n = A.Size();
+			y.resize(n);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				auto y_i = 0.0f;
+				for(auto k = A.start[i]; k < A.start[i + 1]; k++)
+				{
+					y_i += A.value[k] * x[A.column[k]];
+				}
+				y[i] = y_i;
+			}
+		}
+
+		// 内積（桁落ちを避けるため倍精度で足し合わせる）
+		// @param a ベクトル
+		// @param b ベクトル
+		inline double InnerProduct(const Vector& a, const Vector& b)
+		{
+			const auto n = a.size();
+			auto sum = 0.0;
+#ifdef _OPENMP
+			#pragma omp parallel for reduction(+:sum)
+#endif
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				sum += static_cast<double>(a[i]) * b[i];
+			}
+			return sum;
+		}
+
+		// 単精度に変換する
+		// @param source 倍精度のベクトル
+		// @param v 単精度のベクトル
+		template<typename VECTOR>
+		inline void ToSingle(const VECTOR& source, Vector& v)
+		{
+			const auto n = source.size();
+			v.resize(n);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				v[i] = static_cast<float>(source(i));
+			}
+		}
+
+		// 倍精度に変換する
+		// @param v 単精度のベクトル
+		// @param result 倍精度のベクトル
+		template<typename VECTOR>
+		inline void ToDouble(const Vector& v, VECTOR& result)
+		{
+			const auto n = v.size();
+			result.resize(n, false);
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				result(i) = v[i];
+			}
+		}
+
+		// 単精度の前処理付き共役勾配法で解く：A x = b
+		// ※初期値は0とし、反復改良の内側で使うので収束しなくても例外にはしない
+		// @param A 係数行列
+		// @param precondition 前処理（z = M^-1 rを計算する関数）
+		// @param b 右辺
+		// @param x 解
+		// @param r 残差ベクトル
+		// @param p 探索方向ベクトル
+		// @param Ap 係数行列と探索方向ベクトルの積
+		// @param z 前処理後の残差ベクトル
+		// @param tolerance 右辺に対する残差の相対値の収束判定値
+		// @param maxIteration 最大反復回数
+		// @return 反復回数
+		template<typename PRECONDITION>
+		inline std::size_t Solve(const Csr& A, PRECONDITION precondition, const Vector& b,
+			Vector& x, Vector& r, Vector& p, Vector& Ap, Vector& z,
+			const double tolerance, const std::size_t maxIteration)
+		{
+			const auto n = b.size();
+			x.assign(n, 0.0f);
+			r = b;
+			z.resize(n);
+			Ap.resize(n);
+			precondition(r, z);
+			p = z;
+			auto rz = InnerProduct(r, z);
+			const auto residual0 = InnerProduct(r, r) * tolerance * tolerance;
+
+			bool isConverged = (residual0 == 0);
+			auto iteration = decltype(maxIteration){0};
+			for (; (iteration < maxIteration) && (!isConverged); iteration++)
+			{
+				//  Ap = A * p
+				//  α = rz/(p・Ap)
+				//  x' += αp
+				//  r' -= αAp
+				Multiply(A, p, Ap);
+				const auto alpha = static_cast<float>(rz / InnerProduct(p, Ap));
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					x[i] += alpha * p[i];
+					r[i] -= alpha * Ap[i];
+				}
+
+				// 収束判定
+				isConverged = (InnerProduct(r, r) < residual0);
+				if (!isConverged)
+				{
+					//  z' = M^-1 r'
+					//  β= r'z'/rz
+					//  p = z' + βp
+					precondition(r, z);
+					const auto rzNew = InnerProduct(r, z);
+					const auto beta = static_cast<float>(rzNew / rz);
+					OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+					for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+					{
+						const auto i = static_cast<decltype(n)>(ii);
+#else
+					for (auto i = decltype(n){0}; i < n; i++)
+					{
+#endif
+						p[i] = z[i] + beta * p[i];
+					}
+					rz = rzNew;
+				}
+			}
+			return iteration;
+		}
+	}}
+}}
+#endif
@@ -11,9 +11,13 @@
 namespace { namespace OpenMps
 {
 	// 粒子
+	// @tparam DIM 次元
+	template<std::size_t DIM = OpenMps::DIM>
 	class Particle final
 	{
 	public:
+		using Vector = OpenMps::Vector<DIM>;
+
 		// 粒子の種類
 		enum class Type
 		{
@@ -48,8 +52,8 @@ namespace { namespace OpenMps
 
 	public:
 		Particle(const Type t)
-			: x(VectorZero),
-			u(VectorZero),
+			: x(VectorZero<DIM>),
+			u(VectorZero<DIM>),
 			p(0),
 			n(0),
 			type(t)
@@ -0,0 +1,236 @@
+﻿#ifndef PARTICLEARRAY_INCLUDED
+#define PARTICLEARRAY_INCLUDED
+
+#pragma warning(push, 0)
+#include <vector>
+#include <iterator>
+#include <type_traits>
+#include <boost/align/aligned_allocator.hpp>
+#pragma warning(pop)
+
+#include "defines.hpp"
+#include "Vector.hpp"
+#include "Particle.hpp"
+
+namespace { namespace OpenMps
+{
+	namespace Detail
+	{
+		// 配列を並べ替える
+		// @param data 対象の配列
+		// @param order 並べ替え後の各位置に入る元の位置
+		template<typename ARRAY>
+		inline void Permute(ARRAY& data, const std::vector<std::size_t>& order)
+		{
+			ARRAY sorted;
+			sorted.reserve(data.size());
+			for (const auto i : order)
+			{
+				sorted.push_back(std::move(data[i]));
+			}
+			data.swap(sorted);
+		}
+	}
+
+	// 粒子の集合
+	// 物理量毎に別々の連続した配列で保持し、計算では必要な物理量の配列だけを参照する
+	// @tparam DIM 次元
+	template<std::size_t DIM = OpenMps::DIM>
+	class ParticleArray final
+	{
+	public:
+		using Vector = OpenMps::Vector<DIM>;
+		using Particle = OpenMps::Particle<DIM>;
+
+		// 配列の先頭の境界（キャッシュラインの長さ）
+		static constexpr std::size_t ALIGNMENT = 64;
+
+		// 物理量1つ分の配列
+		template<typename T>
+		using Array = std::vector<T, boost::alignment::aligned_allocator<T, ALIGNMENT>>;
+
+	private:
+		// 位置ベクトル
+		Array<Vector> x;
+
+		// 速度ベクトル
+		Array<Vector> u;
+
+		// 圧力
+		Array<double> p;
+
+		// 粒子数密度
+		Array<double> n;
+
+		// 粒子の種類
+		Array<typename Particle::Type> type;
+
+	public:
+		// 1粒子分の参照
+		// ※Particleと同じように各物理量を取得できる
+		template<bool IS_CONST>
+		class Reference final
+		{
+		private:
+			using Owner = std::conditional_t<IS_CONST, const ParticleArray, ParticleArray>;
+
+			Owner* particles;
+			std::size_t i;
+
+		public:
+			Reference(Owner& owner, const std::size_t index)
+				: particles(&owner), i(index)
+			{}
+
+			// 粒子を無効化する
+			void Disable() const
+			{
+				particles->type[i] = Particle::Type::Disabled;
+			}
+
+			// 位置ベクトル
+			auto& X() const
+			{
+				return particles->x[i];
+			}
+
+			// 速度ベクトル
+			auto& U() const
+			{
+				return particles->u[i];
+			}
+
+			// 圧力
+			auto& P() const
+			{
+				return particles->p[i];
+			}
+
+			// 粒子数密度
+			auto& N() const
+			{
+				return particles->n[i];
+			}
+
+			// 種類
+			const auto& TYPE() const
+			{
+				return particles->type[i];
+			}
+
+			// 粒子として複製する
+			operator Particle() const
+			{
+				Particle particle(TYPE());
+				particle.X() = X();
+				particle.U() = U();
+				particle.P() = P();
+				particle.N() = N();
+				return particle;
+			}
+		};
+
+		// 全粒子を先頭から順に参照するイテレーター
+		template<bool IS_CONST>
+		class Iterator final : public std::iterator<std::input_iterator_tag, Reference<IS_CONST>>
+		{
+		private:
+			using Owner = std::conditional_t<IS_CONST, const ParticleArray, ParticleArray>;
+
+			Owner* particles;
+			std::size_t i;
+
+		public:
+			Iterator(Owner& owner, const std::size_t index)
+				: particles(&owner), i(index)
+			{}
+
+			Reference<IS_CONST> operator*() const
+			{
+				return Reference<IS_CONST>(*particles, i);
+			}
+
+			Iterator& operator++()
+			{
+				i++;
+				return *this;
+			}
+
+			bool operator==(const Iterator& it) const
+			{
+				return (particles == it.particles) && (i == it.i);
+			}
+
+			bool operator!=(const Iterator& it) const
+			{
+				return !(*this == it);
+			}
+		};
+
+		// 粒子数
+		auto size() const
+		{
+			return type.size();
+		}
+
+		// 粒子数分の領域を確保する
+		// @param capacity 確保する粒子数
+		void reserve(const std::size_t capacity)
+		{
+			x.reserve(capacity);
+			u.reserve(capacity);
+			p.reserve(capacity);
+			n.reserve(capacity);
+			type.reserve(capacity);
+		}
+
+		// 粒子を末尾に追加する
+		// @param particle 追加する粒子
+		void push_back(const Particle& particle)
+		{
+			x.push_back(particle.X());
+			u.push_back(particle.U());
+			p.push_back(particle.P());
+			n.push_back(particle.N());
+			type.push_back(particle.TYPE());
+		}
+
+		// 粒子を並べ替える
+		// @param order 並べ替え後の各位置に入る元の位置
+		void Permute(const std::vector<std::size_t>& order)
+		{
+			Detail::Permute(x, order);
+			Detail::Permute(u, order);
+			Detail::Permute(p, order);
+			Detail::Permute(n, order);
+			Detail::Permute(type, order);
+		}
+
+		auto operator[](const std::size_t i)
+		{
+			return Reference<false>(*this, i);
+		}
+		auto operator[](const std::size_t i) const
+		{
+			return Reference<true>(*this, i);
+		}
+
+		auto begin()
+		{
+			return Iterator<false>(*this, 0);
+		}
+		auto end()
+		{
+			return Iterator<false>(*this, size());
+		}
+		auto begin() const
+		{
+			return Iterator<true>(*this, 0);
+		}
+		auto end() const
+		{
+			return Iterator<true>(*this, size());
+		}
+	};
+}}
+#endif
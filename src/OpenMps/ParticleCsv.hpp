@@ -0,0 +1,321 @@
+﻿#ifndef PARTICLE_CSV_INCLUDED
+#define PARTICLE_CSV_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#pragma warning(pop)
+
+#include "Particle.hpp"
+#include "PrefixSum.hpp"
+#include "Snapshot.hpp"
+
+namespace { namespace OpenMps
+{
+	// 粒子のCSV（1粒子1行、先頭行に列名）の読み込み
+	// ※行や項目毎に文字列を作らず、読み込んだ文字列から直接数値を読む
+	// ※行の途中で区切った範囲毎に並列に読み込む
+	namespace Detail { namespace Csv
+	{
+		// 並列に読み込む1範囲の大きさ[byte]
+		static constexpr std::size_t CHUNK_SIZE = 1 << 20;
+
+		// 項目の前後の空白かどうか（改行がCR+LFの時のCRも含める）
+		inline bool IsBlank(const char c)
+		{
+			return (c == ' ') || (c == '\t') || (c == '\r');
+		}
+
+		// 空白を飛ばす
+		// @param p 先頭
+		// @param end 末尾
+		inline const char* SkipBlank(const char* p, const char* const end)
+		{
+			while((p < end) && IsBlank(*p))
+			{
+				++p;
+			}
+			return p;
+		}
+
+		// 行末（改行文字の位置、無ければ末尾）を探す
+		// @param p 先頭
+		// @param end 末尾
+		inline const char* LineEnd(const char* const p, const char* const end)
+		{
+			const auto lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+			return (lineEnd == nullptr) ? end : lineEnd;
+		}
+
+		// 次の行の先頭
+		// @param lineEnd 行末
+		// @param end 末尾
+		inline const char* NextLine(const char* const lineEnd, const char* const end)
+		{
+			return (lineEnd == end) ? end : (lineEnd + 1);
+		}
+
+		// 空行かどうか
+		// @param p 行の先頭
+		// @param lineEnd 行末
+		inline bool IsEmptyLine(const char* const p, const char* const lineEnd)
+		{
+			return SkipBlank(p, lineEnd) == lineEnd;
+		}
+
+		// 列名の並び（種類、位置、速度、圧力、粒子数密度の順）
+		// @tparam DIM 次元
+		template<std::size_t DIM>
+		inline auto FieldNames()
+		{
+			std::array<std::string, 3 + 2 * DIM> names;
+			names[0] = "Type";
+			for(auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				names[1 + d] = AxisName<DIM>::X()[d];
+				names[1 + DIM + d] = AxisName<DIM>::U()[d];
+			}
+			names[1 + 2 * DIM] = "p";
+			names[2 + 2 * DIM] = "n";
+			return names;
+		}
+
+		// 1行を読み込む
+		// @param p 行の先頭
+		// @param lineEnd 行末
+		// @param fieldOfColumn 各列の値の番号（列名の並びでの番号）
+		// @param values 各値の読み込み先（種類は整数として読む）
+		template<std::size_t FIELD_COUNT>
+		inline void ParseLine(const char* p, const char* const lineEnd, const std::vector<std::size_t>& fieldOfColumn, std::array<double, FIELD_COUNT>& values)
+		{
+			const auto columnCount = fieldOfColumn.size();
+			for(auto c = decltype(columnCount){0}; c < columnCount; c++)
+			{
+				p = SkipBlank(p, lineEnd);
+				if((p == lineEnd) || (*p == ','))
+				{
+					throw std::runtime_error("Missing value in input csv");
+				}
+
+				// 項目の前の空白は飛ばしてあるので、改行を越えて読むことはない
+				char* next;
+				const auto field = fieldOfColumn[c];
+				values[field] = (field == 0) ?
+					static_cast<double>(std::strtol(p, &next, 10)) :
+					std::strtod(p, &next);
+				if(next == p)
+				{
+					throw std::runtime_error("Illegal value in input csv");
+				}
+
+				// 次の項目へ（余分な列は読まない）
+				p = SkipBlank(next, lineEnd);
+				if(c + 1 < columnCount)
+				{
+					if((p == lineEnd) || (*p != ','))
+					{
+						throw std::runtime_error("Illegal value in input csv");
+					}
+					++p;
+				}
+				else if((p != lineEnd) && (*p != ','))
+				{
+					throw std::runtime_error("Illegal value in input csv");
+				}
+			}
+		}
+	}}
+
+	// CSVの文字列から粒子を読み込む
+	// @tparam DIM 次元
+	// @param csv CSVの文字列
+	template<std::size_t DIM>
+	inline std::vector<Particle<DIM>> ParseParticleCsv(const std::string& csv)
+	{
+		namespace Csv = Detail::Csv;
+		using Particle = OpenMps::Particle<DIM>;
+		constexpr auto FIELD_COUNT = 3 + 2 * DIM;
+
+		// ※strtodとstrtolが末尾を越えないように、std::stringの終端文字を番兵にする
+		const char* const begin = csv.c_str();
+		const char* const end = begin + csv.size();
+
+		// 先頭の空行は飛ばす
+		auto p = begin;
+		while((p < end) && Csv::IsEmptyLine(p, Csv::LineEnd(p, end)))
+		{
+			p = Csv::NextLine(Csv::LineEnd(p, end), end);
+		}
+		if(p == end)
+		{
+			throw std::runtime_error("Input csv has no header");
+		}
+
+		// ヘッダーから各列の値の番号を決める
+		std::vector<std::size_t> fieldOfColumn;
+		{
+			const auto names = Csv::FieldNames<DIM>();
+			std::array<bool, FIELD_COUNT> isFound;
+			isFound.fill(false);
+
+			const auto lineEnd = Csv::LineEnd(p, end);
+			for(auto isEnd = false; !isEnd; )
+			{
+				const auto comma = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(lineEnd - p)));
+				const auto itemEnd = (comma == nullptr) ? lineEnd : comma;
+				isEnd = (comma == nullptr);
+
+				// 前後の空白を除いた列名
+				auto nameBegin = Csv::SkipBlank(p, itemEnd);
+				auto nameEnd = itemEnd;
+				while((nameEnd > nameBegin) && Csv::IsBlank(*(nameEnd - 1)))
+				{
+					--nameEnd;
+				}
+				const std::string name(nameBegin, nameEnd);
+
+				const auto found = std::find(names.cbegin(), names.cend(), name);
+				if(found == names.cend())
+				{
+					throw std::runtime_error("Illegal header item in input csv");
+				}
+				const auto field = static_cast<std::size_t>(found - names.cbegin());
+				fieldOfColumn.push_back(field);
+				isFound[field] = true;
+
+				p = itemEnd + 1;
+			}
+			if(std::find(isFound.cbegin(), isFound.cend(), false) != isFound.cend())
+			{
+				throw std::runtime_error("Some header item doesn't exist");
+			}
+			p = Csv::NextLine(lineEnd, end);
+		}
+
+		// 本体を、行の先頭から始まる範囲に区切る
+		std::vector<const char*> chunkBegin;
+		for(auto chunk = p; chunk < end; )
+		{
+			chunkBegin.push_back(chunk);
+			const auto next = chunk + std::min(Csv::CHUNK_SIZE, static_cast<std::size_t>(end - chunk));
+			chunk = (next == end) ? end : Csv::NextLine(Csv::LineEnd(next - 1, end), end);
+		}
+		const auto chunkCount = chunkBegin.size();
+		chunkBegin.push_back(end);
+
+		// 各範囲の粒子数（空行を除いた行数）を数えて、各範囲の粒子の先頭番号を決める
+		std::vector<std::size_t> chunkStart(chunkCount + 1, 0);
+		OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+		for (auto kk = std::make_signed_t<decltype(chunkCount)>{0}; kk < static_cast<std::make_signed_t<decltype(chunkCount)>>(chunkCount); kk++)
+		{
+			const auto k = static_cast<decltype(chunkCount)>(kk);
+#else
+		for (auto k = decltype(chunkCount){0}; k < chunkCount; k++)
+		{
+#endif
+			auto count = std::size_t{0};
+			for(auto line = chunkBegin[k]; line < chunkBegin[k + 1]; )
+			{
+				const auto lineEnd = Csv::LineEnd(line, chunkBegin[k + 1]);
+				if(!Csv::IsEmptyLine(line, lineEnd))
+				{
+					count++;
+				}
+				line = Csv::NextLine(lineEnd, chunkBegin[k + 1]);
+			}
+			chunkStart[k + 1] = count;
+		}
+		Detail::PrefixSum(chunkStart);
+
+		// 各範囲を並列に読み込む
+		// ※並列領域からは例外を投げられないので、範囲毎に覚えておいて後で投げる
+		std::vector<Particle> particles(chunkStart[chunkCount], Particle(Particle::Type::Disabled));
+		std::vector<std::string> error(chunkCount);
+		OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+		for (auto kk = std::make_signed_t<decltype(chunkCount)>{0}; kk < static_cast<std::make_signed_t<decltype(chunkCount)>>(chunkCount); kk++)
+		{
+			const auto k = static_cast<decltype(chunkCount)>(kk);
+#else
+		for (auto k = decltype(chunkCount){0}; k < chunkCount; k++)
+		{
+#endif
+			try
+			{
+				std::array<double, FIELD_COUNT> values;
+				auto i = chunkStart[k];
+				for(auto line = chunkBegin[k]; line < chunkBegin[k + 1]; )
+				{
+					const auto lineEnd = Csv::LineEnd(line, chunkBegin[k + 1]);
+					if(!Csv::IsEmptyLine(line, lineEnd))
+					{
+						Csv::ParseLine(line, lineEnd, fieldOfColumn, values);
+
+						auto& particle = particles[i];
+						particle = Particle(static_cast<typename Particle::Type>(static_cast<std::underlying_type_t<typename Particle::Type>>(values[0])));
+						for(auto d = decltype(DIM){0}; d < DIM; d++)
+						{
+							particle.X()[d] = values[1 + d];
+							particle.U()[d] = values[1 + DIM + d];
+						}
+						particle.P() = values[1 + 2 * DIM];
+						particle.N() = values[2 + 2 * DIM];
+						i++;
+					}
+					line = Csv::NextLine(lineEnd, chunkBegin[k + 1]);
+				}
+			}
+			catch(const std::exception& e)
+			{
+				error[k] = e.what();
+			}
+		}
+		for(const auto& message : error)
+		{
+			if(!message.empty())
+			{
+				throw std::runtime_error(message);
+			}
+		}
+
+		return particles;
+	}
+
+	// CSVファイルから粒子を読み込む
+	// ※ファイル全体を1度に読み込んでから、並列に読み込む
+	// @tparam DIM 次元
+	// @param filename CSVファイル
+	template<std::size_t DIM>
+	inline std::vector<Particle<DIM>> ReadParticleCsv(const std::string& filename)
+	{
+		std::ifstream input(filename, std::ios::binary);
+		if(!input)
+		{
+			throw std::runtime_error("Cannot open particle csv file: " + filename);
+		}
+		input.seekg(0, std::ios::end);
+		const auto size = static_cast<std::size_t>(input.tellg());
+		input.seekg(0, std::ios::beg);
+
+		std::string csv(size, '\0');
+		input.read(&csv[0], static_cast<std::streamsize>(size));
+		if(!input)
+		{
+			throw std::runtime_error("Cannot read particle csv file: " + filename);
+		}
+		return ParseParticleCsv<DIM>(csv);
+	}
+}}
+#endif
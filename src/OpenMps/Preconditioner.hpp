@@ -0,0 +1,411 @@
+﻿#ifndef PRECONDITIONER_INCLUDED
+#define PRECONDITIONER_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <vector>
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#endif
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+#pragma warning(pop)
+
+#include "PrefixSum.hpp"
+
+namespace { namespace OpenMps
+{
+	// 圧力方程式を共役勾配法で解く時の前処理
+	enum class Preconditioner
+	{
+		// 前処理なし
+		None,
+
+		// 対角スケーリング（Jacobi法）
+		Jacobi,
+
+		// 不完全コレスキー分解（フィルインなし、IC(0)）
+		IncompleteCholesky,
+
+		// 対称SOR法（緩和係数1、対称ガウス・ザイデル法）
+		Ssor,
+
+		// 代数的マルチグリッド法（平滑化集約型、V-サイクル1回）
+		Amg,
+	};
+
+	namespace Detail { namespace Preconditioning
+	{
+		using LongVector = boost::numeric::ublas::vector<double>;
+
+		// 圧縮行格納形式（CSR）の疎行列
+		// ※各行の列番号は昇順
+		class Csr final
+		{
+		public:
+			// 各行の先頭位置
+			std::vector<std::size_t> start;
+
+			// 各非零成分の列番号
+			std::vector<std::size_t> column;
+
+			// 各非零成分の値
+			std::vector<double> value;
+
+			// 各行の対角成分の位置（下三角部分の終端）
+			std::vector<std::size_t> diagonal;
+
+			// 行数
+			std::size_t Size() const
+			{
+				return start.empty() ? 0 : (start.size() - 1);
+			}
+
+			// ublasの疎行列から作成する
+			// @param A 元の行列
+			template<typename MATRIX>
+			void Assign(const MATRIX& A)
+			{
+				const auto n = A.size1();
+				start.assign(n + 1, 0);
+				column.clear();
+				value.clear();
+
+				// 行順に非零成分を詰める
+				// ※先頭位置は、各行の個数をひとつ後ろに数えて累積和で求める
+				for(auto it1 = A.begin1(); it1 != A.end1(); ++it1)
+				{
+					for(auto it2 = it1.begin(); it2 != it1.end(); ++it2)
+					{
+						start[it2.index1() + 1]++;
+						column.push_back(it2.index2());
+						value.push_back(*it2);
+					}
+				}
+				PrefixSum(start);
+
+				FindDiagonal();
+			}
+
+			// CSR形式の配列から作成する
+			// ※要素毎に独立なので並列に複製する
+			// @param n 行数
+			// @param sourceStart 各行の先頭位置
+			// @param sourceColumn 各非零成分の列番号（各行で昇順）
+			// @param sourceValue 各非零成分の値
+			template<typename START, typename COLUMN, typename VALUE>
+			void Assign(const std::size_t n, const START& sourceStart, const COLUMN& sourceColumn, const VALUE& sourceValue)
+			{
+				start.resize(n + 1);
+				start[0] = 0;
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					start[i + 1] = sourceStart[i + 1];
+				}
+
+				const auto nnz = start[n];
+				column.resize(nnz);
+				value.resize(nnz);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto kk = std::make_signed_t<decltype(nnz)>{0}; kk < static_cast<std::make_signed_t<decltype(nnz)>>(nnz); kk++)
+				{
+					const auto k = static_cast<decltype(nnz)>(kk);
+#else
+				for (auto k = decltype(nnz){0}; k < nnz; k++)
+				{
+#endif
+					column[k] = sourceColumn[k];
+					value[k] = sourceValue[k];
+				}
+
+				FindDiagonal();
+			}
+
+			// 対角成分を探す（無い行は下三角部分の終端を入れておく）
+			void FindDiagonal()
+			{
+				const auto n = Size();
+				diagonal.resize(n);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					auto k = start[i];
+					while((k < start[i + 1]) && (column[k] < i))
+					{
+						k++;
+					}
+					diagonal[i] = k;
+				}
+			}
+
+			// 対角成分の値
+			// @param i 行番号
+			double Diagonal(const std::size_t i) const
+			{
+				const auto k = diagonal[i];
+				return ((k < start[i + 1]) && (column[k] == i)) ? value[k] : 0.0;
+			}
+		};
+
+		// 対角成分の値（0なら前処理しないように1にする）
+		// @param a_ii 対角成分
+		inline double SafeDiagonal(const double a_ii)
+		{
+			return (a_ii != 0) ? a_ii : 1.0;
+		}
+
+		// 対角スケーリング：z = D^-1 r
+		class Jacobi final
+		{
+		private:
+			// 対角成分の逆数
+			LongVector invDiagonal;
+
+		public:
+			// 前処理行列を作成する
+			// @param A 係数行列
+			void Compute(const Csr& A)
+			{
+				const auto n = A.Size();
+				invDiagonal.resize(n, false);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					invDiagonal(i) = 1.0 / SafeDiagonal(A.Diagonal(i));
+				}
+			}
+
+			// 対角成分から前処理行列を作成する（係数行列を作らない時用）
+			// @param diagonal 対角成分
+			void Compute(const std::vector<double>& diagonal)
+			{
+				const auto n = diagonal.size();
+				invDiagonal.resize(n, false);
+				OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+				for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+				{
+					const auto i = static_cast<decltype(n)>(ii);
+#else
+				for (auto i = decltype(n){0}; i < n; i++)
+				{
+#endif
+					invDiagonal(i) = 1.0 / SafeDiagonal(diagonal[i]);
+				}
+			}
+
+			// 前処理を適用する
+			// @param r 残差
+			// @param z 前処理後の残差
+			void Apply(const Csr&, const LongVector& r, LongVector& z) const
+			{
+				z = boost::numeric::ublas::element_prod(invDiagonal, r);
+			}
+		};
+
+		// 不完全コレスキー分解：A ≒ (I+L) D (I+L)^T
+		// ※MPS法の係数行列は対角成分が負なので、平方根を使わない修正版（LDL^T分解）にしている
+		class IncompleteCholesky final
+		{
+		private:
+			// 狭義下三角部分の値（係数行列と同じ位置に格納し、上三角部分は使わない）
+			std::vector<double> lower;
+
+			// 対角成分
+			std::vector<double> d;
+
+		public:
+			// 前処理行列を作成する
+			// @param A 係数行列（対称）
+			void Compute(const Csr& A)
+			{
+				const auto& start = A.start;
+				const auto& column = A.column;
+				const auto& value = A.value;
+				const auto& diagonal = A.diagonal;
+
+				const auto n = A.Size();
+				lower.assign(value.size(), 0.0);
+				d.resize(n);
+
+				// 上の行から順に
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					auto d_i = A.Diagonal(i);
+
+					// 下三角部分の非零成分だけを計算する
+					for(auto k = start[i]; k < diagonal[i]; k++)
+					{
+						const auto j = column[k];
+
+						// l_ij = (a_ij - Σ_m l_im d_m l_jm) / d_j
+						// ※行iと行jで共通する列mについてだけ足す（どちらも列番号は昇順）
+						auto l_ij = value[k];
+						auto ki = start[i];
+						auto kj = start[j];
+						while((ki < k) && (kj < diagonal[j]))
+						{
+							const auto mi = column[ki];
+							const auto mj = column[kj];
+							if(mi == mj)
+							{
+								l_ij -= lower[ki] * d[mi] * lower[kj];
+								ki++;
+								kj++;
+							}
+							else if(mi < mj)
+							{
+								ki++;
+							}
+							else
+							{
+								kj++;
+							}
+						}
+						l_ij /= d[j];
+						lower[k] = l_ij;
+
+						// d_i = a_ii - Σ_j l_ij^2 d_j
+						d_i -= l_ij * l_ij * d[j];
+					}
+
+					// 分解が破綻した（対角成分の符号が変わった）ら、その行は対角スケーリングにする
+					const auto a_ii = SafeDiagonal(A.Diagonal(i));
+					d[i] = (d_i * a_ii > 0) ? d_i : a_ii;
+				}
+			}
+
+			// 前処理を適用する
+			// @param A 係数行列（作成した時と同じもの）
+			// @param r 残差
+			// @param z 前処理後の残差
+			void Apply(const Csr& A, const LongVector& r, LongVector& z) const
+			{
+				const auto& start = A.start;
+				const auto& column = A.column;
+				const auto& diagonal = A.diagonal;
+				const auto n = A.Size();
+
+				z = r;
+
+				// 前進代入：(I+L) y = r
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					auto z_i = z(i);
+					for(auto k = start[i]; k < diagonal[i]; k++)
+					{
+						z_i -= lower[k] * z(column[k]);
+					}
+					z(i) = z_i;
+				}
+
+				// y = D^-1 y
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					z(i) /= d[i];
+				}
+
+				// 後退代入：(I+L)^T z = y
+				// ※下三角部分を行毎に持っているので、確定した値を上の行へ配っていく
+				for(auto i = n; i > 0; i--)
+				{
+					const auto z_i = z(i - 1);
+					for(auto k = start[i - 1]; k < diagonal[i - 1]; k++)
+					{
+						z(column[k]) -= lower[k] * z_i;
+					}
+				}
+			}
+		};
+
+		// 対称SOR法：M = (D+L) D^-1 (D+U)
+		class Ssor final
+		{
+		private:
+			// 対角成分の逆数
+			std::vector<double> invDiagonal;
+
+		public:
+			// 前処理行列を作成する
+			// @param A 係数行列
+			void Compute(const Csr& A)
+			{
+				const auto n = A.Size();
+				invDiagonal.resize(n);
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					invDiagonal[i] = 1.0 / SafeDiagonal(A.Diagonal(i));
+				}
+			}
+
+			// 前処理を適用する
+			// @param A 係数行列（作成した時と同じもの）
+			// @param r 残差
+			// @param z 前処理後の残差
+			void Apply(const Csr& A, const LongVector& r, LongVector& z) const
+			{
+				const auto& start = A.start;
+				const auto& column = A.column;
+				const auto& value = A.value;
+				const auto& diagonal = A.diagonal;
+				const auto n = A.Size();
+
+				z = r;
+
+				// 前進代入：(D+L) y = r の後に D y
+				// ※上の行から順に確定するので、D y = r - L y をそのまま計算する
+				for(auto i = decltype(n){0}; i < n; i++)
+				{
+					auto z_i = z(i);
+					for(auto k = start[i]; k < diagonal[i]; k++)
+					{
+						const auto j = column[k];
+						z_i -= value[k] * z(j) * invDiagonal[j];
+					}
+					z(i) = z_i;
+				}
+
+				// 後退代入：(D+U) z = D y
+				for(auto i = n; i > 0; i--)
+				{
+					const auto row = i - 1;
+					auto z_i = z(row);
+					for(auto k = diagonal[row]; k < start[row + 1]; k++)
+					{
+						const auto j = column[k];
+						if(j != row)
+						{
+							z_i -= value[k] * z(j);
+						}
+					}
+					z(row) = z_i * invDiagonal[row];
+				}
+			}
+		};
+	}}
+}}
+#endif
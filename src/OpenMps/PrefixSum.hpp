@@ -0,0 +1,65 @@
+﻿#ifndef PREFIXSUM_INCLUDED
+#define PREFIXSUM_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <vector>
+#include <numeric>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#pragma warning(pop)
+
+namespace { namespace OpenMps
+{
+	namespace Detail
+	{
+		// 先頭からの累積和を計算する（各要素がその要素までの総和に置き換わる）
+		// @param data 対象の配列
+		template<typename T>
+		inline void PrefixSum(std::vector<T>& data)
+		{
+#ifdef _OPENMP
+			const auto n = data.size();
+
+			// 各スレッドの担当範囲の総和（先頭は0）
+			std::vector<T> offset(static_cast<std::size_t>(::omp_get_max_threads()) + 1, T{0});
+
+			#pragma omp parallel
+			{
+				const auto threadCount = static_cast<std::size_t>(::omp_get_num_threads());
+				const auto thread = static_cast<std::size_t>(::omp_get_thread_num());
+				const auto begin = n * thread / threadCount;
+				const auto end = n * (thread + 1) / threadCount;
+
+				// 担当範囲内で累積
+				for (auto i = begin; i + 1 < end; i++)
+				{
+					data[i + 1] += data[i];
+				}
+				offset[thread + 1] = (begin < end) ? data[end - 1] : T{0};
+
+				// 各範囲の総和を累積して、その範囲より前の総和にする
+				#pragma omp barrier
+				#pragma omp single
+				{
+					for (auto t = decltype(threadCount){1}; t < threadCount; t++)
+					{
+						offset[t + 1] += offset[t];
+					}
+				}
+
+				// 前の範囲までの総和を足す
+				const auto thisOffset = offset[thread];
+				for (auto i = begin; i < end; i++)
+				{
+					data[i] += thisOffset;
+				}
+			}
+#else
+			std::partial_sum(data.begin(), data.end(), data.begin());
+#endif
+		}
+	}
+}}
+#endif
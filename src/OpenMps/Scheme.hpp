@@ -0,0 +1,190 @@
+﻿#ifndef SCHEME_INCLUDED
+#define SCHEME_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <tuple>
+#include <type_traits>
+#pragma warning(pop)
+
+namespace { namespace OpenMps
+{
+	// 実行時に選ぶ計算手法の組み合わせ
+	struct SchemeSelection
+	{
+		// HS法（高精度生成項）
+		bool Hs;
+
+		// HL法（高精度ラプラシアン）
+		bool Hl;
+
+		// ECS法（誤差修正項）
+		bool Ecs;
+
+		// GC法（勾配修正行列）
+		bool Gc;
+
+		// DS法（動的人工斥力）
+		bool Ds;
+
+		// SPP法（自由表面仮想粒子）
+		bool Spp;
+	};
+
+	// 計算手法の組み合わせ
+	// ※計算部分はこれを型引数に取り、組み合わせ毎にコンパイル時に特殊化される
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	struct Scheme final
+	{
+		static constexpr bool Hs = HS;
+		static constexpr bool Hl = HL;
+#ifdef PRESSURE_EXPLICIT
+		// 陽解法では圧力方程式を解かないので、その生成項を修正するECS法は使わない
+		static constexpr bool Ecs = false;
+#else
+		static constexpr bool Ecs = ECS;
+#endif
+		static constexpr bool Gc = GC;
+		static constexpr bool Ds = DS;
+		static constexpr bool Spp = SPP;
+
+		// 選択された組み合わせと一致するかどうか
+		// @param selection 実行時に選ばれた組み合わせ
+		static bool Matches(const SchemeSelection& selection)
+		{
+			return (selection.Hs == Hs) && (selection.Hl == Hl) && (selection.Ecs == Ecs)
+				&& (selection.Gc == Gc) && (selection.Ds == Ds) && (selection.Spp == Spp);
+		}
+
+		// 実行時の組み合わせとして取得する
+		static SchemeSelection Selection()
+		{
+			return SchemeSelection{Hs, Hl, Ecs, Gc, Ds, Spp};
+		}
+	};
+
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	constexpr bool Scheme<HS, HL, ECS, GC, DS, SPP>::Hs;
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	constexpr bool Scheme<HS, HL, ECS, GC, DS, SPP>::Hl;
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	constexpr bool Scheme<HS, HL, ECS, GC, DS, SPP>::Ecs;
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	constexpr bool Scheme<HS, HL, ECS, GC, DS, SPP>::Gc;
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	constexpr bool Scheme<HS, HL, ECS, GC, DS, SPP>::Ds;
+	template<bool HS, bool HL, bool ECS, bool GC, bool DS, bool SPP>
+	constexpr bool Scheme<HS, HL, ECS, GC, DS, SPP>::Spp;
+
+	// 実行時に決める計算手法の組み合わせ
+	// ※並べた組み合わせ（Schemes）のどれでもない時に使う
+	// ※計算部分は組み合わせによらず1つだけ生成され、各手法を使うかどうかは計算中に判定する
+	struct DynamicScheme final
+	{
+		bool Hs;
+		bool Hl;
+		bool Ecs;
+		bool Gc;
+		bool Ds;
+		bool Spp;
+
+		// @param selection 実行時に選ばれた組み合わせ
+		explicit DynamicScheme(const SchemeSelection& selection)
+			: Hs(selection.Hs),
+			Hl(selection.Hl),
+#ifdef PRESSURE_EXPLICIT
+			// 陽解法では圧力方程式を解かないので、その生成項を修正するECS法は使わない
+			Ecs(false),
+#else
+			Ecs(selection.Ecs),
+#endif
+			Gc(selection.Gc),
+			Ds(selection.Ds),
+			Spp(selection.Spp)
+		{}
+
+		// 実行時の組み合わせとして取得する
+		SchemeSelection Selection() const
+		{
+			return SchemeSelection{Hs, Hl, Ecs, Gc, Ds, Spp};
+		}
+	};
+
+	// defines.hppで指定した組み合わせ（既定値）
+	using DefaultScheme = Scheme<
+#ifdef MPS_HS
+		true,
+#else
+		false,
+#endif
+#ifdef MPS_HL
+		true,
+#else
+		false,
+#endif
+#ifdef MPS_ECS
+		true,
+#else
+		false,
+#endif
+#ifdef MPS_GC
+		true,
+#else
+		false,
+#endif
+#ifdef MPS_DS
+		true,
+#else
+		false,
+#endif
+#ifdef MPS_SPP
+		true
+#else
+		false
+#endif
+		>;
+
+	// 計算部分をコンパイル時に特殊化しておく組み合わせ
+	// ※組み合わせ毎に計算部分が全て生成されるので、よく使うものだけを並べる（先頭から順に探す）
+	// ※ここに無い組み合わせも、DynamicSchemeで計算できる
+	using Schemes = std::tuple<
+		DefaultScheme,
+		Scheme<false, false, false, false, false, false>, // 標準MPS法
+		Scheme<true, true, true, false, false, false>, // HS・HL・ECS法（自由表面判定あり）
+		Scheme<true, true, true, true, true, true>>; // 全て
+
+	namespace Detail
+	{
+		// 並べた組み合わせで一致しなかったら、実行時に決める組み合わせで呼び出す
+		template<std::size_t I, typename FUNC>
+		inline void DispatchScheme(const SchemeSelection& selection, FUNC& func, std::true_type)
+		{
+			func(DynamicScheme(selection));
+		}
+
+		// I番目の組み合わせから順に探す
+		template<std::size_t I, typename FUNC>
+		inline void DispatchScheme(const SchemeSelection& selection, FUNC& func, std::false_type)
+		{
+			using SCHEME = std::tuple_element_t<I, Schemes>;
+			if(SCHEME::Matches(selection))
+			{
+				func(SCHEME{});
+			}
+			else
+			{
+				DispatchScheme<I + 1>(selection, func, std::integral_constant<bool, (I + 1 == std::tuple_size<Schemes>::value)>{});
+			}
+		}
+	}
+
+	// 実行時に選ばれた組み合わせの型で関数を呼び出す
+	// @param selection 実行時に選ばれた組み合わせ
+	// @param func 組み合わせ（SchemeかDynamicScheme）の値を受け取る関数
+	template<typename FUNC>
+	inline void DispatchScheme(const SchemeSelection& selection, FUNC&& func)
+	{
+		Detail::DispatchScheme<0>(selection, func, std::integral_constant<bool, (std::tuple_size<Schemes>::value == 0)>{});
+	}
+}}
+#endif
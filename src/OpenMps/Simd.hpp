@@ -0,0 +1,703 @@
+﻿#ifndef SIMD_INCLUDED
+#define SIMD_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <array>
+#include <vector>
+#include <cmath>
+#ifdef SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+#pragma warning(pop)
+
+#include "Vector.hpp"
+
+namespace { namespace OpenMps
+{
+	// 近傍粒子との相互作用をまとめて計算する（SIMD命令で複数の近傍粒子を同時に処理する）
+	namespace Detail { namespace Simd
+	{
+		// 使用する命令セット
+		enum class Level
+		{
+			// SIMD命令を使わない
+			Scalar,
+
+			// AVX2（4粒子ずつ）
+			Avx2,
+
+			// AVX-512（8粒子ずつ）
+			Avx512,
+		};
+
+		// 実行中のCPUが対応している最も新しい命令セットを調べる
+		inline Level DetectLevel()
+		{
+#ifdef SIMD_X86
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			const auto maxId = info[0];
+			if(maxId < 7)
+			{
+				return Level::Scalar;
+			}
+
+			__cpuid(info, 1);
+			const auto hasOsxsave = (info[2] & (1 << 27)) != 0;
+			const auto hasFma = (info[2] & (1 << 12)) != 0;
+			if(!hasOsxsave)
+			{
+				return Level::Scalar;
+			}
+
+			// OSがレジスタの退避に対応しているか
+			const auto xcr0 = _xgetbv(0);
+			const auto isAvxEnabled = (xcr0 & 0x06) == 0x06;
+			const auto isAvx512Enabled = (xcr0 & 0xe6) == 0xe6;
+
+			__cpuidex(info, 7, 0);
+			const auto hasAvx2 = (info[1] & (1 << 5)) != 0;
+			const auto hasAvx512 = (info[1] & (1 << 16)) != 0;
+
+			if(hasAvx512 && isAvx512Enabled)
+			{
+				return Level::Avx512;
+			}
+			if(hasAvx2 && hasFma && isAvxEnabled)
+			{
+				return Level::Avx2;
+			}
+#else
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx512f"))
+			{
+				return Level::Avx512;
+			}
+			if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			{
+				return Level::Avx2;
+			}
+#endif
+#endif
+			return Level::Scalar;
+		}
+
+		// 計算に使う命令セット（起動時に自動で選択される）
+		inline Level& CurrentLevel()
+		{
+			static Level level = DetectLevel();
+			return level;
+		}
+
+		// 指定した命令セットが使えるかどうか
+		// @param level 命令セット
+		inline bool IsSupported(const Level level)
+		{
+			return static_cast<int>(level) <= static_cast<int>(DetectLevel());
+		}
+
+		// 影響半径内にある近傍粒子の値を、物理量毎に連続して並べたもの
+		// @tparam DIM 次元
+		template<std::size_t DIM = OpenMps::DIM>
+		struct Batch final
+		{
+			using Vector = OpenMps::Vector<DIM>;
+
+			// 相対位置（x_j - x_i）
+			std::array<std::vector<double>, DIM> dx;
+
+			// 距離の2乗
+			std::vector<double> r2;
+
+			// 相対的なベクトル量（u_j - u_iなど）
+			std::array<std::vector<double>, DIM> v;
+
+			// 近傍粒子毎の係数
+			std::vector<double> c;
+
+			// 粒子数
+			auto Size() const
+			{
+				return r2.size();
+			}
+
+			// 空にする（確保した領域は使い回す）
+			void Clear()
+			{
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					dx[d].clear();
+					v[d].clear();
+				}
+				r2.clear();
+				c.clear();
+			}
+
+			// 近傍粒子を追加する
+			// @param x 相対位置
+			// @param rr 距離の2乗
+			void Add(const Vector& x, const double rr)
+			{
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					dx[d].push_back(x[d]);
+				}
+				r2.push_back(rr);
+			}
+
+			// 最後に追加した近傍粒子のベクトル量を設定する
+			// @param vec ベクトル量
+			void AddVector(const Vector& vec)
+			{
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					v[d].push_back(vec[d]);
+				}
+			}
+
+			// 最後に追加した近傍粒子の係数を設定する
+			// @param coefficient 係数
+			void AddCoefficient(const double coefficient)
+			{
+				c.push_back(coefficient);
+			}
+		};
+
+		// 各スレッド用の作業領域
+		// @tparam DIM 次元
+		template<std::size_t DIM = OpenMps::DIM>
+		inline Batch<DIM>& ThreadBatch()
+		{
+			static thread_local Batch<DIM> batch;
+			return batch;
+		}
+
+		// 各命令セットでの計算
+		// ※全て先頭から[begin, end)の範囲の近傍粒子についての和
+		template<Level LEVEL>
+		struct Kernel;
+
+		template<>
+		struct Kernel<Level::Scalar> final
+		{
+			// 重み関数（距離0と影響半径外は0）
+			static double W(const double r, const double r_e)
+			{
+				return ((0 < r) && (r < r_e)) ? (r_e / r - 1) : 0;
+			}
+
+			// Σw
+			template<std::size_t DIM>
+			static double SumWeight(const Batch<DIM>& batch, const std::size_t begin, const double r_e)
+			{
+				auto sum = 0.0;
+				const auto n = batch.Size();
+				for(auto k = begin; k < n; k++)
+				{
+					sum += W(std::sqrt(batch.r2[k]), r_e);
+				}
+				return sum;
+			}
+
+			// Σw dx
+			template<std::size_t DIM>
+			static void SumWeightedDx(const Batch<DIM>& batch, const std::size_t begin, const double r_e, Vector<DIM>& sum)
+			{
+				const auto n = batch.Size();
+				for(auto k = begin; k < n; k++)
+				{
+					const auto w = W(std::sqrt(batch.r2[k]), r_e);
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						sum[d] += w * batch.dx[d][k];
+					}
+				}
+			}
+
+			// Σc v/r^3
+			template<std::size_t DIM>
+			static void SumViscosityHL(const Batch<DIM>& batch, const std::size_t begin, Vector<DIM>& sum)
+			{
+				const auto n = batch.Size();
+				for(auto k = begin; k < n; k++)
+				{
+					const auto r = std::sqrt(batch.r2[k]);
+					const auto a = batch.c[k] / (r*r*r);
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						sum[d] += a * batch.v[d][k];
+					}
+				}
+			}
+
+			// Σ(dx・v)/r^3
+			template<std::size_t DIM>
+			static double SumDivergenceHS(const Batch<DIM>& batch, const std::size_t begin)
+			{
+				auto sum = 0.0;
+				const auto n = batch.Size();
+				for(auto k = begin; k < n; k++)
+				{
+					const auto r = std::sqrt(batch.r2[k]);
+					auto dot = 0.0;
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						dot += batch.dx[d][k] * batch.v[d][k];
+					}
+					sum += dot / (r*r*r);
+				}
+				return sum;
+			}
+
+			// Σc/r^2 w dx（距離0の粒子は重みが0なので足さない）
+			template<std::size_t DIM>
+			static void SumPressureGradient(const Batch<DIM>& batch, const std::size_t begin, const double r_e, Vector<DIM>& sum)
+			{
+				const auto n = batch.Size();
+				for(auto k = begin; k < n; k++)
+				{
+					const auto r2 = batch.r2[k];
+					const auto w = W(std::sqrt(r2), r_e);
+					if(w != 0)
+					{
+						const auto a = batch.c[k] / r2 * w;
+						for(auto d = decltype(DIM){0}; d < DIM; d++)
+						{
+							sum[d] += a * batch.dx[d][k];
+						}
+					}
+				}
+			}
+		};
+
+#ifdef SIMD_X86
+		template<>
+		struct Kernel<Level::Avx2> final
+		{
+			static constexpr std::size_t WIDTH = 4;
+
+			SIMD_TARGET("avx2,fma")
+			static double Sum(const __m256d v)
+			{
+				auto lo = _mm256_castpd256_pd128(v);
+				const auto hi = _mm256_extractf128_pd(v, 1);
+				lo = _mm_add_pd(lo, hi);
+				return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+			}
+
+			// 重み関数（距離0と影響半径外は0）
+			SIMD_TARGET("avx2,fma")
+			static __m256d W(const __m256d r2, const __m256d r_e)
+			{
+				const auto r = _mm256_sqrt_pd(r2);
+				const auto w = _mm256_sub_pd(_mm256_div_pd(r_e, r), _mm256_set1_pd(1));
+				const auto isInside = _mm256_and_pd(
+					_mm256_cmp_pd(r2, _mm256_setzero_pd(), _CMP_GT_OQ),
+					_mm256_cmp_pd(r, r_e, _CMP_LT_OQ));
+				return _mm256_and_pd(isInside, w);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx2,fma")
+			static double SumWeight(const Batch<DIM>& batch, const std::size_t begin, const double r_e)
+			{
+				const auto re = _mm256_set1_pd(r_e);
+				auto sum = _mm256_setzero_pd();
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					sum = _mm256_add_pd(sum, W(_mm256_loadu_pd(&batch.r2[k]), re));
+				}
+				return Sum(sum) + Kernel<Level::Scalar>::SumWeight(batch, k, r_e);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx2,fma")
+			static void SumWeightedDx(const Batch<DIM>& batch, const std::size_t begin, const double r_e, Vector<DIM>& sum)
+			{
+				const auto re = _mm256_set1_pd(r_e);
+				__m256d acc[DIM];
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					acc[d] = _mm256_setzero_pd();
+				}
+
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto w = W(_mm256_loadu_pd(&batch.r2[k]), re);
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						acc[d] = _mm256_fmadd_pd(w, _mm256_loadu_pd(&batch.dx[d][k]), acc[d]);
+					}
+				}
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					sum[d] += Sum(acc[d]);
+				}
+				Kernel<Level::Scalar>::SumWeightedDx(batch, k, r_e, sum);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx2,fma")
+			static void SumViscosityHL(const Batch<DIM>& batch, const std::size_t begin, Vector<DIM>& sum)
+			{
+				__m256d acc[DIM];
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					acc[d] = _mm256_setzero_pd();
+				}
+
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto r = _mm256_sqrt_pd(_mm256_loadu_pd(&batch.r2[k]));
+					const auto a = _mm256_div_pd(_mm256_loadu_pd(&batch.c[k]), _mm256_mul_pd(_mm256_mul_pd(r, r), r));
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						acc[d] = _mm256_fmadd_pd(a, _mm256_loadu_pd(&batch.v[d][k]), acc[d]);
+					}
+				}
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					sum[d] += Sum(acc[d]);
+				}
+				Kernel<Level::Scalar>::SumViscosityHL(batch, k, sum);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx2,fma")
+			static double SumDivergenceHS(const Batch<DIM>& batch, const std::size_t begin)
+			{
+				auto sum = _mm256_setzero_pd();
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto r = _mm256_sqrt_pd(_mm256_loadu_pd(&batch.r2[k]));
+					auto dot = _mm256_setzero_pd();
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						dot = _mm256_fmadd_pd(_mm256_loadu_pd(&batch.dx[d][k]), _mm256_loadu_pd(&batch.v[d][k]), dot);
+					}
+					sum = _mm256_add_pd(sum, _mm256_div_pd(dot, _mm256_mul_pd(_mm256_mul_pd(r, r), r)));
+				}
+				return Sum(sum) + Kernel<Level::Scalar>::SumDivergenceHS(batch, k);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx2,fma")
+			static void SumPressureGradient(const Batch<DIM>& batch, const std::size_t begin, const double r_e, Vector<DIM>& sum)
+			{
+				const auto re = _mm256_set1_pd(r_e);
+				__m256d acc[DIM];
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					acc[d] = _mm256_setzero_pd();
+				}
+
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto r2 = _mm256_loadu_pd(&batch.r2[k]);
+					const auto w = W(r2, re);
+
+					// 重みが0の粒子は0除算になりうるので除外
+					const auto isValid = _mm256_cmp_pd(w, _mm256_setzero_pd(), _CMP_NEQ_OQ);
+					const auto a = _mm256_and_pd(isValid, _mm256_mul_pd(_mm256_div_pd(_mm256_loadu_pd(&batch.c[k]), r2), w));
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						acc[d] = _mm256_fmadd_pd(a, _mm256_loadu_pd(&batch.dx[d][k]), acc[d]);
+					}
+				}
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					sum[d] += Sum(acc[d]);
+				}
+				Kernel<Level::Scalar>::SumPressureGradient(batch, k, r_e, sum);
+			}
+		};
+
+		template<>
+		struct Kernel<Level::Avx512> final
+		{
+			static constexpr std::size_t WIDTH = 8;
+
+			SIMD_TARGET("avx512f")
+			static double Sum(const __m512d v)
+			{
+				double value[WIDTH];
+				_mm512_storeu_pd(value, v);
+
+				auto sum = 0.0;
+				for(const auto x : value)
+				{
+					sum += x;
+				}
+				return sum;
+			}
+
+			// 平方根
+			// ※_mm512_sqrt_pdは不定値を使っていて、gccが未初期化変数の警告を出すので
+			SIMD_TARGET("avx512f")
+			static __m512d Sqrt(const __m512d v)
+			{
+				return _mm512_maskz_sqrt_pd(static_cast<__mmask8>(0xff), v);
+			}
+
+			// 重み関数（距離0と影響半径外は0）
+			SIMD_TARGET("avx512f")
+			static __m512d W(const __m512d r2, const __m512d r_e)
+			{
+				const auto r = Sqrt(r2);
+				const auto isInside =
+					_mm512_cmp_pd_mask(r2, _mm512_setzero_pd(), _CMP_GT_OQ) &
+					_mm512_cmp_pd_mask(r, r_e, _CMP_LT_OQ);
+				return _mm512_maskz_sub_pd(isInside, _mm512_div_pd(r_e, r), _mm512_set1_pd(1));
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx512f")
+			static double SumWeight(const Batch<DIM>& batch, const std::size_t begin, const double r_e)
+			{
+				const auto re = _mm512_set1_pd(r_e);
+				auto sum = _mm512_setzero_pd();
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					sum = _mm512_add_pd(sum, W(_mm512_loadu_pd(&batch.r2[k]), re));
+				}
+				return Sum(sum) + Kernel<Level::Scalar>::SumWeight(batch, k, r_e);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx512f")
+			static void SumWeightedDx(const Batch<DIM>& batch, const std::size_t begin, const double r_e, Vector<DIM>& sum)
+			{
+				const auto re = _mm512_set1_pd(r_e);
+				__m512d acc[DIM];
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					acc[d] = _mm512_setzero_pd();
+				}
+
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto w = W(_mm512_loadu_pd(&batch.r2[k]), re);
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						acc[d] = _mm512_fmadd_pd(w, _mm512_loadu_pd(&batch.dx[d][k]), acc[d]);
+					}
+				}
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					sum[d] += Sum(acc[d]);
+				}
+				Kernel<Level::Scalar>::SumWeightedDx(batch, k, r_e, sum);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx512f")
+			static void SumViscosityHL(const Batch<DIM>& batch, const std::size_t begin, Vector<DIM>& sum)
+			{
+				__m512d acc[DIM];
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					acc[d] = _mm512_setzero_pd();
+				}
+
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto r = Sqrt(_mm512_loadu_pd(&batch.r2[k]));
+					const auto a = _mm512_div_pd(_mm512_loadu_pd(&batch.c[k]), _mm512_mul_pd(_mm512_mul_pd(r, r), r));
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						acc[d] = _mm512_fmadd_pd(a, _mm512_loadu_pd(&batch.v[d][k]), acc[d]);
+					}
+				}
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					sum[d] += Sum(acc[d]);
+				}
+				Kernel<Level::Scalar>::SumViscosityHL(batch, k, sum);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx512f")
+			static double SumDivergenceHS(const Batch<DIM>& batch, const std::size_t begin)
+			{
+				auto sum = _mm512_setzero_pd();
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto r = Sqrt(_mm512_loadu_pd(&batch.r2[k]));
+					auto dot = _mm512_setzero_pd();
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						dot = _mm512_fmadd_pd(_mm512_loadu_pd(&batch.dx[d][k]), _mm512_loadu_pd(&batch.v[d][k]), dot);
+					}
+					sum = _mm512_add_pd(sum, _mm512_div_pd(dot, _mm512_mul_pd(_mm512_mul_pd(r, r), r)));
+				}
+				return Sum(sum) + Kernel<Level::Scalar>::SumDivergenceHS(batch, k);
+			}
+
+			template<std::size_t DIM>
+			SIMD_TARGET("avx512f")
+			static void SumPressureGradient(const Batch<DIM>& batch, const std::size_t begin, const double r_e, Vector<DIM>& sum)
+			{
+				const auto re = _mm512_set1_pd(r_e);
+				__m512d acc[DIM];
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					acc[d] = _mm512_setzero_pd();
+				}
+
+				const auto n = batch.Size();
+				auto k = begin;
+				for(; k + WIDTH <= n; k += WIDTH)
+				{
+					const auto r2 = _mm512_loadu_pd(&batch.r2[k]);
+					const auto w = W(r2, re);
+
+					// 重みが0の粒子は0除算になりうるので除外
+					const auto isValid = _mm512_cmp_pd_mask(w, _mm512_setzero_pd(), _CMP_NEQ_OQ);
+					const auto a = _mm512_maskz_mul_pd(isValid, _mm512_div_pd(_mm512_loadu_pd(&batch.c[k]), r2), w);
+					for(auto d = decltype(DIM){0}; d < DIM; d++)
+					{
+						acc[d] = _mm512_fmadd_pd(a, _mm512_loadu_pd(&batch.dx[d][k]), acc[d]);
+					}
+				}
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					sum[d] += Sum(acc[d]);
+				}
+				Kernel<Level::Scalar>::SumPressureGradient(batch, k, r_e, sum);
+			}
+		};
+#endif
+
+		// Σw
+		// @param batch 近傍粒子
+		// @param r_e 影響半径
+		template<std::size_t DIM>
+		inline double SumWeight(const Batch<DIM>& batch, const double r_e)
+		{
+			switch(CurrentLevel())
+			{
+#ifdef SIMD_X86
+			case Level::Avx512:
+				return Kernel<Level::Avx512>::SumWeight(batch, 0, r_e);
+			case Level::Avx2:
+				return Kernel<Level::Avx2>::SumWeight(batch, 0, r_e);
+#endif
+			default:
+				return Kernel<Level::Scalar>::SumWeight(batch, 0, r_e);
+			}
+		}
+
+		// Σw dx
+		// @param batch 近傍粒子
+		// @param r_e 影響半径
+		template<std::size_t DIM>
+		inline Vector<DIM> SumWeightedDx(const Batch<DIM>& batch, const double r_e)
+		{
+			auto sum = VectorZero<DIM>;
+			switch(CurrentLevel())
+			{
+#ifdef SIMD_X86
+			case Level::Avx512:
+				Kernel<Level::Avx512>::SumWeightedDx(batch, 0, r_e, sum);
+				break;
+			case Level::Avx2:
+				Kernel<Level::Avx2>::SumWeightedDx(batch, 0, r_e, sum);
+				break;
+#endif
+			default:
+				Kernel<Level::Scalar>::SumWeightedDx(batch, 0, r_e, sum);
+				break;
+			}
+			return sum;
+		}
+
+		// Σc v/r^3（HL法の粘性項）
+		// @param batch 近傍粒子（vに速度差、cにダミー粒子なら0・それ以外は1）
+		template<std::size_t DIM>
+		inline Vector<DIM> SumViscosityHL(const Batch<DIM>& batch)
+		{
+			auto sum = VectorZero<DIM>;
+			switch(CurrentLevel())
+			{
+#ifdef SIMD_X86
+			case Level::Avx512:
+				Kernel<Level::Avx512>::SumViscosityHL(batch, 0, sum);
+				break;
+			case Level::Avx2:
+				Kernel<Level::Avx2>::SumViscosityHL(batch, 0, sum);
+				break;
+#endif
+			default:
+				Kernel<Level::Scalar>::SumViscosityHL(batch, 0, sum);
+				break;
+			}
+			return sum;
+		}
+
+		// Σ(dx・v)/r^3（HS法の粒子数密度の瞬間増加速度）
+		// @param batch 近傍粒子（vに速度差）
+		template<std::size_t DIM>
+		inline double SumDivergenceHS(const Batch<DIM>& batch)
+		{
+			switch(CurrentLevel())
+			{
+#ifdef SIMD_X86
+			case Level::Avx512:
+				return Kernel<Level::Avx512>::SumDivergenceHS(batch, 0);
+			case Level::Avx2:
+				return Kernel<Level::Avx2>::SumDivergenceHS(batch, 0);
+#endif
+			default:
+				return Kernel<Level::Scalar>::SumDivergenceHS(batch, 0);
+			}
+		}
+
+		// Σc/r^2 w dx（圧力勾配項）
+		// @param batch 近傍粒子（cに2粒子の圧力の和）
+		// @param r_e 影響半径
+		template<std::size_t DIM>
+		inline Vector<DIM> SumPressureGradient(const Batch<DIM>& batch, const double r_e)
+		{
+			auto sum = VectorZero<DIM>;
+			switch(CurrentLevel())
+			{
+#ifdef SIMD_X86
+			case Level::Avx512:
+				Kernel<Level::Avx512>::SumPressureGradient(batch, 0, r_e, sum);
+				break;
+			case Level::Avx2:
+				Kernel<Level::Avx2>::SumPressureGradient(batch, 0, r_e, sum);
+				break;
+#endif
+			default:
+				Kernel<Level::Scalar>::SumPressureGradient(batch, 0, r_e, sum);
+				break;
+			}
+			return sum;
+		}
+	}}
+}}
+#endif
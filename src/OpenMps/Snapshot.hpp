@@ -0,0 +1,552 @@
+﻿#ifndef SNAPSHOT_INCLUDED
+#define SNAPSHOT_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#pragma warning(pop)
+
+#include "Particle.hpp"
+
+namespace { namespace OpenMps
+{
+	// 計算結果の出力形式
+	enum class OutputFormat
+	{
+		// 1粒子1行のCSV
+		Csv,
+
+		// 物理量毎の配列をそのまま並べたバイナリ（スナップショット）
+		Binary,
+
+		// VTK XMLの非構造格子（ParaViewで直接読み込める）と時系列
+		Vtu,
+	};
+
+	// 各方向の名前（CSVの列名とスナップショットの物理量名）
+	// @tparam DIM 次元
+	template<std::size_t DIM>
+	struct AxisName;
+
+	template<>
+	struct AxisName<2> final
+	{
+		// 位置
+		static auto X()
+		{
+			return std::array<std::string, 2>{{"x", "z"}};
+		}
+
+		// 速度
+		static auto U()
+		{
+			return std::array<std::string, 2>{{"u", "w"}};
+		}
+	};
+
+	template<>
+	struct AxisName<3> final
+	{
+		// 位置
+		static auto X()
+		{
+			return std::array<std::string, 3>{{"x", "y", "z"}};
+		}
+
+		// 速度
+		static auto U()
+		{
+			return std::array<std::string, 3>{{"u", "v", "w"}};
+		}
+	};
+
+	// スナップショットの形式
+	// ※ヘッダー、物理量の記述子の並び、各物理量の配列（ALIGNMENT境界から開始）の順に並べる
+	// ※エンディアンは書き出した環境のまま
+	namespace Detail { namespace Snapshot
+	{
+		// ファイル先頭の識別子
+		static constexpr char MAGIC[8] = {'O', 'P', 'E', 'N', 'M', 'P', 'S', '\0'};
+
+		// 形式の版
+		static constexpr std::uint32_t VERSION = 1;
+
+		// 配列の先頭の境界（キャッシュラインの長さ）
+		static constexpr std::uint64_t ALIGNMENT = 64;
+
+		// 物理量の型
+		enum class FieldType : std::uint32_t
+		{
+			// 倍精度浮動小数点数
+			Float64 = 0,
+
+			// 32ビット符号付き整数
+			Int32 = 1,
+		};
+
+		// ヘッダー
+		struct Header final
+		{
+			// 識別子
+			char magic[8];
+
+			// 形式の版
+			std::uint32_t version;
+
+			// 次元
+			std::uint32_t dimension;
+
+			// 粒子数
+			std::uint64_t count;
+
+			// 時刻
+			double t;
+
+			// 物理量の数
+			std::uint32_t fieldCount;
+
+			// 予約（0）
+			std::uint32_t reserved;
+		};
+		static_assert(sizeof(Header) == 40, "Snapshot header must be packed");
+
+		// 物理量の記述子
+		struct FieldDescriptor final
+		{
+			// 名前（CSVの列名と同じ、終端文字で埋める）
+			char name[8];
+
+			// 型
+			FieldType type;
+
+			// 予約（0）
+			std::uint32_t reserved;
+
+			// 配列のファイル先頭からの位置
+			std::uint64_t offset;
+		};
+		static_assert(sizeof(FieldDescriptor) == 24, "Snapshot field descriptor must be packed");
+
+		// 1要素の大きさ
+		// @param type 型
+		inline std::uint64_t SizeOf(const FieldType type)
+		{
+			return (type == FieldType::Int32) ? sizeof(std::int32_t) : sizeof(double);
+		}
+
+		// 境界に揃えた位置
+		// @param offset 位置
+		inline std::uint64_t Align(const std::uint64_t offset)
+		{
+			return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		}
+
+		static_assert(sizeof(std::underlying_type_t<Particle<>::Type>) == sizeof(std::int32_t), "Particle type must be stored as 32bit integer");
+	}}
+
+	// 粒子の状態をスナップショットに書き出す
+	// ※物理量毎に全粒子分を集めてからまとめて書き出す
+	// @tparam DIM 次元
+	// @param filename 出力先
+	// @param n 粒子数
+	// @param t 時刻
+	// @param getParticle 粒子番号から粒子を取得する関数
+	// @return 無効粒子以外の粒子数
+	template<std::size_t DIM, typename GET_PARTICLE>
+	inline std::size_t WriteSnapshot(const std::string& filename, const std::size_t n, const double t, GET_PARTICLE getParticle)
+	{
+		namespace Snapshot = Detail::Snapshot;
+		using Particle = OpenMps::Particle<DIM>;
+
+		// 物理量の並び（CSVの列と同じ順）
+		std::vector<Snapshot::FieldDescriptor> fields;
+		const auto AddField = [&fields](const std::string& name, const Snapshot::FieldType type)
+		{
+			Snapshot::FieldDescriptor field;
+			std::memset(&field, 0, sizeof(field));
+			name.copy(field.name, sizeof(field.name) - 1); // 終端文字は0埋めで残す
+			field.type = type;
+			fields.push_back(field);
+		};
+		AddField("Type", Snapshot::FieldType::Int32);
+		for(const auto& name : AxisName<DIM>::X())
+		{
+			AddField(name, Snapshot::FieldType::Float64);
+		}
+		for(const auto& name : AxisName<DIM>::U())
+		{
+			AddField(name, Snapshot::FieldType::Float64);
+		}
+		AddField("p", Snapshot::FieldType::Float64);
+		AddField("n", Snapshot::FieldType::Float64);
+
+		// 各配列の位置を決める
+		auto offset = Snapshot::Align(sizeof(Snapshot::Header) + sizeof(Snapshot::FieldDescriptor) * fields.size());
+		for(auto& field : fields)
+		{
+			field.offset = offset;
+			offset = Snapshot::Align(offset + Snapshot::SizeOf(field.type) * n);
+		}
+
+		Snapshot::Header header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, Snapshot::MAGIC, sizeof(header.magic));
+		header.version = Snapshot::VERSION;
+		header.dimension = static_cast<std::uint32_t>(DIM);
+		header.count = n;
+		header.t = t;
+		header.fieldCount = static_cast<std::uint32_t>(fields.size());
+
+		std::ofstream output(filename, std::ios::binary);
+		if(!output)
+		{
+			throw std::runtime_error("Cannot open snapshot file: " + filename);
+		}
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(fields.data()), static_cast<std::streamsize>(sizeof(Snapshot::FieldDescriptor) * fields.size()));
+
+		// 境界まで埋めてから配列を書き出す
+		auto position = static_cast<std::uint64_t>(sizeof(header) + sizeof(Snapshot::FieldDescriptor) * fields.size());
+		const auto Write = [&output, &position](const std::uint64_t begin, const void* const data, const std::uint64_t size)
+		{
+			static const std::array<char, Snapshot::ALIGNMENT> padding = {};
+			output.write(padding.data(), static_cast<std::streamsize>(begin - position));
+			output.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			position = begin + size;
+		};
+
+		// 粒子の種類
+		std::size_t nonDisabledCount = 0;
+		{
+			std::vector<std::int32_t> type(n);
+#ifdef _OPENMP
+			#pragma omp parallel for reduction(+:nonDisabledCount)
+#endif
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				const auto particleType = getParticle(i).TYPE();
+				type[i] = static_cast<std::int32_t>(particleType);
+				if(particleType != Particle::Type::Disabled)
+				{
+					nonDisabledCount++;
+				}
+			}
+			Write(fields[0].offset, type.data(), sizeof(std::int32_t) * n);
+		}
+
+		// 倍精度の物理量
+		std::vector<double> value(n);
+		const auto WriteFloat64 = [&value, n, &Write](const std::uint64_t begin, const auto get)
+		{
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				value[i] = get(i);
+			}
+			Write(begin, value.data(), sizeof(double) * n);
+		};
+		auto field = fields.cbegin() + 1;
+		for(auto d = decltype(DIM){0}; d < DIM; d++, ++field)
+		{
+			WriteFloat64(field->offset, [&getParticle, d](const std::size_t i) { return getParticle(i).X()[d]; });
+		}
+		for(auto d = decltype(DIM){0}; d < DIM; d++, ++field)
+		{
+			WriteFloat64(field->offset, [&getParticle, d](const std::size_t i) { return getParticle(i).U()[d]; });
+		}
+		WriteFloat64(field->offset, [&getParticle](const std::size_t i) { return getParticle(i).P(); });
+		++field;
+		WriteFloat64(field->offset, [&getParticle](const std::size_t i) { return getParticle(i).N(); });
+
+		if(!output)
+		{
+			throw std::runtime_error("Cannot write snapshot file: " + filename);
+		}
+		return nonDisabledCount;
+	}
+
+	// スナップショットの読み込み
+	// ※ファイルをメモリにマップし、各物理量の配列はコピーせずにそのまま参照する
+	class SnapshotReader final
+	{
+	private:
+		// マップした先頭
+		const char* data;
+
+		// ファイルの大きさ
+		std::uint64_t size;
+
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+#endif
+
+		const Detail::Snapshot::Header& GetHeader() const
+		{
+			return *reinterpret_cast<const Detail::Snapshot::Header*>(data);
+		}
+
+		const Detail::Snapshot::FieldDescriptor& Descriptor(const std::size_t i) const
+		{
+			return reinterpret_cast<const Detail::Snapshot::FieldDescriptor*>(data + sizeof(Detail::Snapshot::Header))[i];
+		}
+
+		// 名前と型から物理量の配列を探す
+		// @param name 名前
+		// @param type 型
+		const char* Find(const std::string& name, const Detail::Snapshot::FieldType type) const
+		{
+			for(auto i = decltype(FieldCount()){0}; i < FieldCount(); i++)
+			{
+				if(FieldName(i) == name)
+				{
+					const auto& field = Descriptor(i);
+					if(field.type != type)
+					{
+						throw std::runtime_error("Snapshot field has unexpected type: " + name);
+					}
+					return data + field.offset;
+				}
+			}
+			throw std::runtime_error("Snapshot field doesn't exist: " + name);
+		}
+
+		// 形式が正しいか確認する
+		void Validate(const std::string& filename) const
+		{
+			namespace Snapshot = Detail::Snapshot;
+			if((size < sizeof(Snapshot::Header)) ||
+				(std::memcmp(GetHeader().magic, Snapshot::MAGIC, sizeof(Snapshot::MAGIC)) != 0))
+			{
+				throw std::runtime_error("Not a snapshot file: " + filename);
+			}
+			if(GetHeader().version != Snapshot::VERSION)
+			{
+				throw std::runtime_error("Unsupported snapshot version: " + filename);
+			}
+			if(size < sizeof(Snapshot::Header) + sizeof(Snapshot::FieldDescriptor) * GetHeader().fieldCount)
+			{
+				throw std::runtime_error("Snapshot file is truncated: " + filename);
+			}
+			for(auto i = decltype(FieldCount()){0}; i < FieldCount(); i++)
+			{
+				const auto& field = Descriptor(i);
+				if((field.offset % sizeof(double) != 0) ||
+					(field.offset + Snapshot::SizeOf(field.type) * GetHeader().count > size))
+				{
+					throw std::runtime_error("Snapshot file is truncated: " + filename);
+				}
+			}
+		}
+
+		void Unmap()
+		{
+#ifdef _WIN32
+			if(data != nullptr)
+			{
+				UnmapViewOfFile(data);
+			}
+			if(mapping != nullptr)
+			{
+				CloseHandle(mapping);
+			}
+			if(file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(file);
+			}
+#else
+			if(data != nullptr)
+			{
+				munmap(const_cast<char*>(data), static_cast<std::size_t>(size));
+			}
+#endif
+		}
+
+	public:
+		// @param filename スナップショットのファイル名
+		explicit SnapshotReader(const std::string& filename)
+			: data(nullptr), size(0)
+#ifdef _WIN32
+			, file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+		{
+#ifdef _WIN32
+			file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			LARGE_INTEGER fileSize;
+			if((file == INVALID_HANDLE_VALUE) || !GetFileSizeEx(file, &fileSize))
+			{
+				Unmap();
+				throw std::runtime_error("Cannot open snapshot file: " + filename);
+			}
+			size = static_cast<std::uint64_t>(fileSize.QuadPart);
+			if(size > 0)
+			{
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				data = (mapping == nullptr) ? nullptr : static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				if(data == nullptr)
+				{
+					Unmap();
+					throw std::runtime_error("Cannot map snapshot file: " + filename);
+				}
+			}
+#else
+			const auto fd = open(filename.c_str(), O_RDONLY);
+			struct stat status;
+			if((fd < 0) || (fstat(fd, &status) != 0))
+			{
+				if(fd >= 0)
+				{
+					close(fd);
+				}
+				throw std::runtime_error("Cannot open snapshot file: " + filename);
+			}
+			size = static_cast<std::uint64_t>(status.st_size);
+			if(size > 0)
+			{
+				const auto mapped = mmap(nullptr, static_cast<std::size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if(mapped == MAP_FAILED)
+				{
+					close(fd);
+					throw std::runtime_error("Cannot map snapshot file: " + filename);
+				}
+				data = static_cast<const char*>(mapped);
+			}
+			close(fd); // マップした領域はファイルを閉じても有効
+#endif
+
+			try
+			{
+				Validate(filename);
+			}
+			catch(...)
+			{
+				Unmap();
+				throw;
+			}
+		}
+
+		~SnapshotReader()
+		{
+			Unmap();
+		}
+
+		SnapshotReader(const SnapshotReader&) = delete;
+		SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+		// 次元
+		std::size_t Dimension() const
+		{
+			return GetHeader().dimension;
+		}
+
+		// 粒子数
+		std::size_t Count() const
+		{
+			return static_cast<std::size_t>(GetHeader().count);
+		}
+
+		// 時刻
+		double T() const
+		{
+			return GetHeader().t;
+		}
+
+		// 物理量の数
+		std::size_t FieldCount() const
+		{
+			return GetHeader().fieldCount;
+		}
+
+		// 物理量の名前
+		// @param i 物理量の番号
+		std::string FieldName(const std::size_t i) const
+		{
+			const auto& name = Descriptor(i).name;
+			return std::string(name, strnlen(name, sizeof(name)));
+		}
+
+		// 倍精度の物理量の配列
+		// @param name 名前
+		const double* Float64(const std::string& name) const
+		{
+			return reinterpret_cast<const double*>(Find(name, Detail::Snapshot::FieldType::Float64));
+		}
+
+		// 整数の物理量の配列
+		// @param name 名前
+		const std::int32_t* Int32(const std::string& name) const
+		{
+			return reinterpret_cast<const std::int32_t*>(Find(name, Detail::Snapshot::FieldType::Int32));
+		}
+
+		// 粒子を作成する
+		// @tparam DIM 次元
+		template<std::size_t DIM>
+		std::vector<Particle<DIM>> Particles() const
+		{
+			using Particle = OpenMps::Particle<DIM>;
+			if(Dimension() != DIM)
+			{
+				throw std::runtime_error("Snapshot dimension doesn't match");
+			}
+
+			const auto type = Int32("Type");
+			std::array<const double*, DIM> x, u;
+			for(auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				x[d] = Float64(AxisName<DIM>::X()[d]);
+				u[d] = Float64(AxisName<DIM>::U()[d]);
+			}
+			const auto p = Float64("p");
+			const auto n = Float64("n");
+
+			std::vector<Particle> particles;
+			const auto count = Count();
+			particles.reserve(count);
+			for(auto i = decltype(count){0}; i < count; i++)
+			{
+				auto particle = Particle(static_cast<typename Particle::Type>(type[i]));
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					particle.X()[d] = x[d][i];
+					particle.U()[d] = u[d][i];
+				}
+				particle.P() = p[i];
+				particle.N() = n[i];
+				particles.push_back(std::move(particle));
+			}
+			return particles;
+		}
+	};
+}}
+#endif
@@ -10,18 +10,21 @@ namespace
 	class Timer final
 	{
 	private:
-		std::chrono::time_point<std::chrono::system_clock> begin;
+		// ※時刻合わせで戻らないように、単調増加の時計を使う
+		std::chrono::time_point<std::chrono::steady_clock> begin;
 
 	public:
 		void Start()
 		{
-			this->begin = std::chrono::system_clock::now();
+			this->begin = std::chrono::steady_clock::now();
 		}
 
-		auto Time()
+		// 開始からの経過時間[s]
+		// ※1時間刻みの中の処理も測れるように、マイクロ秒単位で計る
+		auto Time() const
 		{
-			const auto end = std::chrono::system_clock::now();
-			return std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count()/1000.0;
+			const auto end = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()/1000000.0;
 		}
 	};
 }
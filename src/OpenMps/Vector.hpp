@@ -17,11 +17,29 @@
 namespace { namespace OpenMps
 {
 	// ベクトル
-	using Vector = boost::numeric::ublas::c_vector<double, DIM>;
+	// @tparam D 次元
+	template<std::size_t D = DIM>
+	using Vector = boost::numeric::ublas::c_vector<double, D>;
+
+	// 各方向の番号
+	// ※鉛直方向は常に最後の方向にする
+	// @tparam D 次元
+	template<std::size_t D>
+	struct Axis final
+	{
+		// 水平方向
+		static constexpr std::size_t X = 0;
+
+		// 奥行き方向（3次元の時のみ）
+		static constexpr std::size_t Y = 1;
+
+		// 鉛直方向
+		static constexpr std::size_t Z = D - 1;
+	};
 
 	namespace Detail
 	{
-		template<decltype(DIM) D>
+		template<std::size_t D>
 		struct CreateVector;
 
 		template<>
@@ -29,7 +47,7 @@ namespace { namespace OpenMps
 		{
 			static auto Get(const std::tuple<double, double>& val)
 			{
-				Vector vec;
+				Vector<2> vec;
 				vec[0] = std::get<0>(val);
 				vec[1] = std::get<1>(val);
 				return vec;
@@ -46,7 +64,7 @@ namespace { namespace OpenMps
 		{
 			static auto Get(const std::tuple<double, double, double>& val)
 			{
-				Vector vec;
+				Vector<3> vec;
 				vec[0] = std::get<0>(val);
 				vec[1] = std::get<1>(val);
 				vec[2] = std::get<2>(val);
@@ -61,18 +79,24 @@ namespace { namespace OpenMps
 	}
 
 	// ベクトルを作成する
+	// ※次元は成分の数から決まる
 	template<typename T, typename... ARGS>
 	inline auto CreateVector(const T val, const ARGS... args)
 	{
-		return Detail::CreateVector<DIM>::Get(std::make_tuple(val, args...));
+		return Detail::CreateVector<sizeof...(ARGS) + 1>::Get(std::make_tuple(val, args...));
 	}
-	template<typename T>
+
+	// 全成分が同じ値のベクトルを作成する
+	// @tparam D 次元
+	template<std::size_t D = DIM, typename T>
 	inline auto CreateVector(const T val)
 	{
-		return Detail::CreateVector<DIM>::Get(val);
+		return Detail::CreateVector<D>::Get(val);
 	}
 
 	// ゼロベクトル
-	static const auto VectorZero = CreateVector(0);
+	// @tparam D 次元
+	template<std::size_t D = DIM>
+	static const Vector<D> VectorZero = CreateVector<D>(0);
 }}
 #endif
@@ -0,0 +1,311 @@
+﻿#ifndef VTU_INCLUDED
+#define VTU_INCLUDED
+#include "defines.hpp"
+
+#pragma warning(push, 0)
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#pragma warning(pop)
+
+#include "Particle.hpp"
+
+namespace { namespace OpenMps
+{
+	// VTK XML形式（ParaViewで直接読み込める形式）
+	// ※粒子を頂点セルとする非構造格子（.vtu）に、各配列を生のバイナリのまま末尾にまとめて置く
+	// ※位置と速度はVTKの規約に合わせて常に3成分とし、2次元では (x, z, 0) のように鉛直方向を2番目に置く
+	namespace Detail { namespace Vtu
+	{
+		// 頂点セルの種類番号（VTK_VERTEX）
+		static constexpr std::uint8_t VERTEX = 1;
+
+		// 配列の大きさの型（header_typeで指定する）
+		using Size = std::uint64_t;
+
+		// 実行環境のバイト順の名前
+		inline const char* ByteOrder()
+		{
+			const std::uint16_t one = 1;
+			return (*reinterpret_cast<const std::uint8_t*>(&one) == 1) ? "LittleEndian" : "BigEndian";
+		}
+
+		// XMLの属性に書き出すための文字列の置換
+		// @param value 値
+		inline std::string Escape(const std::string& value)
+		{
+			std::string escaped;
+			for(const auto c : value)
+			{
+				switch(c)
+				{
+				case '&': escaped += "&amp;"; break;
+				case '<': escaped += "&lt;"; break;
+				case '>': escaped += "&gt;"; break;
+				case '"': escaped += "&quot;"; break;
+				default: escaped += c; break;
+				}
+			}
+			return escaped;
+		}
+	}}
+
+	// 粒子の状態をVTK XMLの非構造格子ファイルに書き出す
+	// @tparam DIM 次元
+	// @param filename 出力先
+	// @param n 粒子数
+	// @param t 時刻
+	// @param getParticle 粒子番号から粒子を取得する関数
+	// @return 無効粒子以外の粒子数
+	template<std::size_t DIM, typename GET_PARTICLE>
+	inline std::size_t WriteVtu(const std::string& filename, const std::size_t n, const double t, GET_PARTICLE getParticle)
+	{
+		namespace Vtu = Detail::Vtu;
+		using Particle = OpenMps::Particle<DIM>;
+		static_assert(DIM <= 3, "VTK points have at most 3 components");
+
+		// 末尾に置く配列の並びと、それぞれの位置（大きさの分を含む）
+		struct Array final
+		{
+			const char* name;
+			const char* type;
+			std::size_t components;
+			Vtu::Size bytes;
+		};
+		const auto count = static_cast<Vtu::Size>(n);
+		const std::array<Array, 8> arrays = {{
+			{"TimeValue", "Float64", 1, sizeof(double)},
+			{"Points", "Float64", 3, sizeof(double) * 3 * count},
+			{"Type", "Int32", 1, sizeof(std::int32_t) * count},
+			{"Velocity", "Float64", 3, sizeof(double) * 3 * count},
+			{"p", "Float64", 1, sizeof(double) * count},
+			{"n", "Float64", 1, sizeof(double) * count},
+			{"connectivity", "Int64", 1, sizeof(std::int64_t) * count},
+			{"offsets", "Int64", 1, sizeof(std::int64_t) * count},
+		}};
+		const Vtu::Size typesBytes = sizeof(std::uint8_t) * count;
+		std::array<Vtu::Size, 9> offsets;
+		offsets[0] = 0;
+		for(auto i = decltype(arrays.size()){0}; i < arrays.size(); i++)
+		{
+			offsets[i + 1] = offsets[i] + sizeof(Vtu::Size) + arrays[i].bytes;
+		}
+
+		std::ofstream output(filename, std::ios::binary);
+		if(!output)
+		{
+			throw std::runtime_error("Cannot open VTU file: " + filename);
+		}
+
+		// 配列の記述
+		const auto DataArray = [&output, &arrays, &offsets](const std::size_t i)
+		{
+			output << "<DataArray type=\"" << arrays[i].type << "\" Name=\"" << arrays[i].name << "\"";
+			if(arrays[i].components != 1)
+			{
+				output << " NumberOfComponents=\"" << arrays[i].components << "\"";
+			}
+			output << " format=\"appended\" offset=\"" << offsets[i] << "\"/>\n";
+		};
+		output
+			<< "<?xml version=\"1.0\"?>\n"
+			<< "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << Vtu::ByteOrder() << "\" header_type=\"UInt64\">\n"
+			<< "<UnstructuredGrid>\n"
+			<< "<FieldData>\n";
+		DataArray(0);
+		output
+			<< "</FieldData>\n"
+			<< "<Piece NumberOfPoints=\"" << n << "\" NumberOfCells=\"" << n << "\">\n"
+			<< "<Points>\n";
+		DataArray(1);
+		output
+			<< "</Points>\n"
+			<< "<PointData Scalars=\"p\" Vectors=\"Velocity\">\n";
+		DataArray(2);
+		DataArray(3);
+		DataArray(4);
+		DataArray(5);
+		output
+			<< "</PointData>\n"
+			<< "<Cells>\n";
+		DataArray(6);
+		DataArray(7);
+		output
+			<< "<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"" << offsets[8] << "\"/>\n"
+			<< "</Cells>\n"
+			<< "</Piece>\n"
+			<< "</UnstructuredGrid>\n"
+			<< "<AppendedData encoding=\"raw\">\n_";
+
+		// 大きさに続けて配列を書き出す
+		const auto Write = [&output](const void* const data, const Vtu::Size bytes)
+		{
+			output.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+			output.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+		};
+		Write(&t, sizeof(t));
+
+		// 3成分のベクトル（2次元では最後の成分を0のままにする）
+		std::vector<double> vector(3 * n, 0.0);
+		const auto WriteVector = [&vector, n, &Write](const auto get)
+		{
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				const auto& value = get(i);
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					vector[3 * i + d] = value[d];
+				}
+			}
+			Write(vector.data(), sizeof(double) * vector.size());
+		};
+		WriteVector([&getParticle](const std::size_t i) -> decltype(auto) { return getParticle(i).X(); });
+
+		// 粒子の種類
+		std::size_t nonDisabledCount = 0;
+		{
+			std::vector<std::int32_t> type(n);
+#ifdef _OPENMP
+			#pragma omp parallel for reduction(+:nonDisabledCount)
+#endif
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				const auto particleType = getParticle(i).TYPE();
+				type[i] = static_cast<std::int32_t>(particleType);
+				if(particleType != Particle::Type::Disabled)
+				{
+					nonDisabledCount++;
+				}
+			}
+			Write(type.data(), sizeof(std::int32_t) * n);
+		}
+
+		WriteVector([&getParticle](const std::size_t i) -> decltype(auto) { return getParticle(i).U(); });
+
+		// スカラー
+		std::vector<double> value(n);
+		const auto WriteScalar = [&value, n, &Write](const auto get)
+		{
+			OMP_PARALLEL_FOR
+#ifdef SIGNED_LOOP_COUNTER
+			for (auto ii = std::make_signed_t<decltype(n)>{0}; ii < static_cast<std::make_signed_t<decltype(n)>>(n); ii++)
+			{
+				const auto i = static_cast<decltype(n)>(ii);
+#else
+			for (auto i = decltype(n){0}; i < n; i++)
+			{
+#endif
+				value[i] = get(i);
+			}
+			Write(value.data(), sizeof(double) * n);
+		};
+		WriteScalar([&getParticle](const std::size_t i) { return getParticle(i).P(); });
+		WriteScalar([&getParticle](const std::size_t i) { return getParticle(i).N(); });
+
+		// 1粒子1頂点のセル
+		{
+			std::vector<std::int64_t> index(n);
+			for(auto i = decltype(n){0}; i < n; i++)
+			{
+				index[i] = static_cast<std::int64_t>(i);
+			}
+			Write(index.data(), sizeof(std::int64_t) * n);
+			for(auto i = decltype(n){0}; i < n; i++)
+			{
+				index[i] = static_cast<std::int64_t>(i + 1);
+			}
+			Write(index.data(), sizeof(std::int64_t) * n);
+		}
+		{
+			const std::vector<std::uint8_t> types(n, Vtu::VERTEX);
+			Write(types.data(), typesBytes);
+		}
+
+		output << "\n</AppendedData>\n</VTKFile>\n";
+		if(!output)
+		{
+			throw std::runtime_error("Cannot write VTU file: " + filename);
+		}
+		return nonDisabledCount;
+	}
+
+	// VTK XMLの時系列（.pvd）
+	// ※追加する度に書き直すので、計算の途中でもそれまでの結果をParaViewで開ける
+	class VtuCollection final
+	{
+	private:
+		// 出力先
+		const std::string filename;
+
+		// 各時刻のファイル
+		std::vector<std::pair<double, std::string>> entries;
+
+		// 書き出す
+		void Write() const
+		{
+			std::ofstream output(filename);
+			if(!output)
+			{
+				throw std::runtime_error("Cannot open PVD file: " + filename);
+			}
+
+			// 時刻は読み込み直しても同じ値になる精度で書く
+			output.precision(17);
+			output
+				<< "<?xml version=\"1.0\"?>\n"
+				<< "<VTKFile type=\"Collection\" version=\"1.0\" byte_order=\"" << Detail::Vtu::ByteOrder() << "\">\n"
+				<< "<Collection>\n";
+			for(const auto& entry : entries)
+			{
+				output << "<DataSet timestep=\"" << entry.first << "\" part=\"0\" file=\"" << Detail::Vtu::Escape(entry.second) << "\"/>\n";
+			}
+			output
+				<< "</Collection>\n"
+				<< "</VTKFile>\n";
+			if(!output)
+			{
+				throw std::runtime_error("Cannot write PVD file: " + filename);
+			}
+		}
+
+	public:
+		// @param filename_ 出力先
+		explicit VtuCollection(const std::string& filename_)
+			: filename(filename_), entries()
+		{}
+
+		// ファイルを追加する
+		// @param t 時刻
+		// @param file 追加するファイル（時系列のファイルからの相対パス）
+		void Add(const double t, const std::string& file)
+		{
+			entries.emplace_back(t, file);
+			Write();
+		}
+
+		// 追加したファイルの数
+		std::size_t Count() const
+		{
+			return entries.size();
+		}
+	};
+}}
+#endif
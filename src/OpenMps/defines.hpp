@@ -6,7 +6,8 @@
 // 何も指定しなければ標準MPS法が採用される //
 /////////////////////////////////////////////
 
-// 3次元にする
+// 既定の次元を3次元にする
+// ※次元は入力XMLのenvironment.dimensionで選べるので、これは指定が無い時とテストで使う次元
 // ※用意はしているが現時点では非推奨
 // #define DIM3
 
@@ -25,6 +26,9 @@
 // 　短所：時間刻みが小さくなる・弱圧縮を許容する
 // #define PRESSURE_EXPLICIT
 
+// 以下のHS・HL・ECS・GC・DS・SPP法は既定の組み合わせで、入力ファイルのschemeで実行時にも選べる
+// ※選べるのはScheme.hppのSchemesに並べた組み合わせのみ
+
 // HS法（高精度生成項）, Khayyer and Gotoh (2009)
 //   長所：高精度化
 //   短所：計算負荷の微増
@@ -65,8 +69,17 @@
 // 行列計算にViennaCLを使用する。
 #define USE_VIENNACL
 
+// 近傍粒子との相互作用の計算にSIMD命令（AVX2/AVX-512）を使用する。
+// ※実行時にCPUが対応しているものが選ばれ、非対応なら使わない
+#define USE_SIMD
+
 /**************************************************************/
 // 以下、自動設定（手動で変更しないこと）
+#ifdef PRESSURE_EXPLICIT
+	// 陽解法では圧力方程式を解かないので、その生成項を修正するECS法は使わない
+	#undef MPS_ECS
+#endif
+
 #ifdef USE_VIENNACL
 	#ifdef _OPENMP
 		// ViennaCLでOpenMPを使用する
@@ -74,6 +87,34 @@
 	#endif
 #endif
 
+// OpenMP関連
+#ifdef _OPENMP
+	#ifdef _MSC_VER
+		#define OMP_PARALLEL_FOR __pragma(omp parallel for)
+	#else
+		#define OMP_PARALLEL_FOR _Pragma("omp parallel for")
+	#endif
+	#if _OPENMP < 200805 // v3.0未満の場合、反復変数は符号付きにしなければならない
+		#define SIGNED_LOOP_COUNTER
+		#define ATOMIC_LOCK // atomic captureも使えない
+	#endif
+#else
+	#define OMP_PARALLEL_FOR
+#endif
+
+// SIMD関連
+#ifdef USE_SIMD
+	#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) || (defined(_MSC_VER) && defined(_M_X64))
+		// x86の拡張命令を、関数毎に命令セットを指定してコンパイルする
+		#define SIMD_X86
+		#ifdef _MSC_VER
+			#define SIMD_TARGET(isa)
+		#else
+			#define SIMD_TARGET(isa) __attribute__((target(isa)))
+		#endif
+	#endif
+#endif
+
 #include <cstddef>
 
 namespace { namespace OpenMps
@@ -0,0 +1,156 @@
+﻿#include <gtest/gtest.h>
+#include "../Amg.hpp"
+
+namespace {
+	using Matrix = boost::numeric::ublas::compressed_matrix<double>;
+	using LongVector = OpenMps::Detail::Preconditioning::LongVector;
+	using Csr = OpenMps::Detail::Preconditioning::Csr;
+
+	// 許容する誤差
+	static constexpr double testAccuracy = 1e-12;
+
+	// 2次元ポアソン方程式の係数行列（5点差分、対角成分が負）
+	Csr CreatePoisson2d(const std::size_t nx)
+	{
+		const auto n = nx * nx;
+		Matrix A(n, n);
+		for (auto j = decltype(nx){0}; j < nx; j++)
+		{
+			for (auto i = decltype(nx){0}; i < nx; i++)
+			{
+				const auto k = i + nx * j;
+				if (j > 0)
+				{
+					A(k, k - nx) = 1.0;
+				}
+				if (i > 0)
+				{
+					A(k, k - 1) = 1.0;
+				}
+				A(k, k) = -4.0;
+				if (i + 1 < nx)
+				{
+					A(k, k + 1) = 1.0;
+				}
+				if (j + 1 < nx)
+				{
+					A(k, k + nx) = 1.0;
+				}
+			}
+		}
+
+		Csr csr;
+		csr.Assign(A);
+		return csr;
+	}
+
+	// 密行列に戻す
+	boost::numeric::ublas::matrix<double> ToDense(const Csr& A, const std::size_t m)
+	{
+		const auto n = A.Size();
+		boost::numeric::ublas::matrix<double> dense(n, m);
+		dense.clear();
+		for (auto i = decltype(n){0}; i < n; i++)
+		{
+			for (auto k = A.start[i]; k < A.start[i + 1]; k++)
+			{
+				dense(i, A.column[k]) = A.value[k];
+			}
+		}
+		return dense;
+	}
+
+	// 1V-サイクルでの誤差の縮小率 |x - M^-1 A x| / |x|
+	double ErrorReduction(const OpenMps::Detail::Preconditioning::Amg& amg, const Csr& A)
+	{
+		const auto n = A.Size();
+		LongVector x(n);
+		for (auto i = decltype(n){0}; i < n; i++)
+		{
+			x(i) = std::sin(0.37 * i) + 0.5 * std::cos(0.011 * i * i);
+		}
+
+		LongVector Ax, z;
+		OpenMps::Detail::Preconditioning::Multiply(A, x, Ax);
+		amg.Apply(A, Ax, z);
+		return boost::numeric::ublas::norm_2(x - z) / boost::numeric::ublas::norm_2(x);
+	}
+}
+
+// 疎行列の積と転置が密行列での計算と一致するか？
+TEST(AmgTest, SparseProductAndTranspose)
+{
+	constexpr std::size_t nx = 5;
+	const auto A = CreatePoisson2d(nx);
+	const auto n = A.Size();
+	const auto At = OpenMps::Detail::Preconditioning::Transpose(A, n);
+	const auto AA = OpenMps::Detail::Preconditioning::Multiply(A, At, n);
+
+	const auto denseA = ToDense(A, n);
+	const boost::numeric::ublas::matrix<double> expected = boost::numeric::ublas::prod(denseA, boost::numeric::ublas::trans(denseA));
+	const auto actual = ToDense(AA, n);
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		for (auto j = decltype(n){0}; j < n; j++)
+		{
+			ASSERT_NEAR(actual(i, j), expected(i, j), testAccuracy);
+		}
+
+		// 列番号は昇順
+		for (auto k = AA.start[i] + 1; k < AA.start[i + 1]; k++)
+		{
+			ASSERT_LT(AA.column[k - 1], AA.column[k]);
+		}
+		ASSERT_EQ(AA.Diagonal(i), expected(i, i));
+	}
+}
+
+// 小さい行列は直接法だけで厳密に解けるか？
+TEST(AmgTest, CoarseDirectSolve)
+{
+	const auto A = CreatePoisson2d(10);
+
+	OpenMps::Detail::Preconditioning::Amg amg;
+	amg.Compute(A);
+	ASSERT_EQ(amg.LevelCount(), 1u);
+	ASSERT_NEAR(ErrorReduction(amg, A), 0.0, testAccuracy);
+}
+
+// 多層にした時、V-サイクルが解像度に依らず誤差を十分に減らすか？
+TEST(AmgTest, ConvergenceFactor)
+{
+	for (const std::size_t nx : {32, 64, 128})
+	{
+		const auto A = CreatePoisson2d(nx);
+
+		OpenMps::Detail::Preconditioning::Amg amg;
+		amg.Compute(A);
+		ASSERT_GT(amg.LevelCount(), 1u) << nx;
+		ASSERT_EQ(amg.Size(), A.Size()) << nx;
+		ASSERT_LT(ErrorReduction(amg, A), 0.5) << nx;
+	}
+}
+
+// 係数行列が少し変わっても、階層を使い回して更新すれば作り直した時と同程度に効くか？
+TEST(AmgTest, Update)
+{
+	constexpr std::size_t nx = 64;
+	const auto A = CreatePoisson2d(nx);
+
+	OpenMps::Detail::Preconditioning::Amg amg;
+	amg.Compute(A);
+
+	auto B = A;
+	for (auto i = decltype(nx){0}; i < B.Size(); i++)
+	{
+		B.value[B.diagonal[i]] -= 0.05;
+	}
+	amg.Update(B);
+	const auto updated = ErrorReduction(amg, B);
+
+	OpenMps::Detail::Preconditioning::Amg fresh;
+	fresh.Compute(B);
+	const auto computed = ErrorReduction(fresh, B);
+
+	ASSERT_LT(updated, computed * 1.1 + 1e-3);
+}
@@ -0,0 +1,133 @@
+﻿#include <gtest/gtest.h>
+#include "../AsyncOutput.hpp"
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+namespace {
+	using Particle = OpenMps::Particle<>;
+
+	// 出力番号と同じ数の粒子を作る（出力番号の倍数を無効粒子にする）
+	auto CreateParticles(const std::size_t outputCount)
+	{
+		std::vector<Particle> particles;
+		for(auto i = decltype(outputCount){0}; i < outputCount; i++)
+		{
+			auto particle = Particle((i % 3 == 2) ? Particle::Type::Disabled : Particle::Type::IncompressibleNewton);
+			particle.P() = static_cast<double>(outputCount * 1000 + i);
+			particles.push_back(std::move(particle));
+		}
+		return particles;
+	}
+}
+
+// 予約した順に、予約した時の粒子が書き出されるか？
+TEST(AsyncOutputTest, WriteInOrder)
+{
+	constexpr std::size_t outputCount = 20;
+	std::vector<std::size_t> writtenCount;
+	std::vector<double> writtenT;
+	std::vector<std::vector<Particle>> writtenParticles;
+	{
+		OpenMps::AsyncOutput<> output([&](const std::vector<Particle>& particles, const std::size_t count, const double t)
+		{
+			writtenCount.push_back(count);
+			writtenT.push_back(t);
+			writtenParticles.push_back(particles);
+		});
+
+		for(auto count = std::size_t{0}; count < outputCount; count++)
+		{
+			auto particles = CreateParticles(count);
+			const auto nonDisabledCount = output.Push(particles.size(), [&particles](const std::size_t i) -> decltype(auto)
+			{
+				return particles[i];
+			}, count, count * 0.5);
+			ASSERT_EQ(count - count / 3, nonDisabledCount);
+
+			// 予約した後に元の粒子を変えても、書き出される内容は変わらない
+			for(auto& particle : particles)
+			{
+				particle.P() = -1;
+			}
+		}
+		output.Flush();
+	}
+
+	ASSERT_EQ(outputCount, writtenCount.size());
+	for(auto count = std::size_t{0}; count < outputCount; count++)
+	{
+		ASSERT_EQ(count, writtenCount[count]);
+		ASSERT_EQ(count * 0.5, writtenT[count]);
+
+		const auto expected = CreateParticles(count);
+		ASSERT_EQ(expected.size(), writtenParticles[count].size());
+		for(auto i = decltype(expected.size()){0}; i < expected.size(); i++)
+		{
+			ASSERT_EQ(expected[i].TYPE(), writtenParticles[count][i].TYPE());
+			ASSERT_EQ(expected[i].P(), writtenParticles[count][i].P());
+		}
+	}
+}
+
+// 書き出しが追いつかない時は、作業領域の数を超えて予約されずに待つか？
+TEST(AsyncOutputTest, BackPressure)
+{
+	std::atomic<std::size_t> writingCount(0);
+	std::atomic<std::size_t> writtenCount(0);
+	std::atomic<std::size_t> maxPendingCount(0);
+	std::atomic<std::size_t> pushedCount(0);
+	{
+		OpenMps::AsyncOutput<> output([&](const std::vector<Particle>&, const std::size_t, const double)
+		{
+			writingCount++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			writtenCount++;
+		});
+
+		const auto particles = CreateParticles(10);
+		for(auto count = std::size_t{0}; count < 6; count++)
+		{
+			output.Push(particles.size(), [&particles](const std::size_t i) -> decltype(auto)
+			{
+				return particles[i];
+			}, count, 0);
+			pushedCount++;
+
+			// 書き出し待ちは、書き出し中のものを含めて作業領域の数まで
+			const auto pending = pushedCount - writtenCount;
+			maxPendingCount = std::max<std::size_t>(maxPendingCount, pending);
+		}
+		output.Flush();
+		ASSERT_EQ(6u, writtenCount);
+	}
+	ASSERT_LE(maxPendingCount, OpenMps::AsyncOutput<>::BUFFER_COUNT);
+}
+
+// 書き出しで発生した例外が、計算側に伝わるか？
+TEST(AsyncOutputTest, RethrowError)
+{
+	OpenMps::AsyncOutput<> output([](const std::vector<Particle>&, const std::size_t count, const double)
+	{
+		if(count == 1)
+		{
+			throw std::runtime_error("write error");
+		}
+	});
+
+	const auto particles = CreateParticles(3);
+	const auto getParticle = [&particles](const std::size_t i) -> decltype(auto)
+	{
+		return particles[i];
+	};
+	output.Push(particles.size(), getParticle, 0, 0);
+	output.Push(particles.size(), getParticle, 1, 0);
+	ASSERT_THROW(output.Flush(), std::runtime_error);
+
+	// 伝えた後は続けて使える
+	output.Push(particles.size(), getParticle, 2, 0);
+	output.Flush();
+}
@@ -0,0 +1,302 @@
+﻿#include <gtest/gtest.h>
+#include "../Computer.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+	static const std::string filename = "test_checkpoint.bin";
+
+#ifndef PRESSURE_EXPLICIT
+	static constexpr double eps = 1e-10;
+#endif
+
+	static constexpr double maxDt = 1.0 / 1000;
+	static constexpr double courant = 0.1;
+
+	static constexpr double l0 = 0.01;
+	static constexpr double g = 9.8;
+
+	static constexpr double rho = 998.2;
+	static constexpr double nu = 1.004e-06;
+	static constexpr double r_eByl_0 = 2.4;
+	static constexpr double surfaceRatio = 0.95;
+
+#ifdef PRESSURE_EXPLICIT
+	static constexpr double c = 15.0;
+#endif
+
+	// 壁と床に囲まれた水柱の粒子を作る
+	// @param width 水柱の幅（粒子数）
+	auto CreateParticles(const int width = 8)
+	{
+		using Particle = OpenMps::Particle<2>;
+		std::vector<Particle> particles;
+		for(auto i = -3; i < 23; i++)
+		{
+			for(auto j = -3; j < 15; j++)
+			{
+				const auto isWall = (i < 0) || (i >= 20) || (j < 0);
+				const auto isDummy = (i < -2) || (i >= 22) || (j < -2);
+				if(!isWall && (i >= width))
+				{
+					continue;
+				}
+
+				Particle particle(isDummy ? Particle::Type::Dummy : (isWall ? Particle::Type::Wall : Particle::Type::IncompressibleNewton));
+				particle.X() = OpenMps::CreateVector(i * l0, j * l0);
+				particles.push_back(std::move(particle));
+			}
+		}
+		return particles;
+	}
+
+	// 時間を進めた後の状態が一致するか確かめる
+	template<typename COMPUTER>
+	void AssertSameParticles(const COMPUTER& expected, const COMPUTER& actual)
+	{
+		ASSERT_EQ(expected.GetEnvironment().T(), actual.GetEnvironment().T());
+		ASSERT_EQ(expected.GetEnvironment().Dt(), actual.GetEnvironment().Dt());
+		ASSERT_EQ(expected.SearchCount(), actual.SearchCount());
+
+		const auto n = expected.Particles().size();
+		ASSERT_EQ(n, actual.Particles().size());
+		for(auto id = decltype(n){0}; id < n; id++)
+		{
+			const auto e = expected.OriginalParticle(id);
+			const auto a = actual.OriginalParticle(id);
+			ASSERT_EQ(e.TYPE(), a.TYPE());
+			for(auto d = std::size_t{0}; d < 2; d++)
+			{
+				ASSERT_EQ(e.X()[d], a.X()[d]);
+				ASSERT_EQ(e.U()[d], a.U()[d]);
+			}
+			ASSERT_EQ(e.P(), a.P());
+			ASSERT_EQ(e.N(), a.N());
+		}
+	}
+
+	// 途中で書き出したチェックポイントから再開した計算が、そのまま続けた計算と一致するか確かめる
+	// ※書き出したことで状態が変わっていないかも、書き出さずに続けた計算と比べて確かめる
+	// @param width 水柱の幅（粒子数）
+	template<typename SCHEME>
+	void TestRestart(const int width = 8)
+	{
+		const auto initial = CreateParticles(width);
+		const auto positionWall = [&initial](const std::size_t i, double, double)
+		{
+			return initial[i].X();
+		};
+		const auto positionWallPre = [](double, double)
+		{
+		};
+		const auto environment = OpenMps::Environment<2>(maxDt, courant,
+			g, rho, nu,
+			surfaceRatio,
+			r_eByl_0,
+#ifdef PRESSURE_EXPLICIT
+			c,
+#endif
+			l0,
+			OpenMps::CreateVector(-10 * l0, -10 * l0),
+			OpenMps::CreateVector(30 * l0, 30 * l0));
+		const auto Create = [&]()
+		{
+			auto computer = OpenMps::CreateComputer<SCHEME>(
+#ifndef PRESSURE_EXPLICIT
+				eps,
+#endif
+				environment,
+				positionWall, positionWallPre);
+			computer.AddParticles(initial);
+			computer.ReorderInterval() = 3;
+			computer.ReuseNeighbor() = true;
+#ifndef PRESSURE_EXPLICIT
+			computer.PpePreconditioner() = OpenMps::Preconditioner::Amg;
+			computer.AmgSetupInterval() = 4;
+			computer.PpeInitialGuess() = OpenMps::InitialGuess::Quadratic;
+#endif
+			return computer;
+		};
+
+		auto uninterrupted = Create();
+		for(auto step = 0; step < 14; step++)
+		{
+			uninterrupted.ForwardTime();
+		}
+
+		auto original = Create();
+		for(auto step = 0; step < 7; step++)
+		{
+			original.ForwardTime();
+		}
+		{
+			OpenMps::CheckpointWriter writer(filename, 2);
+			original.SaveCheckpoint(writer);
+			writer.WriteValue("step", 7);
+			writer.Commit();
+		}
+		for(auto step = 0; step < 7; step++)
+		{
+			original.ForwardTime();
+		}
+
+		// 初期状態の粒子を追加してから読み込んでも置き換わる
+		auto restarted = Create();
+		{
+			OpenMps::CheckpointReader reader(filename);
+			restarted.LoadCheckpoint(reader);
+			ASSERT_EQ(7, reader.ReadValue<int>("step"));
+		}
+		for(auto step = 0; step < 7; step++)
+		{
+			restarted.ForwardTime();
+		}
+		std::remove(filename.c_str());
+
+		AssertSameParticles(uninterrupted, original);
+		AssertSameParticles(original, restarted);
+	}
+}
+
+// 値と配列を書き出して読み込めるか？
+TEST(CheckpointTest, RoundTrip)
+{
+	const std::vector<double> array = {1.5, -2.25, 1e-300};
+	const std::vector<OpenMps::Vector<3>> vectors = {OpenMps::CreateVector(1, 2, 3), OpenMps::CreateVector(-4, -5, -6)};
+	{
+		OpenMps::CheckpointWriter writer(filename, 3);
+		writer.WriteValue("value", std::size_t{42});
+		writer.WriteArray("array", array);
+		writer.WriteVectors<3>("vectors", vectors);
+		writer.WriteArray("empty", std::vector<int>());
+		writer.Commit();
+	}
+	{
+		OpenMps::CheckpointReader reader(filename);
+		ASSERT_EQ(3u, reader.Dimension());
+		ASSERT_EQ(42u, reader.ReadValue<std::size_t>("value"));
+
+		std::vector<double> loadedArray;
+		reader.ReadArray("array", loadedArray);
+		ASSERT_EQ(array, loadedArray);
+
+		std::vector<OpenMps::Vector<3>> loadedVectors;
+		reader.ReadVectors<3>("vectors", loadedVectors);
+		ASSERT_EQ(vectors.size(), loadedVectors.size());
+		for(auto i = decltype(vectors.size()){0}; i < vectors.size(); i++)
+		{
+			for(auto d = std::size_t{0}; d < 3; d++)
+			{
+				ASSERT_EQ(vectors[i][d], loadedVectors[i][d]);
+			}
+		}
+
+		std::vector<int> empty = {1};
+		reader.ReadArray("empty", empty);
+		ASSERT_TRUE(empty.empty());
+	}
+	std::remove(filename.c_str());
+}
+
+// 名前や型が違う時と、チェックポイントでない時は例外になるか？
+TEST(CheckpointTest, Invalid)
+{
+	{
+		OpenMps::CheckpointWriter writer(filename, 2);
+		writer.WriteValue("value", 1.0);
+		writer.WriteValue("count", std::uint32_t{1});
+		writer.Commit();
+	}
+	{
+		OpenMps::CheckpointReader reader(filename);
+		ASSERT_THROW(reader.ReadValue<double>("other"), std::runtime_error);
+	}
+	{
+		OpenMps::CheckpointReader reader(filename);
+		reader.ReadValue<double>("value");
+		ASSERT_THROW(reader.ReadValue<std::uint64_t>("count"), std::runtime_error);
+	}
+	{
+		OpenMps::CheckpointReader reader(filename);
+		reader.ReadValue<double>("value");
+		reader.ReadValue<std::uint32_t>("count");
+		ASSERT_THROW(reader.ReadValue<double>("value"), std::runtime_error);
+	}
+
+	{
+		std::ofstream output(filename);
+		output << "Type, x, z, u, w, p, n" << "\n";
+	}
+	ASSERT_THROW(OpenMps::CheckpointReader reader(filename), std::runtime_error);
+	std::remove(filename.c_str());
+
+	ASSERT_THROW(OpenMps::CheckpointReader reader(filename), std::runtime_error);
+}
+
+// 標準の計算手法で、再開しても同じ結果になるか？
+TEST(CheckpointTest, RestartDefaultScheme)
+{
+	TestRestart<OpenMps::Scheme<false, false, false, false, false, false>>();
+}
+
+// 粒子毎の値を持つ計算手法でも、再開して同じ結果になるか？
+TEST(CheckpointTest, RestartAllSchemes)
+{
+	TestRestart<OpenMps::Scheme<true, true, true, true, true, true>>();
+}
+
+// 代数的マルチグリッド法の集約を使い回している途中で書き出しても、同じ結果になるか？
+// ※粗いレベルができる粒子数にする
+TEST(CheckpointTest, RestartAmgHierarchy)
+{
+	TestRestart<OpenMps::Scheme<false, false, false, false, false, false>>(20);
+}
+
+// 計算手法の組み合わせが違うチェックポイントは読み込めないか？
+TEST(CheckpointTest, SchemeMismatch)
+{
+	const auto positionWall = [](const std::size_t, double, double)
+	{
+		return OpenMps::VectorZero<2>;
+	};
+	const auto positionWallPre = [](double, double)
+	{
+	};
+	const auto environment = OpenMps::Environment<2>(maxDt, courant,
+		g, rho, nu,
+		surfaceRatio,
+		r_eByl_0,
+#ifdef PRESSURE_EXPLICIT
+		c,
+#endif
+		l0,
+		OpenMps::CreateVector(-10 * l0, -10 * l0),
+		OpenMps::CreateVector(30 * l0, 30 * l0));
+	auto standard = OpenMps::CreateComputer<OpenMps::Scheme<false, false, false, false, false, false>>(
+#ifndef PRESSURE_EXPLICIT
+		eps,
+#endif
+		environment,
+		positionWall, positionWallPre);
+	auto ds = OpenMps::CreateComputer<OpenMps::Scheme<false, false, false, false, true, false>>(
+#ifndef PRESSURE_EXPLICIT
+		eps,
+#endif
+		environment,
+		positionWall, positionWallPre);
+	standard.AddParticles(CreateParticles());
+	{
+		OpenMps::CheckpointWriter writer(filename, 2);
+		standard.SaveCheckpoint(writer);
+		writer.Commit();
+	}
+	{
+		OpenMps::CheckpointReader reader(filename);
+		ASSERT_THROW(ds.LoadCheckpoint(reader), std::runtime_error);
+	}
+	std::remove(filename.c_str());
+}
@@ -3,6 +3,11 @@
 #define TEST_CONJUGATEGRADIENT
 #include "../Computer.hpp"
 
+#ifdef USE_VIENNACL
+#include <viennacl/linalg/prod.hpp>
+#include <viennacl/linalg/norm_2.hpp>
+#endif
+
 namespace {
 #ifndef PRESSURE_EXPLICIT
 	static constexpr double eps = 1e-7;
@@ -18,9 +23,7 @@ namespace {
 	static constexpr double nu = 1.004e-06;
 	static constexpr double r_eByl_0 = 1.5;
 
-#ifndef MPS_SPP
 	static constexpr double surfaceRatio = 0.95;
-#endif
 
 	static constexpr double minX = -l0;
 	static constexpr double minZ = -l0;
@@ -37,13 +40,13 @@ namespace {
 
 	namespace OpenMps
 	{
-		Vector positionWall(std::size_t, double, double)
+		Vector<> positionWall(std::size_t, double, double)
 		{
 
 			return CreateVector(0.0, 0.0);
 		}
 
-		Vector positionWallPre(double, double)
+		Vector<> positionWallPre(double, double)
 		{
 			return CreateVector(0.0, 0.0);
 		}
@@ -55,18 +58,16 @@ namespace {
 
 			virtual void SetUp()
 			{
-				auto&& environment = OpenMps::Environment(dt_step, courant,
+				auto&& environment = OpenMps::Environment<>(dt_step, courant,
 					g, rho, nu,
-#ifndef MPS_SPP
 					surfaceRatio,
-#endif
 					r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 					c,
 #endif
 					l0,
-					minX, minZ,
-					maxX, maxZ
+					OpenMps::CreateVector(minX, minZ),
+					OpenMps::CreateVector(maxX, maxZ)
 				);
 
 				environment.Dt() = dt_step;
@@ -97,13 +98,116 @@ namespace {
 				ppe.A = Ppe::Matrix{n,n};
 				ppe.A = Ppe::Matrix{n,n};
 				ppe.x = Ppe::LongVector(n);
+				ppe.x.clear(); // 初期値は0
 				ppe.b = Ppe::LongVector(n);
 				ppe.cg.r = Ppe::LongVector(n);
 				ppe.cg.p = Ppe::LongVector(n);
 				ppe.cg.Ap = Ppe::LongVector(n);
+				ppe.cg.z = Ppe::LongVector(n);
+				ppe.cg.Az = Ppe::LongVector(n);
+			}
+
+			void SetPreconditioner(const OpenMps::Preconditioner preconditioner)
+			{
+				computer->PpePreconditioner() = preconditioner;
+			}
+
+			void SetConjugateGradientMethod(const OpenMps::ConjugateGradientMethod method)
+			{
+				computer->PpeConjugateGradientMethod() = method;
+			}
+
+			void SetMixedPrecision(const bool mixedPrecision)
+			{
+				computer->PpeMixedPrecision() = mixedPrecision;
+			}
+
+			void SetMaxIteration(const std::size_t maxIteration)
+			{
+				computer->PpeMaxIteration() = maxIteration;
+			}
+
+			const auto& GetTelemetry() const
+			{
+				return computer->telemetry;
+			}
+
+			void SetAmgSetupInterval(const std::size_t interval)
+			{
+				computer->AmgSetupInterval() = interval;
+			}
+
+			auto IterationCount() const
+			{
+				return computer->PpeIterationCount();
+			}
+
+			// 2次元ポアソン方程式 ∇^2 f = 1 （境界でf=0）を5点差分で離散化した係数行列を設定する
+			// ※MPS法の係数行列と同じく対角成分が負
+			void SetPoisson2d(const std::size_t nx)
+			{
+				const auto n = nx * nx;
+				setMatrixDim(n);
+				auto& ppe = getPpe();
+				ppe.A.clear();
+				ppe.x.clear();
+				for (auto j = decltype(nx){0}; j < nx; j++)
+				{
+					for (auto i = decltype(nx){0}; i < nx; i++)
+					{
+						const auto k = i + nx * j;
+						if (j > 0)
+						{
+							ppe.A(k, k - nx) = 1.0;
+						}
+						if (i > 0)
+						{
+							ppe.A(k, k - 1) = 1.0;
+						}
+						ppe.A(k, k) = -4.0;
+						if (i + 1 < nx)
+						{
+							ppe.A(k, k + 1) = 1.0;
+						}
+						if (j + 1 < nx)
+						{
+							ppe.A(k, k + nx) = 1.0;
+						}
+						ppe.b(k) = 1.0;
+					}
+				}
+
+				// 係数行列の作成時と同じく、対角項も取っておく（対角スケーリングで使う）
+				ppe.diagonal.assign(n, -4.0);
+			}
+
+			// 解いた結果の残差の相対値 |b - Ax|/|b|
+			double RelativeResidual()
+			{
+#ifdef USE_VIENNACL
+				namespace op = viennacl::linalg;
+#else
+				namespace op = boost::numeric::ublas;
+#endif
+				auto& ppe = getPpe();
+				using Ppe = typename OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>::Ppe;
+				const Ppe::LongVector Ax = op::prod(ppe.A, ppe.x);
+				const Ppe::LongVector r = ppe.b - Ax;
+				return op::norm_2(r) / op::norm_2(ppe.b);
+			}
+
+			// 解の相対誤差 |x - expected|/|expected|
+			template<typename VECTOR>
+			double RelativeError(const VECTOR& expected)
+			{
 #ifdef USE_VIENNACL
-				ppe.tempA = Ppe::TempMatrix(n, n);
+				namespace op = viennacl::linalg;
+#else
+				namespace op = boost::numeric::ublas;
 #endif
+				using Ppe = typename OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>::Ppe;
+				const Ppe::LongVector diff = getPpe().x - expected;
+				return op::norm_2(diff) / op::norm_2(expected);
 			}
 
 			virtual void TearDown()
@@ -227,7 +331,229 @@ namespace {
 			}
 			ASSERT_NEAR(diff / nx, 0.0, testAccuracy);
 		}
+
+		// 前処理をしても同じ解が得られ、反復回数が前処理なしより増えないか？
+		TEST_F(ConjugateGradientTest, Preconditioners)
+		{
+			constexpr std::size_t nx = 16;
+
+			SetPoisson2d(nx);
+			SolvePressurePoissonEquation();
+			const auto noneCount = IterationCount();
+			const auto expected = getPpe().x;
+
+			for (const auto preconditioner : {OpenMps::Preconditioner::Jacobi, OpenMps::Preconditioner::IncompleteCholesky, OpenMps::Preconditioner::Ssor, OpenMps::Preconditioner::Amg})
+			{
+				SetPreconditioner(preconditioner);
+				SetPoisson2d(nx);
+
+				const auto before = IterationCount();
+				SolvePressurePoissonEquation();
+				const auto count = IterationCount() - before;
+
+				ASSERT_NEAR(RelativeResidual(), 0.0, testAccuracy) << static_cast<int>(preconditioner);
+				ASSERT_NEAR(RelativeError(expected), 0.0, testAccuracy) << static_cast<int>(preconditioner);
+				ASSERT_LE(count, noneCount) << static_cast<int>(preconditioner);
+			}
+		}
+
+		// 不完全コレスキー分解とSSORは反復回数を大きく減らすか？
+		TEST_F(ConjugateGradientTest, PreconditionerReducesIterations)
+		{
+			constexpr std::size_t nx = 32;
+
+			SetPoisson2d(nx);
+			SolvePressurePoissonEquation();
+			const auto noneCount = IterationCount();
+
+			for (const auto preconditioner : {OpenMps::Preconditioner::IncompleteCholesky, OpenMps::Preconditioner::Ssor})
+			{
+				SetPreconditioner(preconditioner);
+				SetPoisson2d(nx);
+
+				const auto before = IterationCount();
+				SolvePressurePoissonEquation();
+				const auto count = IterationCount() - before;
+
+				ASSERT_LT(count * 3, noneCount * 2) << static_cast<int>(preconditioner);
+			}
+		}
+
+		// Chronopoulos-Gear法でも、前処理の有無に依らず通常の共役勾配法と同じ解と反復回数が得られるか？
+		TEST_F(ConjugateGradientTest, ChronopoulosGear)
+		{
+			constexpr std::size_t nx = 24;
+
+			for (const auto preconditioner : {OpenMps::Preconditioner::None, OpenMps::Preconditioner::Jacobi, OpenMps::Preconditioner::IncompleteCholesky, OpenMps::Preconditioner::Amg})
+			{
+				SetPreconditioner(preconditioner);
+
+				SetConjugateGradientMethod(OpenMps::ConjugateGradientMethod::Standard);
+				SetPoisson2d(nx);
+				auto before = IterationCount();
+				SolvePressurePoissonEquation();
+				const auto standardCount = IterationCount() - before;
+				const auto expected = getPpe().x;
+
+				SetConjugateGradientMethod(OpenMps::ConjugateGradientMethod::ChronopoulosGear);
+				SetPoisson2d(nx);
+				before = IterationCount();
+				SolvePressurePoissonEquation();
+				const auto count = IterationCount() - before;
+
+				ASSERT_NEAR(RelativeResidual(), 0.0, testAccuracy) << static_cast<int>(preconditioner);
+				ASSERT_NEAR(RelativeError(expected), 0.0, testAccuracy) << static_cast<int>(preconditioner);
+				// 丸め誤差の分だけずれることはある
+				ASSERT_LE(count, standardCount + 1) << static_cast<int>(preconditioner);
+				ASSERT_GE(count + 1, standardCount) << static_cast<int>(preconditioner);
+			}
+		}
+
+		// 単精度で解いて反復改良しても、前処理の有無に依らず倍精度と同じ精度の解が得られるか？
+		TEST_F(ConjugateGradientTest, MixedPrecision)
+		{
+			constexpr std::size_t nx = 32;
+
+			for (const auto preconditioner : {OpenMps::Preconditioner::None, OpenMps::Preconditioner::Jacobi, OpenMps::Preconditioner::IncompleteCholesky, OpenMps::Preconditioner::Amg})
+			{
+				SetPreconditioner(preconditioner);
+
+				SetMixedPrecision(false);
+				SetPoisson2d(nx);
+				SolvePressurePoissonEquation();
+				const auto expected = getPpe().x;
+
+				SetMixedPrecision(true);
+				SetPoisson2d(nx);
+				SolvePressurePoissonEquation();
+
+				// 収束判定は倍精度の残差で行うので、単精度の丸め誤差程度の収束判定誤差でも満たせる
+				ASSERT_LT(RelativeResidual(), eps) << static_cast<int>(preconditioner);
+				ASSERT_NEAR(RelativeError(expected), 0.0, testAccuracy) << static_cast<int>(preconditioner);
+			}
+		}
+
+		// 反復回数と初期残差・最終残差が記録されるか？
+		TEST_F(ConjugateGradientTest, Telemetry)
+		{
+			constexpr std::size_t nx = 16;
+
+			SetPoisson2d(nx);
+			const auto before = IterationCount();
+			SolvePressurePoissonEquation();
+
+			const auto& telemetry = GetTelemetry();
+			ASSERT_EQ(telemetry.iterationCount, IterationCount() - before);
+
+			// 初期値は0なので、初期残差は右辺の大きさ
+			ASSERT_NEAR(telemetry.initialResidual, static_cast<double>(nx), 1e-12);
+			ASSERT_LT(telemetry.finalResidual, telemetry.initialResidual * eps);
+		}
+
+		// 収束判定の基準を右辺にすると、良い初期値ほど反復が減るか？
+		TEST_F(ConjugateGradientTest, ResidualReference)
+		{
+			constexpr std::size_t nx = 16;
+
+			SetPoisson2d(nx);
+			SolvePressurePoissonEquation();
+			const auto expected = getPpe().x;
+
+			std::vector<std::size_t> counts;
+			for (const auto reference : {OpenMps::ResidualReference::Initial, OpenMps::ResidualReference::RightHandSide})
+			{
+				// 解の近くから始める
+				getPpe().residualReference = reference;
+				SetPoisson2d(nx);
+				getPpe().x = expected * (1.0 + 1e-4);
+
+				const auto before = IterationCount();
+				SolvePressurePoissonEquation();
+				counts.push_back(IterationCount() - before);
+				ASSERT_NEAR(RelativeError(expected), 0.0, testAccuracy) << static_cast<int>(reference);
+			}
+
+			// 初期残差を基準にすると、初期値が良くても同じ割合だけ残差を減らすまで反復する
+			ASSERT_LT(counts[1], counts[0]);
+		}
+
+		// 最大反復回数で収束しなければ例外になるか？
+		TEST_F(ConjugateGradientTest, MaxIteration)
+		{
+			constexpr std::size_t nx = 16;
+			constexpr std::size_t maxIteration = 3;
+
+			SetMaxIteration(maxIteration);
+			for (const auto method : {OpenMps::ConjugateGradientMethod::Standard, OpenMps::ConjugateGradientMethod::ChronopoulosGear})
+			{
+				SetConjugateGradientMethod(method);
+				SetPoisson2d(nx);
+
+				const auto before = IterationCount();
+				using Exception = OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>::Exception;
+				ASSERT_THROW(SolvePressurePoissonEquation(), Exception) << static_cast<int>(method);
+				ASSERT_EQ(IterationCount() - before, maxIteration) << static_cast<int>(method);
+				ASSERT_EQ(GetTelemetry().iterationCount, maxIteration) << static_cast<int>(method);
+				ASSERT_GT(GetTelemetry().finalResidual, GetTelemetry().initialResidual * eps) << static_cast<int>(method);
+			}
+
+			// 上限を外せば解ける
+			SetMaxIteration(0);
+			SetPoisson2d(nx);
+			SolvePressurePoissonEquation();
+			ASSERT_NEAR(RelativeResidual(), 0.0, testAccuracy);
+		}
+
+		// 代数的マルチグリッド法の反復回数は解像度にほとんど依らないか？
+		TEST_F(ConjugateGradientTest, AmgIterationsIndependentOfResolution)
+		{
+			SetPreconditioner(OpenMps::Preconditioner::Amg);
+
+			std::vector<std::size_t> counts;
+			for (const std::size_t nx : {24, 48, 96})
+			{
+				SetPoisson2d(nx);
+
+				const auto before = IterationCount();
+				SolvePressurePoissonEquation();
+				counts.push_back(IterationCount() - before);
+
+				ASSERT_NEAR(RelativeResidual(), 0.0, testAccuracy) << nx;
+			}
+
+			// 未知数が16倍になっても、反復回数は2倍未満
+			ASSERT_LT(counts.back(), counts.front() * 2);
+		}
+
+		// 階層を使い回しても、作り直した時と同じ解が得られるか？
+		TEST_F(ConjugateGradientTest, AmgSetupReuse)
+		{
+			constexpr std::size_t nx = 48;
+
+			SetPreconditioner(OpenMps::Preconditioner::Amg);
+			SetAmgSetupInterval(3);
+
+			SetPoisson2d(nx);
+			SolvePressurePoissonEquation();
+			const auto expected = getPpe().x;
+
+			// 係数行列を少しずつ変えながら、使い回して解く
+			for (auto step = 1; step <= 3; step++)
+			{
+				SetPoisson2d(nx);
+				auto& ppe = getPpe();
+				for (auto k = decltype(nx){0}; k < nx * nx; k++)
+				{
+					ppe.A(k, k) = -4.0 - 0.01 * step;
+				}
+				SolvePressurePoissonEquation();
+				ASSERT_NEAR(RelativeResidual(), 0.0, testAccuracy) << step;
+			}
+
+			SetPoisson2d(nx);
+			SolvePressurePoissonEquation();
+			ASSERT_NEAR(RelativeError(expected), 0.0, testAccuracy);
+		}
 	}
 
 }
-
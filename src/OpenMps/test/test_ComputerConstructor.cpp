@@ -17,9 +17,7 @@ namespace {
 	static constexpr double rho = 998.2;
 	static constexpr double nu = 1.004e-06;
 	static constexpr double r_eByl_0 = 2.4;
-#ifndef MPS_SPP
 	static constexpr double surfaceRatio = 0.95;
-#endif
 	static constexpr double minX = -0.004;
 	static constexpr double minZ = -0.004;
 	static constexpr double maxX = 0.053;
@@ -53,18 +51,16 @@ namespace OpenMps
 		// それぞれのテストケースはTEST_Fが呼ばれる直前にSetUpで初期化される
 		virtual void SetUp()
 		{
-			auto&& environment = OpenMps::Environment(dt_step, courant,
+			auto&& environment = OpenMps::Environment<>(dt_step, courant,
 				g, rho, nu,
-#ifndef MPS_SPP
 				surfaceRatio,
-#endif
 				r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 				c,
 #endif
 				l0,
-				minX, minZ,
-				maxX, maxZ
+				OpenMps::CreateVector(minX, minZ),
+				OpenMps::CreateVector(maxX, maxZ)
 				);
 
 			computer = new OpenMps::Computer<decltype(positionWall)&,decltype(positionWallPre)&>(
@@ -74,14 +70,14 @@ namespace OpenMps
 				environment,
 				positionWall, positionWallPre);
 
-			std::vector<OpenMps::Particle> particles;
+			std::vector<OpenMps::Particle<>> particles;
 
 			// 1辺l0, num_x*num_zの格子状に粒子を配置
 			for (auto j = decltype(num_z){0}; j < num_z; j++)
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					particle.X()[OpenMps::AXIS_X] = i*l0;
 					particle.X()[OpenMps::AXIS_Z] = j*l0;;
 
@@ -124,9 +120,7 @@ namespace OpenMps
 		ASSERT_DOUBLE_EQ( env.Nu, nu );
 
 		// 粒子法パラメータ
-#ifndef MPS_SPP
 		ASSERT_DOUBLE_EQ( env.SurfaceRatio, surfaceRatio );
-#endif
 		ASSERT_DOUBLE_EQ( env.L_0, l0 );
 		ASSERT_DOUBLE_EQ( env.R_e, r_eByl_0*l0 );
 
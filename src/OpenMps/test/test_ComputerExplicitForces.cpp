@@ -20,9 +20,7 @@ namespace {
 	static constexpr double nu = 1.004e-06;
 	static constexpr double r_eByl_0 = 2.1;
 
-#ifndef MPS_SPP
 	static constexpr double surfaceRatio = 0.95;
-#endif
 	// 格子状に配置する際の1辺あたりの粒子数
 	static constexpr std::size_t num_x = 13;
 	static constexpr std::size_t num_z = 13;
@@ -43,13 +41,13 @@ namespace {
 
 	namespace OpenMps
 	{
-		Vector positionWall(std::size_t, double, double)
+		Vector<> positionWall(std::size_t, double, double)
 		{
 
 			return CreateVector(0.0, 0.0);
 		}
 
-		Vector positionWallPre(double, double)
+		Vector<> positionWallPre(double, double)
 		{
 			return CreateVector(0.0, 0.0);
 		}
@@ -61,18 +59,16 @@ namespace {
 
 			virtual void SetUp()
 			{
-				auto&& environment = OpenMps::Environment(dt_step, courant,
+				auto&& environment = OpenMps::Environment<>(dt_step, courant,
 					g, rho, nu,
-#ifndef MPS_SPP
 					surfaceRatio,
-#endif
 					r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 					c,
 #endif
 					l0,
-					minX, minZ,
-					maxX, maxZ
+					OpenMps::CreateVector(minX, minZ),
+					OpenMps::CreateVector(maxX, maxZ)
 				);
 
 				environment.Dt() = dt_step;
@@ -129,14 +125,14 @@ namespace {
 			static constexpr double cz4 = 8.0;
 
 			// 1辺l0, num_x*num_zの格子状に粒子を配置
-			std::vector<OpenMps::Particle> particles0;
+			std::vector<OpenMps::Particle<>> particles0;
 
 			for (auto j = decltype(num_z){0}; j < num_z; j++)
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
 
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					const double x = i * l0;
 					const double z = j * l0;
 					particle.X()[OpenMps::AXIS_X] = x;
@@ -194,12 +190,12 @@ namespace {
 			static constexpr double oz2 = 0.2;
 
 			// 1辺l0, num_x*num_zの格子状に粒子を配置
-			std::vector<OpenMps::Particle> particles0;
+			std::vector<OpenMps::Particle<>> particles0;
 			for (auto j = decltype(num_z){0}; j < num_z; j++)
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					const double x = i * l0;
 					const double z = j * l0;
 					particle.X()[OpenMps::AXIS_X] = x;
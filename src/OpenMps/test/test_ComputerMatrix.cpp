@@ -1,7 +1,6 @@
 ﻿#include <gtest/gtest.h>
 #include "../Computer.hpp"
 
-#ifdef MPS_GC
 namespace {
 	double dist_matrix(const double* M1, const double* M2){
 		double d = 0.0;
@@ -64,9 +63,3 @@ TEST(MatrixTest, InvertMatrixAsym){
 	const double M2[] = { invM(0,0), invM(0,1), invM(1,0), invM(1,1) };
 	ASSERT_DOUBLE_EQ( dist_matrix(M1,M2), 0.0 );
 }
-#else
-// MPS_GCが未定義の場合には行列演算が定義されない
-// その場合にTESTが1つもないとエラーとなるため、ダミーのテストケースを用意する
-TEST(MatrixTest, Dummy){
-}
-#endif
@@ -17,9 +17,7 @@ namespace {
 	static constexpr double rho = 998.2;
 	static constexpr double nu = 1.004e-06;
 	static constexpr double r_eByl_0 = 5.0;
-#ifndef MPS_SPP
 	static constexpr double surfaceRatio = 0.95;
-#endif
 	static constexpr double minX = -50.0 * l0;
 	static constexpr double minZ = -50.0 * l0;
 	static constexpr double maxX = 50.0 * l0;
@@ -53,18 +51,16 @@ namespace {
 
 			virtual void SetUp()
 			{
-				auto&& environment = OpenMps::Environment(dt_step, courant,
+				auto&& environment = OpenMps::Environment<>(dt_step, courant,
 					g, rho, nu,
-#ifndef MPS_SPP
 					surfaceRatio,
-#endif
 					r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 					c,
 #endif
 					l0,
-					minX, minZ,
-					maxX, maxZ
+					OpenMps::CreateVector(minX, minZ),
+					OpenMps::CreateVector(maxX, maxZ)
 				);
 
 				environment.Dt() = dt_step;
@@ -113,7 +109,7 @@ namespace {
 		// (u,v) = (gradx x, gradz z) で発散が (gradx + gradz) である速度場を与える
 		TEST_F(NeighborDensityVariationTest, ValueTestLinear)
 		{
-			std::vector<OpenMps::Particle> particles;
+			std::vector<OpenMps::Particle<>> particles;
 
 			static constexpr auto gradvx = 1.0;
 			static constexpr auto gradvz = -0.3;
@@ -125,7 +121,7 @@ namespace {
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					const auto xij = static_cast<double>(i)* l0;
 					const auto zij = static_cast<double>(j)* l0;
 					particle.X()[OpenMps::AXIS_X] = xij;
@@ -165,7 +161,7 @@ namespace {
 		// (u,v) = (1/2 gradx x^2,1/3 gradz z^3) で、発散が (gradx x + gradz z^3) である速度場を与える
 		TEST_F(NeighborDensityVariationTest, ValueTestPolynomial)
 		{
-			std::vector<OpenMps::Particle> particles;
+			std::vector<OpenMps::Particle<>> particles;
 
 			static constexpr auto gradvx = 1.0;
 			static constexpr auto gradvz = -1.5;
@@ -176,7 +172,7 @@ namespace {
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					const auto xij = static_cast<double>(i)* l0;
 					const auto zij = static_cast<double>(j)* l0;
 					particle.X()[OpenMps::AXIS_X] = xij;
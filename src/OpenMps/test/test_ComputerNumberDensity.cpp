@@ -19,9 +19,7 @@ namespace {
 	static constexpr double rho = 998.2;
 	static constexpr double nu = 1.004e-06;
 	static constexpr double r_eByl_0 = 2.1;
-#ifndef MPS_SPP
 	static constexpr double surfaceRatio = 0.95;
-#endif
 	static constexpr double minX = -0.004;
 	static constexpr double minZ = -0.004;
 	static constexpr double maxX = 0.053;
@@ -54,18 +52,16 @@ namespace OpenMps
 
 		virtual void SetUp()
 		{
-			auto&& environment = OpenMps::Environment(dt_step, courant,
+			auto&& environment = OpenMps::Environment<>(dt_step, courant,
 				g, rho, nu,
-#ifndef MPS_SPP
 				surfaceRatio,
-#endif
 				r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 				c,
 #endif
 				l0,
-				minX, minZ,
-				maxX, maxZ
+				OpenMps::CreateVector(minX, minZ),
+				OpenMps::CreateVector(maxX, maxZ)
 			);
 
 
@@ -76,14 +72,14 @@ namespace OpenMps
 					environment,
 					positionWall, positionWallPre);
 
-			std::vector<OpenMps::Particle> particles;
+			std::vector<OpenMps::Particle<>> particles;
 
 			// 1辺l0, num_x*num_zの格子状に粒子を配置
 			for (auto j = decltype(num_z){0}; j < num_z; j++)
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					particle.X()[OpenMps::AXIS_X] = i * l0;
 					particle.X()[OpenMps::AXIS_Z] = j * l0;
 
@@ -103,22 +99,22 @@ namespace OpenMps
 			return computer->particles;
 		}
 
-		double R(const Vector& x1, const Vector& x2)
+		double R(const Vector<>& x1, const Vector<>& x2)
 		{
 			return OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>::R(x1, x2);
 		}
 
-		double R(const Particle& p1, const Particle& p2)
+		double R(const Particle<>& p1, const Particle<>& p2)
 		{
 			return OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>::R(p1, p2);
 		}
 
-		auto& Neighbor(const std::size_t i, const std::size_t idx)
+		auto Neighbor(const std::size_t i, const std::size_t idx)
 		{
 			return computer->Neighbor(i, idx);
 		}
 
-		auto& NeighborCount(const std::size_t i)
+		auto NeighborCount(const std::size_t i)
 		{
 			return computer->NeighborCount(i);
 		}
@@ -128,6 +124,16 @@ namespace OpenMps
 			computer->SearchNeighbor();
 		}
 
+		bool NeedsSearchNeighbor()
+		{
+			return computer->NeedsSearchNeighbor();
+		}
+
+		bool& ReuseNeighbor()
+		{
+			return computer->ReuseNeighbor();
+		}
+
 		void ComputeNeighborDensities()
 		{
 			computer->ComputeNeighborDensities();
@@ -141,8 +147,8 @@ namespace OpenMps
 
 	TEST_F(NumberDensityTest, DistanceValue)
 	{
-		auto p1 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
-		auto p2 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+		auto p1 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
+		auto p2 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 
 		p1.X()[OpenMps::AXIS_X] = 0.0;
 		p1.X()[OpenMps::AXIS_Z] = 0.0;
@@ -156,8 +162,8 @@ namespace OpenMps
 	// 点入れ替えについて対称か？
 	TEST_F(NumberDensityTest, DistanceSymmetry)
 	{
-		auto p1 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
-		auto p2 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+		auto p1 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
+		auto p2 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 
 		p1.X()[OpenMps::AXIS_X] = -10.0;
 		p1.X()[OpenMps::AXIS_Z] = 0.1;
@@ -172,8 +178,8 @@ namespace OpenMps
 	// Vector, Particleの距離計算が一致するか？
 	TEST_F(NumberDensityTest, DistanceOverload)
 	{
-		auto p1 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
-		auto p2 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+		auto p1 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
+		auto p2 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 
 		p1.X()[OpenMps::AXIS_X] = -10.0;
 		p1.X()[OpenMps::AXIS_Z] = 0.1;
@@ -186,9 +192,9 @@ namespace OpenMps
 
 	TEST_F(NumberDensityTest, DistanceTriangleInequality)
 	{
-		auto p1 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
-		auto p2 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
-		auto p3 = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+		auto p1 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
+		auto p2 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
+		auto p3 = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 
 		p1.X()[OpenMps::AXIS_X] = -10.0;
 		p1.X()[OpenMps::AXIS_Z] = 0.1;
@@ -217,7 +223,7 @@ namespace OpenMps
 		// j: i番目粒子の近傍粒子を走査
 		for(auto i = decltype(n){0}; i < n; i++)
 		{
-			if(particles[i].TYPE() != Particle::Type::Disabled)
+			if(particles[i].TYPE() != Particle<>::Type::Disabled)
 			{
 				for(auto idx = decltype(i){0}; idx < NeighborCount(i); idx++)
 				{
@@ -227,7 +233,7 @@ namespace OpenMps
 					bool j_has_i = false;
 					for (auto idxj = decltype(i){0}; idxj < NeighborCount(j); idxj++)
 					{
-						j_has_i |= (particles[j].TYPE() != Particle::Type::Disabled && Neighbor(j, idxj) == i);
+						j_has_i |= (particles[j].TYPE() != Particle<>::Type::Disabled && Neighbor(j, idxj) == i);
 					}
 
 					ASSERT_TRUE(j_has_i);
@@ -246,7 +252,7 @@ namespace OpenMps
 
 		for(auto i = decltype(n){0}; i < n; i++)
 		{
-			if(particles[i].TYPE() != Particle::Type::Disabled)
+			if(particles[i].TYPE() != Particle<>::Type::Disabled)
 			{
 				bool has_myself = false;
 				for(auto idx = decltype(i){0}; idx < NeighborCount(i); idx++)
@@ -259,6 +265,32 @@ namespace OpenMps
 
 	}
 
+	// 近傍粒子リストを使い回さない時は毎回探索するか？
+	TEST_F(NumberDensityTest, NeighborSearchEveryStep)
+	{
+		SearchNeighbor();
+		ASSERT_TRUE(NeedsSearchNeighbor());
+	}
+
+	// 近傍粒子リストを使い回す時は、近傍粒子半径の余裕を超えそうな時だけ探索するか？
+	TEST_F(NumberDensityTest, NeighborSearchReuse)
+	{
+		ReuseNeighbor() = true;
+		SearchNeighbor();
+		ASSERT_FALSE(NeedsSearchNeighbor());
+
+		// 余裕：r_e*2*クーラン数 = 0.042、1ステップの最大移動距離：0.01
+		auto& particles = GetParticles();
+		particles[0].X()[OpenMps::AXIS_X] += 0.001;
+		ASSERT_FALSE(NeedsSearchNeighbor());
+
+		particles[0].X()[OpenMps::AXIS_X] += 0.02;
+		ASSERT_TRUE(NeedsSearchNeighbor());
+
+		SearchNeighbor();
+		ASSERT_FALSE(NeedsSearchNeighbor());
+	}
+
 	// 粒子数密度は理論値と一致するか？
 	TEST_F(NumberDensityTest, NeighDensity)
 	{
@@ -20,9 +20,7 @@ namespace {
 	static constexpr double rho = 998.2;
 	static constexpr double nu = 1.004e-06;
 	static constexpr double r_eByl_0 = 1.5;
-#ifndef MPS_SPP
 	static constexpr double surfaceRatio = 0.95;
-#endif
 	static constexpr double minX = -50.0 * l0;
 	static constexpr double minZ = -50.0 * l0;
 	static constexpr double maxX = 50.0 * l0;
@@ -56,18 +54,16 @@ namespace {
 
 			virtual void SetUp()
 			{
-				auto&& environment = OpenMps::Environment(dt_step, courant,
+				auto&& environment = OpenMps::Environment<>(dt_step, courant,
 					g, rho, nu,
-#ifndef MPS_SPP
 					surfaceRatio,
-#endif
 					r_eByl_0,
 #ifdef PRESSURE_EXPLICIT
 					c,
 #endif
 					l0,
-					minX, minZ,
-					maxX, maxZ
+					OpenMps::CreateVector(minX, minZ),
+					OpenMps::CreateVector(maxX, maxZ)
 				);
 
 				environment.Dt() = dt_step;
@@ -116,7 +112,7 @@ namespace {
 		// p(x,z) = a x^2 + b z^3 
 		TEST_F(PressureGradientTest, GradValuePolynomial)
 		{
-			std::vector<OpenMps::Particle> particles;
+			std::vector<OpenMps::Particle<>> particles;
 
 			// dlは分布関数の空間変化スケール
 			// 最小長さである粒子相互作用半径の数倍に設定
@@ -129,7 +125,7 @@ namespace {
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					const auto xij = static_cast<double>(i) * l0;
 					const auto zij = static_cast<double>(j) * l0;
 					particle.X()[OpenMps::AXIS_X] = xij;
@@ -187,7 +183,7 @@ namespace {
 		// p(x,z) = a cos(kx) + b sin(kz)
 		TEST_F(PressureGradientTest, GradValueTrignometric)
 		{
-			std::vector<OpenMps::Particle> particles;
+			std::vector<OpenMps::Particle<>> particles;
 
 			constexpr auto PI = boost::math::constants::pi<double>();
 
@@ -199,7 +195,7 @@ namespace {
 			{
 				for (auto i = decltype(num_x){0}; i < num_x; i++)
 				{
-					auto particle = OpenMps::Particle(OpenMps::Particle::Type::IncompressibleNewton);
+					auto particle = OpenMps::Particle<>(OpenMps::Particle<>::Type::IncompressibleNewton);
 					const auto xij = static_cast<double>(i) * l0;
 					const auto zij = static_cast<double>(j) * l0;
 					particle.X()[OpenMps::AXIS_X] = xij;
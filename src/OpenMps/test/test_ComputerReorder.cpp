@@ -0,0 +1,176 @@
+﻿#include <gtest/gtest.h>
+
+#define TEST_REORDER
+#include "../Computer.hpp"
+
+namespace {
+#ifndef PRESSURE_EXPLICIT
+	static constexpr double eps = 1e-10;
+#endif
+
+	static constexpr double dt_step = 1.0 / 100;
+	static constexpr double courant = 0.1;
+
+	static constexpr double l0 = 1.0;
+	static constexpr double g = 0.0;
+
+	static constexpr double rho = 998.2;
+	static constexpr double nu = 1.004e-06;
+	static constexpr double r_eByl_0 = 2.4;
+	static constexpr double surfaceRatio = 0.95;
+	static constexpr double minX = -5.0 * l0;
+	static constexpr double minZ = -5.0 * l0;
+	static constexpr double maxX = 25.0 * l0;
+	static constexpr double maxZ = 25.0 * l0;
+
+#ifdef PRESSURE_EXPLICIT
+	static constexpr double c = 1.0;
+#endif
+
+	static constexpr std::size_t num_x = 20;
+	static constexpr std::size_t num_z = 20;
+
+	namespace OpenMps
+	{
+		OpenMps::Vector<> positionWall(std::size_t, double, double)
+		{
+			return OpenMps::VectorZero<>;
+		}
+
+		void positionWallPre(double, double)
+		{
+		}
+
+		class ReorderTest : public ::testing::Test
+		{
+		protected:
+			OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>* computer;
+
+			// 並べ替え前の粒子の位置（元の粒子番号順）
+			std::vector<OpenMps::Vector<>> x;
+
+			virtual void SetUp()
+			{
+				auto&& environment = OpenMps::Environment<>(dt_step, courant,
+					g, rho, nu,
+					surfaceRatio,
+					r_eByl_0,
+#ifdef PRESSURE_EXPLICIT
+					c,
+#endif
+					l0,
+					OpenMps::CreateVector(minX, minZ),
+					OpenMps::CreateVector(maxX, maxZ)
+				);
+
+				environment.Dt() = dt_step;
+				environment.SetNextT();
+
+				computer = new OpenMps::Computer<decltype(positionWall)&, decltype(positionWallPre)&>(
+#ifndef PRESSURE_EXPLICIT
+					eps,
+#endif
+					environment,
+					positionWall, positionWallPre);
+
+				// 格子上の粒子を、空間的に飛び飛びになる順番で追加する
+				constexpr std::size_t n = num_x * num_z;
+				constexpr std::size_t stride = 37; // nと互いに素
+				std::vector<OpenMps::Particle<>> particles;
+				for (auto idx = decltype(n){0}; idx < n; idx++)
+				{
+					const auto k = (idx * stride) % n;
+					const auto i = k / num_z;
+					const auto j = k % num_z;
+
+					OpenMps::Particle<> particle(OpenMps::Particle<>::Type::IncompressibleNewton);
+					particle.X() = OpenMps::CreateVector(i*l0, j*l0);
+					particle.U() = OpenMps::CreateVector(static_cast<double>(idx), 0);
+					x.push_back(particle.X());
+					particles.push_back(std::move(particle));
+				}
+				computer->AddParticles(std::move(particles));
+			}
+
+			virtual void TearDown()
+			{
+				delete computer;
+			}
+
+			auto& GetParticles()
+			{
+				return computer->Particles();
+			}
+
+			void ReorderParticles()
+			{
+				computer->ReorderParticles();
+			}
+
+			void SearchNeighbor()
+			{
+				computer->SearchNeighbor();
+			}
+
+			void ComputeNeighborDensities()
+			{
+				computer->ComputeNeighborDensities();
+			}
+
+			auto MortonCode(const OpenMps::Vector<>& pos)
+			{
+				return computer->grid.MortonCode(pos);
+			}
+		};
+
+		// 並べ替え後も元の粒子番号で同じ粒子を取得できるか？
+		TEST_F(ReorderTest, OriginalParticle)
+		{
+			ReorderParticles();
+
+			const auto n = x.size();
+			for (auto id = decltype(n){0}; id < n; id++)
+			{
+				const auto& particle = computer->OriginalParticle(id);
+				ASSERT_DOUBLE_EQ(particle.X()[OpenMps::AXIS_X], x[id][OpenMps::AXIS_X]);
+				ASSERT_DOUBLE_EQ(particle.X()[OpenMps::AXIS_Z], x[id][OpenMps::AXIS_Z]);
+				ASSERT_DOUBLE_EQ(particle.U()[OpenMps::AXIS_X], static_cast<double>(id));
+			}
+		}
+
+		// モートン符号順に並んでいるか？
+		TEST_F(ReorderTest, SortedByMortonCode)
+		{
+			ReorderParticles();
+
+			const auto& particles = GetParticles();
+			const auto n = particles.size();
+			for (auto i = decltype(n){1}; i < n; i++)
+			{
+				ASSERT_LE(MortonCode(particles[i - 1].X()), MortonCode(particles[i].X()));
+			}
+		}
+
+		// 並べ替えても粒子数密度が変わらないか？
+		TEST_F(ReorderTest, SameNeighborDensity)
+		{
+			const auto n = x.size();
+
+			SearchNeighbor();
+			ComputeNeighborDensities();
+			std::vector<double> expected(n);
+			for (auto id = decltype(n){0}; id < n; id++)
+			{
+				expected[id] = computer->OriginalParticle(id).N();
+			}
+
+			ReorderParticles();
+			SearchNeighbor();
+			ComputeNeighborDensities();
+			for (auto id = decltype(n){0}; id < n; id++)
+			{
+				ASSERT_NEAR(computer->OriginalParticle(id).N(), expected[id], 1e-12);
+			}
+		}
+	}
+}
@@ -0,0 +1,133 @@
+﻿#include <gtest/gtest.h>
+#include "../Grid.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace {
+	static constexpr double neighborLength = 0.1;
+
+	static constexpr double minX = 0.0;
+	static constexpr double minZ = 0.0;
+	static constexpr double maxX = 1.0;
+	static constexpr double maxZ = 1.0;
+
+	// 近傍探索で得られた粒子番号を昇順に並べて取得する
+	auto GetNeighbors(const OpenMps::Grid<>& grid, const OpenMps::Vector<>& x)
+	{
+		std::vector<OpenMps::Grid<>::ParticleID> ids;
+		const auto end = grid.cend();
+		for (auto it = grid.cbegin(x); !(it == end); ++it)
+		{
+			ids.push_back(*it);
+		}
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+}
+
+// 1ブロックに大量の粒子が集中しても格納できるか？
+TEST(GridTest, StoreManyParticlesInBlock)
+{
+	auto grid = OpenMps::Grid<>(neighborLength, OpenMps::CreateVector(minX, minZ), OpenMps::CreateVector(maxX, maxZ));
+
+	constexpr std::size_t n = 1000;
+	std::vector<OpenMps::Vector<>> x(n, OpenMps::CreateVector(0.55, 0.55));
+	grid.Store(n,
+		[&x](const auto i) -> const OpenMps::Vector<>&
+		{
+			return x[i];
+		},
+		[](const auto)
+		{
+			return true;
+		});
+
+	ASSERT_EQ(grid.MaxParticles(), n);
+
+	const auto ids = GetNeighbors(grid, x[0]);
+	ASSERT_EQ(ids.size(), n);
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		ASSERT_EQ(ids[i], i);
+	}
+}
+
+// 周囲のブロックの粒子だけが探索されるか？
+TEST(GridTest, NeighborBlocks)
+{
+	auto grid = OpenMps::Grid<>(neighborLength, OpenMps::CreateVector(minX, minZ), OpenMps::CreateVector(maxX, maxZ));
+
+	// 各ブロックの中心に1粒子ずつ配置
+	constexpr std::size_t num = 10;
+	std::vector<OpenMps::Vector<>> x;
+	for (auto i = decltype(num){0}; i < num; i++)
+	{
+		for (auto k = decltype(num){0}; k < num; k++)
+		{
+			x.push_back(OpenMps::CreateVector((i + 0.5)*neighborLength, (k + 0.5)*neighborLength));
+		}
+	}
+	const auto n = x.size();
+	grid.Store(n,
+		[&x](const auto i) -> const OpenMps::Vector<>&
+		{
+			return x[i];
+		},
+		[](const auto)
+		{
+			return true;
+		});
+
+	for (auto i = decltype(num){0}; i < num; i++)
+	{
+		for (auto k = decltype(num){0}; k < num; k++)
+		{
+			std::vector<OpenMps::Grid<>::ParticleID> expected;
+			for (auto ii = decltype(num){0}; ii < num; ii++)
+			{
+				for (auto kk = decltype(num){0}; kk < num; kk++)
+				{
+					if ((std::max(i, ii) - std::min(i, ii) <= 1) && (std::max(k, kk) - std::min(k, kk) <= 1))
+					{
+						expected.push_back(ii*num + kk);
+					}
+				}
+			}
+
+			ASSERT_EQ(GetNeighbors(grid, x[i*num + k]), expected);
+		}
+	}
+}
+
+// 対象外の粒子と領域外の粒子は格納されないか？
+TEST(GridTest, NotStored)
+{
+	auto grid = OpenMps::Grid<>(neighborLength, OpenMps::CreateVector(minX, minZ), OpenMps::CreateVector(maxX, maxZ));
+
+	std::vector<OpenMps::Vector<>> x{
+		OpenMps::CreateVector(0.5, 0.5),
+		OpenMps::CreateVector(0.51, 0.5),
+		OpenMps::CreateVector(-1.0, 0.5),
+		OpenMps::CreateVector(0.5, 10.0),
+	};
+	const auto n = x.size();
+	grid.Store(n,
+		[&x](const auto i) -> const OpenMps::Vector<>&
+		{
+			return x[i];
+		},
+		[](const auto i)
+		{
+			return i != 1;
+		});
+
+	ASSERT_TRUE(grid.IsStored(0));
+	ASSERT_FALSE(grid.IsStored(1));
+	ASSERT_FALSE(grid.IsStored(2));
+	ASSERT_FALSE(grid.IsStored(3));
+
+	const auto ids = GetNeighbors(grid, x[0]);
+	ASSERT_EQ(ids.size(), 1u);
+	ASSERT_EQ(ids[0], 0u);
+}
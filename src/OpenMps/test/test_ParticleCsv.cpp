@@ -0,0 +1,142 @@
+﻿#include <gtest/gtest.h>
+#include "../ParticleCsv.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+namespace {
+	static const std::string filename = "test_particles.csv";
+
+	// 2次元の粒子1つ分の行を作る
+	std::string Line(const int type, const double x, const double z, const double u, const double w, const double p, const double n)
+	{
+		return (boost::format("%1%,%2$.17e,%3$.17e,%4$.17e,%5$.17e,%6$.17e,%7$.17e\n") % type % x % z % u % w % p % n).str();
+	}
+
+	// 粒子の値が全て等しいか確認する
+	void ExpectParticle(const OpenMps::Particle<2>& particle, const int type, const double x, const double z, const double u, const double w, const double p, const double n)
+	{
+		ASSERT_EQ(type, static_cast<int>(particle.TYPE()));
+		ASSERT_EQ(x, particle.X()[0]);
+		ASSERT_EQ(z, particle.X()[1]);
+		ASSERT_EQ(u, particle.U()[0]);
+		ASSERT_EQ(w, particle.U()[1]);
+		ASSERT_EQ(p, particle.P());
+		ASSERT_EQ(n, particle.N());
+	}
+
+	TEST(ParticleCsvTest, Parse)
+	{
+		const std::string csv =
+			"\n"
+			"Type, x, z, u, w, p, n\n"
+			"0, 1.5, -2, 0.25, 0, 1000, 6.5\n"
+			"\t3 ,1e-3,2.5E2,-1,1,0,0\n";
+		const auto particles = OpenMps::ParseParticleCsv<2>(csv);
+
+		ASSERT_EQ(2, particles.size());
+		ExpectParticle(particles[0], 0, 1.5, -2, 0.25, 0, 1000, 6.5);
+		ExpectParticle(particles[1], 3, 1e-3, 2.5e2, -1, 1, 0, 0);
+	}
+
+	TEST(ParticleCsvTest, HeaderOrder)
+	{
+		// 列の順番は自由で、改行がCR+LFでも空行があってもよい
+		const std::string csv =
+			"n,w,p,z,Type,u,x\r\n"
+			"6.5,0.5,100,2,1,0.25,1\r\n"
+			"\r\n"
+			"   \r\n"
+			"7.5,-0.5,200,3,0,-0.25,-1\r\n";
+		const auto particles = OpenMps::ParseParticleCsv<2>(csv);
+
+		ASSERT_EQ(2, particles.size());
+		ExpectParticle(particles[0], 1, 1, 2, 0.25, 0.5, 100, 6.5);
+		ExpectParticle(particles[1], 0, -1, 3, -0.25, -0.5, 200, 7.5);
+	}
+
+	TEST(ParticleCsvTest, Dimension3)
+	{
+		const std::string csv =
+			"Type,x,y,z,u,v,w,p,n\n"
+			"2,1,2,3,4,5,6,7,8";
+		const auto particles = OpenMps::ParseParticleCsv<3>(csv);
+
+		ASSERT_EQ(1, particles.size());
+		ASSERT_EQ(2, static_cast<int>(particles[0].TYPE()));
+		for(auto d = 0; d < 3; d++)
+		{
+			ASSERT_EQ(1 + d, particles[0].X()[d]);
+			ASSERT_EQ(4 + d, particles[0].U()[d]);
+		}
+		ASSERT_EQ(7, particles[0].P());
+		ASSERT_EQ(8, particles[0].N());
+	}
+
+	TEST(ParticleCsvTest, ManyChunks)
+	{
+		// 並列に読み込む範囲をまたぐ大きさにして、順番と値が保たれることを確認する
+		constexpr int count = 40000;
+		std::string csv = "Type,x,z,u,w,p,n\n";
+		for(auto i = 0; i < count; i++)
+		{
+			csv += Line(i % 3, 0.1 * i, -0.3 * i, 1.0 / (i + 1), -1.0 / (i + 7), 1000.0 + i, 6.5 + 1e-7 * i);
+			if(i % 1000 == 0)
+			{
+				csv += "\n";
+			}
+		}
+		ASSERT_LT(OpenMps::Detail::Csv::CHUNK_SIZE, csv.size());
+
+		const auto particles = OpenMps::ParseParticleCsv<2>(csv);
+
+		ASSERT_EQ(count, particles.size());
+		for(auto i = 0; i < count; i++)
+		{
+			ExpectParticle(particles[i], i % 3, 0.1 * i, -0.3 * i, 1.0 / (i + 1), -1.0 / (i + 7), 1000.0 + i, 6.5 + 1e-7 * i);
+		}
+	}
+
+	TEST(ParticleCsvTest, Invalid)
+	{
+		// ヘッダーが無い
+		ASSERT_THROW(OpenMps::ParseParticleCsv<2>("\n\n"), std::runtime_error);
+
+		// 知らない列名
+		ASSERT_THROW(OpenMps::ParseParticleCsv<2>("Type,x,z,u,w,p,n,q\n"), std::runtime_error);
+
+		// 足りない列名
+		ASSERT_THROW(OpenMps::ParseParticleCsv<2>("Type,x,z,u,w,p\n"), std::runtime_error);
+
+		// 数値でない値
+		ASSERT_THROW(OpenMps::ParseParticleCsv<2>("Type,x,z,u,w,p,n\n0,1,a,0,0,0,0\n"), std::runtime_error);
+
+		// 足りない値
+		ASSERT_THROW(OpenMps::ParseParticleCsv<2>("Type,x,z,u,w,p,n\n0,1,2,0,0,0\n"), std::runtime_error);
+		ASSERT_THROW(OpenMps::ParseParticleCsv<2>("Type,x,z,u,w,p,n\n0,1,2,,0,0,0\n"), std::runtime_error);
+	}
+
+	TEST(ParticleCsvTest, ReadFile)
+	{
+		std::string csv = "Type,x,z,u,w,p,n\n";
+		csv += Line(0, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6);
+		csv += Line(2, -0.1, -0.2, -0.3, -0.4, -0.5, -0.6);
+		{
+			std::ofstream output(filename, std::ios::binary);
+			output << csv;
+		}
+
+		const auto particles = OpenMps::ReadParticleCsv<2>(filename);
+		std::remove(filename.c_str());
+
+		ASSERT_EQ(2, particles.size());
+		ExpectParticle(particles[0], 0, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6);
+		ExpectParticle(particles[1], 2, -0.1, -0.2, -0.3, -0.4, -0.5, -0.6);
+
+		ASSERT_THROW(OpenMps::ReadParticleCsv<2>(filename), std::runtime_error);
+	}
+}
@@ -0,0 +1,142 @@
+﻿#include <gtest/gtest.h>
+#include "../Preconditioner.hpp"
+
+namespace {
+	using Matrix = boost::numeric::ublas::compressed_matrix<double>;
+	using LongVector = OpenMps::Detail::Preconditioning::LongVector;
+
+	static constexpr std::size_t n = 20;
+
+	// 許容する誤差
+	static constexpr double testAccuracy = 1e-12;
+
+	// 1次元ポアソン方程式の係数行列（対角成分が負の三重対角行列）
+	// ※三重対角行列なのでIC(0)でもフィルインが無く、分解は厳密になる
+	Matrix CreateTridiagonal()
+	{
+		Matrix A(n, n);
+		for (auto i = decltype(n){0}; i < n; i++)
+		{
+			if (i > 0)
+			{
+				A(i, i - 1) = 1.0;
+			}
+			A(i, i) = -2.0 - 0.1 * i;
+			if (i + 1 < n)
+			{
+				A(i, i + 1) = 1.0;
+			}
+		}
+		return A;
+	}
+
+	LongVector CreateVector()
+	{
+		LongVector x(n);
+		for (auto i = decltype(n){0}; i < n; i++)
+		{
+			x(i) = 1.0 + 0.3 * i - 0.01 * i * i;
+		}
+		return x;
+	}
+}
+
+// 疎行列を行毎に詰め直せているか？
+TEST(PreconditionerTest, CsrAssign)
+{
+	const auto A = CreateTridiagonal();
+	OpenMps::Detail::Preconditioning::Csr csr;
+	csr.Assign(A);
+
+	ASSERT_EQ(csr.Size(), n);
+	ASSERT_EQ(csr.start[n], 3 * n - 2);
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		ASSERT_EQ(csr.Diagonal(i), A(i, i));
+		ASSERT_EQ(csr.diagonal[i] - csr.start[i], (i > 0) ? 1u : 0u);
+	}
+}
+
+// 疎行列の内部配列から複製しても同じになるか？
+TEST(PreconditionerTest, CsrAssignArray)
+{
+	auto A = CreateTridiagonal();
+	OpenMps::Detail::Preconditioning::Csr expected;
+	expected.Assign(A);
+
+	A.complete_index1_data();
+	OpenMps::Detail::Preconditioning::Csr csr;
+	csr.Assign(A.size1(), A.index1_data(), A.index2_data(), A.value_data());
+
+	ASSERT_EQ(csr.start, expected.start);
+	ASSERT_EQ(csr.column, expected.column);
+	ASSERT_EQ(csr.value, expected.value);
+	ASSERT_EQ(csr.diagonal, expected.diagonal);
+}
+
+// 対角スケーリングは対角成分で割るだけか？
+TEST(PreconditionerTest, Jacobi)
+{
+	const auto A = CreateTridiagonal();
+	OpenMps::Detail::Preconditioning::Csr csr;
+	csr.Assign(A);
+
+	OpenMps::Detail::Preconditioning::Jacobi jacobi;
+	jacobi.Compute(csr);
+
+	const auto r = CreateVector();
+	LongVector z;
+	jacobi.Apply(csr, r, z);
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		ASSERT_NEAR(z(i), r(i) / A(i, i), testAccuracy);
+	}
+}
+
+// フィルインが無ければ不完全コレスキー分解は厳密な逆行列になるか？
+TEST(PreconditionerTest, IncompleteCholeskyExact)
+{
+	const auto A = CreateTridiagonal();
+	OpenMps::Detail::Preconditioning::Csr csr;
+	csr.Assign(A);
+
+	OpenMps::Detail::Preconditioning::IncompleteCholesky ic;
+	ic.Compute(csr);
+
+	const auto x = CreateVector();
+	const LongVector r = boost::numeric::ublas::prod(A, x);
+	LongVector z;
+	ic.Apply(csr, r, z);
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		ASSERT_NEAR(z(i), x(i), testAccuracy);
+	}
+}
+
+// 対称SOR法の前処理行列 M = (D+L) D^-1 (D+U) を掛けると元に戻るか？
+TEST(PreconditionerTest, Ssor)
+{
+	const auto A = CreateTridiagonal();
+	OpenMps::Detail::Preconditioning::Csr csr;
+	csr.Assign(A);
+
+	OpenMps::Detail::Preconditioning::Ssor ssor;
+	ssor.Compute(csr);
+
+	const auto r = CreateVector();
+	LongVector z;
+	ssor.Apply(csr, r, z);
+
+	// Mz を計算
+	LongVector upper(n);
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		upper(i) = A(i, i) * z(i) + ((i + 1 < n) ? A(i, i + 1) * z(i + 1) : 0.0);
+	}
+	for (auto i = decltype(n){0}; i < n; i++)
+	{
+		const auto y = upper(i) / A(i, i);
+		const auto mz = A(i, i) * y + ((i > 0) ? A(i, i - 1) * upper(i - 1) / A(i - 1, i - 1) : 0.0);
+		ASSERT_NEAR(mz, r(i), testAccuracy);
+	}
+}
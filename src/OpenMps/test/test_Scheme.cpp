@@ -0,0 +1,205 @@
+﻿#include <gtest/gtest.h>
+#include "../Computer.hpp"
+
+#include <vector>
+#include <type_traits>
+
+namespace {
+#ifndef PRESSURE_EXPLICIT
+	static constexpr double eps = 1e-10;
+#endif
+
+	static constexpr double maxDt = 1.0 / 1000;
+	static constexpr double courant = 0.1;
+
+	static constexpr double l0 = 0.01;
+	static constexpr double g = 9.8;
+
+	static constexpr double rho = 998.2;
+	static constexpr double nu = 1.004e-06;
+	static constexpr double r_eByl_0 = 2.4;
+	static constexpr double surfaceRatio = 0.95;
+
+#ifdef PRESSURE_EXPLICIT
+	static constexpr double c = 15.0;
+#endif
+
+	// 壁と床に囲まれた水柱の粒子を作る
+	auto CreateParticles()
+	{
+		using Particle = OpenMps::Particle<2>;
+		std::vector<Particle> particles;
+		for(auto i = -3; i < 23; i++)
+		{
+			for(auto j = -3; j < 15; j++)
+			{
+				const auto isWall = (i < 0) || (i >= 20) || (j < 0);
+				const auto isDummy = (i < -2) || (i >= 22) || (j < -2);
+				if(!isWall && (i >= 8))
+				{
+					continue;
+				}
+
+				Particle particle(isDummy ? Particle::Type::Dummy : (isWall ? Particle::Type::Wall : Particle::Type::IncompressibleNewton));
+				particle.X() = OpenMps::CreateVector(i * l0, j * l0);
+				particles.push_back(std::move(particle));
+			}
+		}
+		return particles;
+	}
+
+	// 特殊化した組み合わせと実行時に決める組み合わせで、時間を進めた結果が一致するか確かめる
+	template<typename SCHEME>
+	void TestDynamicScheme()
+	{
+		const auto initial = CreateParticles();
+		const auto positionWall = [&initial](const std::size_t i, double, double)
+		{
+			return initial[i].X();
+		};
+		const auto positionWallPre = [](double, double)
+		{
+		};
+		const auto environment = OpenMps::Environment<2>(maxDt, courant,
+			g, rho, nu,
+			surfaceRatio,
+			r_eByl_0,
+#ifdef PRESSURE_EXPLICIT
+			c,
+#endif
+			l0,
+			OpenMps::CreateVector(-10 * l0, -10 * l0),
+			OpenMps::CreateVector(30 * l0, 30 * l0));
+
+		auto expected = OpenMps::CreateComputer<SCHEME>(
+#ifndef PRESSURE_EXPLICIT
+			eps,
+#endif
+			environment,
+			positionWall, positionWallPre);
+		auto actual = OpenMps::CreateComputer<OpenMps::DynamicScheme>(
+#ifndef PRESSURE_EXPLICIT
+			eps,
+#endif
+			environment,
+			positionWall, positionWallPre,
+			OpenMps::DynamicScheme(SCHEME::Selection()));
+		expected.AddParticles(initial);
+		actual.AddParticles(initial);
+		for(auto step = 0; step < 5; step++)
+		{
+			expected.ForwardTime();
+			actual.ForwardTime();
+		}
+
+		ASSERT_EQ(expected.GetEnvironment().T(), actual.GetEnvironment().T());
+		const auto n = expected.Particles().size();
+		ASSERT_EQ(n, actual.Particles().size());
+		for(auto i = decltype(n){0}; i < n; i++)
+		{
+			const auto e = expected.Particles()[i];
+			const auto a = actual.Particles()[i];
+			for(auto d = std::size_t{0}; d < 2; d++)
+			{
+				ASSERT_EQ(e.X()[d], a.X()[d]) << i;
+				ASSERT_EQ(e.U()[d], a.U()[d]) << i;
+			}
+			ASSERT_EQ(e.P(), a.P()) << i;
+			ASSERT_EQ(e.N(), a.N()) << i;
+		}
+	}
+}
+
+// 並べた全ての組み合わせで、その組み合わせの型が選ばれるか？
+TEST(SchemeTest, DispatchListedSchemes)
+{
+	using Scheme = OpenMps::Scheme<true, true, true, true, true, true>;
+
+	bool isCalled = false;
+	OpenMps::DispatchScheme(Scheme::Selection(), [&isCalled](const auto selected)
+	{
+		using Selected = std::decay_t<decltype(selected)>;
+		isCalled = std::is_same<Selected, Scheme>::value;
+	});
+	ASSERT_TRUE(isCalled);
+
+	// 標準MPS法
+	const auto standard = OpenMps::SchemeSelection{false, false, false, false, false, false};
+	OpenMps::DispatchScheme(standard, [](const auto selected)
+	{
+		using Selected = std::decay_t<decltype(selected)>;
+		ASSERT_FALSE((std::is_same<Selected, OpenMps::DynamicScheme>::value));
+		ASSERT_FALSE(selected.Hs);
+		ASSERT_FALSE(selected.Hl);
+		ASSERT_FALSE(selected.Ecs);
+		ASSERT_FALSE(selected.Gc);
+		ASSERT_FALSE(selected.Ds);
+		ASSERT_FALSE(selected.Spp);
+	});
+}
+
+// 既定の組み合わせが選べるか？
+TEST(SchemeTest, DispatchDefaultScheme)
+{
+	bool isCalled = false;
+	OpenMps::DispatchScheme(OpenMps::DefaultScheme::Selection(), [&isCalled](const auto selected)
+	{
+		using Selected = std::decay_t<decltype(selected)>;
+		isCalled = std::is_same<Selected, OpenMps::DefaultScheme>::value;
+	});
+	ASSERT_TRUE(isCalled);
+}
+
+// 並べていない組み合わせは、実行時に決める組み合わせで呼ばれるか？
+TEST(SchemeTest, DispatchDynamicScheme)
+{
+	// 全ての組み合わせで、選んだ通りの手法が使われる
+	for(auto index = 0u; index < 64u; index++)
+	{
+		const auto selection = OpenMps::SchemeSelection{
+			(index & 1) != 0,
+			(index & 2) != 0,
+			(index & 4) != 0,
+			(index & 8) != 0,
+			(index & 16) != 0,
+			(index & 32) != 0};
+#ifdef PRESSURE_EXPLICIT
+		// 陽解法ではECS法は選べない
+		if(selection.Ecs)
+		{
+			continue;
+		}
+#endif
+
+		auto callCount = 0;
+		OpenMps::DispatchScheme(selection, [&callCount, &selection](const auto selected)
+		{
+			const auto actual = selected.Selection();
+			ASSERT_EQ(actual.Hs, selection.Hs);
+			ASSERT_EQ(actual.Hl, selection.Hl);
+			ASSERT_EQ(actual.Ecs, selection.Ecs);
+			ASSERT_EQ(actual.Gc, selection.Gc);
+			ASSERT_EQ(actual.Ds, selection.Ds);
+			ASSERT_EQ(actual.Spp, selection.Spp);
+			callCount++;
+		});
+		ASSERT_EQ(callCount, 1) << index;
+	}
+
+	// HS法のみ
+	const auto selection = OpenMps::SchemeSelection{true, false, false, false, false, false};
+	bool isCalled = false;
+	OpenMps::DispatchScheme(selection, [&isCalled](const auto selected)
+	{
+		using Selected = std::decay_t<decltype(selected)>;
+		isCalled = std::is_same<Selected, OpenMps::DynamicScheme>::value;
+	});
+	ASSERT_TRUE(isCalled);
+}
+
+// 実行時に決める組み合わせでも、特殊化したものと同じ結果になるか？
+TEST(SchemeTest, DynamicSchemeSameResult)
+{
+	TestDynamicScheme<OpenMps::Scheme<false, false, false, false, false, false>>();
+	TestDynamicScheme<OpenMps::Scheme<true, true, true, true, true, true>>();
+}
@@ -0,0 +1,144 @@
+﻿#include <gtest/gtest.h>
+#include "../Simd.hpp"
+
+#include <cmath>
+
+namespace {
+	using Level = OpenMps::Detail::Simd::Level;
+
+	static constexpr double r_e = 0.025;
+
+	// 端数が出るように、SIMD幅の倍数ではない粒子数にする
+	static constexpr std::size_t n = 37;
+
+	// 許容する相対誤差
+	static constexpr double testAccuracy = 1e-12;
+
+	// 影響半径内に散らばった近傍粒子を生成する
+	void CreateBatch(OpenMps::Detail::Simd::Batch<>& batch)
+	{
+		batch.Clear();
+		for(auto k = decltype(n){0}; k < n; k++)
+		{
+			const auto theta = 2.39996 * k;
+			const auto r = r_e * (0.1 + 0.85 * (k + 0.5) / n);
+			const auto dx = OpenMps::CreateVector(r * std::cos(theta),
+#ifdef DIM3
+				r * std::sin(theta) * 0.6, r * std::sin(theta) * 0.8);
+#else
+				r * std::sin(theta));
+#endif
+			batch.Add(dx, r * r);
+			auto u = OpenMps::VectorZero<>;
+			u[OpenMps::AXIS_X] = 1.0 + 0.1 * k;
+			u[OpenMps::AXIS_Z] = -0.2 * k;
+			batch.AddVector(u);
+			batch.AddCoefficient((k % 5 == 0) ? 0.0 : 1000.0 + 10.0 * k);
+		}
+	}
+
+	// 指定した命令セットで計算する
+	template<typename FUNC>
+	auto ComputeWith(const Level level, const FUNC& func)
+	{
+		auto& current = OpenMps::Detail::Simd::CurrentLevel();
+		const auto original = current;
+		current = level;
+		const auto result = func();
+		current = original;
+		return result;
+	}
+
+	// スカラー計算とSIMD計算が一致するか確認する
+	template<typename FUNC>
+	void CompareScalar(const FUNC& func)
+	{
+		const auto expected = ComputeWith(Level::Scalar, func);
+		for(const auto level : {Level::Avx2, Level::Avx512})
+		{
+			if(OpenMps::Detail::Simd::IsSupported(level))
+			{
+				const auto actual = ComputeWith(level, func);
+				ASSERT_NEAR(actual, expected, std::abs(expected) * testAccuracy) << "level " << static_cast<int>(level);
+			}
+		}
+	}
+}
+
+// Σwが命令セットに依らず一致するか？
+TEST(SimdTest, SumWeight)
+{
+	OpenMps::Detail::Simd::Batch<> batch;
+	CreateBatch(batch);
+
+	CompareScalar([&batch]()
+	{
+		return OpenMps::Detail::Simd::SumWeight(batch, r_e);
+	});
+}
+
+// Σw dxが命令セットに依らず一致するか？
+TEST(SimdTest, SumWeightedDx)
+{
+	OpenMps::Detail::Simd::Batch<> batch;
+	CreateBatch(batch);
+
+	for(const auto d : {OpenMps::AXIS_X, OpenMps::AXIS_Z})
+	{
+		CompareScalar([&batch, d]()
+		{
+			return OpenMps::Detail::Simd::SumWeightedDx(batch, r_e)[d];
+		});
+	}
+}
+
+// HL法の粘性項が命令セットに依らず一致するか？
+TEST(SimdTest, SumViscosityHL)
+{
+	OpenMps::Detail::Simd::Batch<> batch;
+	CreateBatch(batch);
+
+	for(const auto d : {OpenMps::AXIS_X, OpenMps::AXIS_Z})
+	{
+		CompareScalar([&batch, d]()
+		{
+			return OpenMps::Detail::Simd::SumViscosityHL(batch)[d];
+		});
+	}
+}
+
+// HS法の粒子数密度の瞬間増加速度が命令セットに依らず一致するか？
+TEST(SimdTest, SumDivergenceHS)
+{
+	OpenMps::Detail::Simd::Batch<> batch;
+	CreateBatch(batch);
+
+	CompareScalar([&batch]()
+	{
+		return OpenMps::Detail::Simd::SumDivergenceHS(batch);
+	});
+}
+
+// 圧力勾配項が命令セットに依らず一致するか？
+TEST(SimdTest, SumPressureGradient)
+{
+	OpenMps::Detail::Simd::Batch<> batch;
+	CreateBatch(batch);
+
+	for(const auto d : {OpenMps::AXIS_X, OpenMps::AXIS_Z})
+	{
+		CompareScalar([&batch, d]()
+		{
+			return OpenMps::Detail::Simd::SumPressureGradient(batch, r_e)[d];
+		});
+	}
+}
+
+// 近傍粒子が無い場合は0になるか？
+TEST(SimdTest, Empty)
+{
+	OpenMps::Detail::Simd::Batch<> batch;
+	batch.Clear();
+
+	ASSERT_EQ(OpenMps::Detail::Simd::SumWeight(batch, r_e), 0.0);
+}
@@ -0,0 +1,120 @@
+﻿#include <gtest/gtest.h>
+#include "../Snapshot.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+	static const std::string filename = "test_snapshot.bin";
+
+	// 位置・速度・圧力・粒子数密度が全て異なる粒子を作る
+	template<std::size_t DIM>
+	auto CreateParticles(const std::size_t n)
+	{
+		using Particle = OpenMps::Particle<DIM>;
+		std::vector<Particle> particles;
+		for(auto i = decltype(n){0}; i < n; i++)
+		{
+			auto particle = Particle((i % 5 == 4) ? Particle::Type::Disabled : static_cast<typename Particle::Type>(i % 3));
+			for(auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				particle.X()[d] = 0.1 * i + d;
+				particle.U()[d] = -0.01 * i - d;
+			}
+			particle.P() = 1000.0 + i;
+			particle.N() = 6.5 + 0.001 * i;
+			particles.push_back(std::move(particle));
+		}
+		return particles;
+	}
+
+	// 書き出して読み込んだ粒子が元と一致するか確かめる
+	template<std::size_t DIM>
+	void TestRoundTrip(const std::size_t n)
+	{
+		const auto particles = CreateParticles<DIM>(n);
+		const auto count = OpenMps::WriteSnapshot<DIM>(filename, particles.size(), 1.25,
+			[&particles](const std::size_t i) -> decltype(auto)
+			{
+				return particles[i];
+			});
+		ASSERT_EQ(n - n / 5, count);
+
+		{
+			const OpenMps::SnapshotReader reader(filename);
+			ASSERT_EQ(DIM, reader.Dimension());
+			ASSERT_EQ(n, reader.Count());
+			ASSERT_EQ(1.25, reader.T());
+			ASSERT_EQ(3 + 2 * DIM, reader.FieldCount());
+			ASSERT_EQ("Type", reader.FieldName(0));
+			ASSERT_EQ("n", reader.FieldName(reader.FieldCount() - 1));
+
+			// 配列は境界に揃っている
+			const auto p = reader.Float64("p");
+			ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(p) % OpenMps::Detail::Snapshot::ALIGNMENT);
+
+			const auto loaded = reader.Particles<DIM>();
+			ASSERT_EQ(n, loaded.size());
+			for(auto i = decltype(n){0}; i < n; i++)
+			{
+				ASSERT_EQ(particles[i].TYPE(), loaded[i].TYPE());
+				for(auto d = decltype(DIM){0}; d < DIM; d++)
+				{
+					ASSERT_EQ(particles[i].X()[d], loaded[i].X()[d]);
+					ASSERT_EQ(particles[i].U()[d], loaded[i].U()[d]);
+				}
+				ASSERT_EQ(particles[i].P(), loaded[i].P());
+				ASSERT_EQ(particles[i].N(), loaded[i].N());
+				ASSERT_EQ(particles[i].P(), p[i]);
+			}
+		}
+		std::remove(filename.c_str());
+	}
+}
+
+// 2次元の粒子を書き出して読み込めるか？
+TEST(SnapshotTest, RoundTrip2D)
+{
+	TestRoundTrip<2>(103);
+}
+
+// 3次元の粒子を書き出して読み込めるか？
+TEST(SnapshotTest, RoundTrip3D)
+{
+	TestRoundTrip<3>(103);
+}
+
+// 粒子が無くても書き出して読み込めるか？
+TEST(SnapshotTest, Empty)
+{
+	TestRoundTrip<2>(0);
+}
+
+// 次元や物理量が合わない時とスナップショットでない時は例外になるか？
+TEST(SnapshotTest, Invalid)
+{
+	const auto particles = CreateParticles<2>(10);
+	OpenMps::WriteSnapshot<2>(filename, particles.size(), 0,
+		[&particles](const std::size_t i) -> decltype(auto)
+		{
+			return particles[i];
+		});
+	{
+		const OpenMps::SnapshotReader reader(filename);
+		ASSERT_THROW(reader.Particles<3>(), std::runtime_error);
+		ASSERT_THROW(reader.Float64("y"), std::runtime_error);
+		ASSERT_THROW(reader.Float64("Type"), std::runtime_error);
+	}
+
+	{
+		std::ofstream output(filename);
+		output << "Type, x, z, u, w, p, n" << "\n";
+	}
+	ASSERT_THROW(OpenMps::SnapshotReader reader(filename), std::runtime_error);
+	std::remove(filename.c_str());
+
+	ASSERT_THROW(OpenMps::SnapshotReader reader(filename), std::runtime_error);
+}
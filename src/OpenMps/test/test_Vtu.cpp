@@ -0,0 +1,161 @@
+﻿#include <gtest/gtest.h>
+#include "../Vtu.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+	static const std::string filename = "test_particles.vtu";
+	static const std::string collectionFilename = "test_particles.pvd";
+
+	// 位置・速度・圧力・粒子数密度が全て異なる粒子を作る
+	template<std::size_t DIM>
+	auto CreateParticles(const std::size_t n)
+	{
+		using Particle = OpenMps::Particle<DIM>;
+		std::vector<Particle> particles;
+		for(auto i = decltype(n){0}; i < n; i++)
+		{
+			auto particle = Particle((i % 5 == 4) ? Particle::Type::Disabled : static_cast<typename Particle::Type>(i % 3));
+			for(auto d = decltype(DIM){0}; d < DIM; d++)
+			{
+				particle.X()[d] = 0.1 * i + d;
+				particle.U()[d] = -0.01 * i - d;
+			}
+			particle.P() = 1000.0 + i;
+			particle.N() = 6.5 + 0.001 * i;
+			particles.push_back(std::move(particle));
+		}
+		return particles;
+	}
+
+	// ファイル全体を読み込む
+	std::string ReadAll(const std::string& file)
+	{
+		std::ifstream input(file, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	}
+
+	// 末尾にまとめた配列を名前で取り出す
+	// @param vtu ファイルの内容
+	// @param name 配列の名前
+	template<typename T>
+	std::vector<T> AppendedArray(const std::string& vtu, const std::string& name)
+	{
+		const auto tag = vtu.find("Name=\"" + name + "\"");
+		EXPECT_NE(std::string::npos, tag);
+		const auto offsetBegin = vtu.find("offset=\"", tag) + 8;
+		const auto offset = std::stoull(vtu.substr(offsetBegin, vtu.find('"', offsetBegin) - offsetBegin));
+
+		const auto data = vtu.find("<AppendedData encoding=\"raw\">\n_") + std::strlen("<AppendedData encoding=\"raw\">\n_");
+		std::uint64_t bytes;
+		std::memcpy(&bytes, vtu.data() + data + offset, sizeof(bytes));
+		std::vector<T> values(bytes / sizeof(T));
+		std::memcpy(values.data(), vtu.data() + data + offset + sizeof(bytes), bytes);
+		return values;
+	}
+
+	// 書き出した配列が元の粒子と一致するか確かめる
+	template<std::size_t DIM>
+	void TestWrite(const std::size_t n)
+	{
+		const auto particles = CreateParticles<DIM>(n);
+		const auto count = OpenMps::WriteVtu<DIM>(filename, particles.size(), 1.25,
+			[&particles](const std::size_t i) -> decltype(auto)
+			{
+				return particles[i];
+			});
+		ASSERT_EQ(n - n / 5, count);
+
+		const auto vtu = ReadAll(filename);
+		std::remove(filename.c_str());
+		ASSERT_NE(std::string::npos, vtu.find("NumberOfPoints=\"" + std::to_string(n) + "\" NumberOfCells=\"" + std::to_string(n) + "\""));
+		ASSERT_EQ("</VTKFile>\n", vtu.substr(vtu.size() - std::strlen("</VTKFile>\n")));
+
+		const auto t = AppendedArray<double>(vtu, "TimeValue");
+		ASSERT_EQ(1u, t.size());
+		ASSERT_EQ(1.25, t[0]);
+
+		const auto x = AppendedArray<double>(vtu, "Points");
+		const auto type = AppendedArray<std::int32_t>(vtu, "Type");
+		const auto u = AppendedArray<double>(vtu, "Velocity");
+		const auto p = AppendedArray<double>(vtu, "p");
+		const auto nd = AppendedArray<double>(vtu, "n");
+		const auto connectivity = AppendedArray<std::int64_t>(vtu, "connectivity");
+		const auto offsets = AppendedArray<std::int64_t>(vtu, "offsets");
+		const auto types = AppendedArray<std::uint8_t>(vtu, "types");
+		ASSERT_EQ(3 * n, x.size());
+		ASSERT_EQ(n, type.size());
+		ASSERT_EQ(3 * n, u.size());
+		ASSERT_EQ(n, p.size());
+		ASSERT_EQ(n, nd.size());
+		ASSERT_EQ(n, connectivity.size());
+		ASSERT_EQ(n, offsets.size());
+		ASSERT_EQ(n, types.size());
+		for(auto i = decltype(n){0}; i < n; i++)
+		{
+			ASSERT_EQ(static_cast<std::int32_t>(particles[i].TYPE()), type[i]);
+			for(auto d = decltype(DIM){0}; d < 3; d++)
+			{
+				ASSERT_EQ((d < DIM) ? particles[i].X()[d] : 0.0, x[3 * i + d]);
+				ASSERT_EQ((d < DIM) ? particles[i].U()[d] : 0.0, u[3 * i + d]);
+			}
+			ASSERT_EQ(particles[i].P(), p[i]);
+			ASSERT_EQ(particles[i].N(), nd[i]);
+			ASSERT_EQ(static_cast<std::int64_t>(i), connectivity[i]);
+			ASSERT_EQ(static_cast<std::int64_t>(i + 1), offsets[i]);
+			ASSERT_EQ(OpenMps::Detail::Vtu::VERTEX, types[i]);
+		}
+	}
+}
+
+// 2次元の粒子を書き出せるか？
+TEST(VtuTest, Write2D)
+{
+	TestWrite<2>(103);
+}
+
+// 3次元の粒子を書き出せるか？
+TEST(VtuTest, Write3D)
+{
+	TestWrite<3>(103);
+}
+
+// 粒子が無くても書き出せるか？
+TEST(VtuTest, Empty)
+{
+	TestWrite<2>(0);
+}
+
+// 追加する度に時系列が書き直されるか？
+TEST(VtuTest, Collection)
+{
+	OpenMps::VtuCollection collection(collectionFilename);
+	collection.Add(0, "particles_00000.vtu");
+	ASSERT_EQ(1u, collection.Count());
+	{
+		const auto pvd = ReadAll(collectionFilename);
+		ASSERT_NE(std::string::npos, pvd.find("<DataSet timestep=\"0\" part=\"0\" file=\"particles_00000.vtu\"/>"));
+		ASSERT_EQ(std::string::npos, pvd.find("particles_00001.vtu"));
+	}
+
+	collection.Add(0.1, "particles_00001.vtu");
+	ASSERT_EQ(2u, collection.Count());
+	{
+		const auto pvd = ReadAll(collectionFilename);
+		ASSERT_NE(std::string::npos, pvd.find("file=\"particles_00000.vtu\""));
+
+		// 時刻は読み込み直すと同じ値になる
+		const auto tag = pvd.find("file=\"particles_00001.vtu\"");
+		ASSERT_NE(std::string::npos, tag);
+		const auto begin = pvd.rfind("timestep=\"", tag) + 10;
+		ASSERT_EQ(0.1, std::stod(pvd.substr(begin, pvd.find('"', begin) - begin)));
+		ASSERT_NE(std::string::npos, pvd.find("</VTKFile>"));
+	}
+	std::remove(collectionFilename.c_str());
+}